@@ -0,0 +1,2 @@
+@ECHO OFF
+for %%p in (360x640 480x800 480x854) do ..\src\assetpackbaker\release\assetpackbaker.exe ..\src %%p ..\src\data\assetpacks\%%p.pack
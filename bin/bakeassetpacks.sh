@@ -0,0 +1 @@
+for profile in 360x640 480x800 480x854;do ../src/assetpackbaker/assetpackbaker ../src $profile ../src/data/assetpacks/$profile.pack;done
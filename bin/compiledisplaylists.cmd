@@ -0,0 +1,2 @@
+@ECHO OFF
+..\src\displaylistcompiler\release\displaylistcompiler.exe ..\src\data\graphics
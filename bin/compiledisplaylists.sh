@@ -0,0 +1 @@
+../src/displaylistcompiler/displaylistcompiler ../src/data/graphics
@@ -0,0 +1,2 @@
+@ECHO OFF
+for /f %%r in ('git rev-parse --short HEAD') do ..\test\rendermatrix\release\rendermatrix.exe -revision %%r -o rendermatrix-%%r.json
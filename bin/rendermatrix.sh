@@ -0,0 +1,2 @@
+revision=$(git rev-parse --short HEAD)
+../test/rendermatrix/rendermatrix -revision $revision -o rendermatrix-$revision.json
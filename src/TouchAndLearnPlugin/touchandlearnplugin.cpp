@@ -21,13 +21,21 @@
 */
 
 #include "touchandlearnplugin.h"
+#include "exercisegenerator.h"
 #include "imageprovider.h"
+#include "imageprefetcher.h"
+#include "imageprovidermetrics.h"
+#include "settingsstore.h"
+#include "tracer.h"
 #include <QtDeclarative/QDeclarativeEngine>
+#include <QtDeclarative/QDeclarativeContext>
+#include <QtGui/QDesktopServices>
 
 void TouchAndLearnPlugin::registerTypes(const char *uri)
 {
     // @uri TouchAndLearn
     qmlRegisterType<QObject>(uri, 1, 0, "TouchAndLearn");
+    qmlRegisterType<ExerciseGenerator>(uri, 1, 0, "ExerciseGenerator");
 }
 
 void TouchAndLearnPlugin::initializeEngine(QDeclarativeEngine *engine, const char *uri)
@@ -35,7 +43,15 @@ void TouchAndLearnPlugin::initializeEngine(QDeclarativeEngine *engine, const cha
     Q_UNUSED(uri)
     const QString graphicsPath = engine->baseUrl().toLocalFile() + QLatin1String("data/graphics");
     ImageProvider::setDataPath(graphicsPath);
-    engine->addImageProvider(QLatin1String("imageprovider"), new ImageProvider);
+    ImageProvider::init();
+    engine->addImageProvider(QLatin1String("imageprovider"), new ImageProvider(QDeclarativeImageProvider::Image));
+    engine->rootContext()->setContextProperty(QLatin1String("imageProvider"), new ImagePrefetcher(engine));
+    engine->rootContext()->setContextProperty(QLatin1String("imageProviderMetrics"), new ImageProviderMetrics(engine));
+    const QString settingsFileName = QDesktopServices::storageLocation(QDesktopServices::DataLocation)
+            + QLatin1String("/settings.bin");
+    engine->rootContext()->setContextProperty(QLatin1String("settingsStore"), new SettingsStore(settingsFileName, engine));
+    if (Tracer::isEnabled())
+        engine->rootContext()->setContextProperty(QLatin1String("tracer"), new Tracer(engine));
 }
 
 Q_EXPORT_PLUGIN(TouchAndLearnPlugin)
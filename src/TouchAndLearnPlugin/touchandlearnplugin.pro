@@ -20,7 +20,7 @@
 
 TEMPLATE = lib
 TARGET  = TouchAndLearnPlugin
-QT += svg declarative
+QT += declarative
 CONFIG += qt plugin
 DESTDIR = ./TouchAndLearn
 
@@ -30,12 +30,18 @@ INCLUDEPATH += \
     ../
 
 SOURCES += \
-    ../imageprovider.cpp \
+    ../exercisegenerator.cpp \
+    ../imageprefetcher.cpp \
+    ../settingsstore.cpp \
     touchandlearnplugin.cpp
 
 HEADERS += \
-    ../imageprovider.h \
+    ../exercisegenerator.h \
+    ../imageprefetcher.h \
+    ../settingsstore.h \
     touchandlearnplugin.h
 
+include(../imageprovider.pri)
+
 OTHER_FILES = qmldir
 
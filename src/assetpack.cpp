@@ -0,0 +1,230 @@
+/*
+    Touch'n'learn - Fun and easy mobile lessons for kids
+    Copyright (C) 2010, 2011 by Alessandro Portale
+    http://touchandlearn.sourceforge.net
+
+    This file is part of Touch'n'learn
+
+    Touch'n'learn is free software; you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    Touch'n'learn is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with Touch'n'learn; if not, write to the Free Software
+    Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA 02110-1301 USA
+*/
+
+#include "assetpack.h"
+#include <QtCore/QDebug>
+#include <QtCore/QDir>
+#include <QtCore/QFileInfo>
+#include <string.h>
+
+// Packs are baked on a desktop machine and read on the devices, which all
+// have the same (little endian) byte order. A foreign byte order fails the
+// magic check.
+static const quint32 packFileMagic = 0x504c4e54; // "TNLP"
+static const quint32 packFileVersion = 1;
+static const int compressionLevel = 9;
+
+// The compressed images follow the header. The entries, and then the keys,
+// start at indexOffset.
+struct FileHeader
+{
+    quint32 magic;
+    quint32 version;
+    quint32 entryCount;
+    quint32 indexOffset;
+};
+
+struct AssetPack::FileEntry
+{
+    quint64 sourceHash;
+    quint32 keyOffset; // Bytes from the start of the file
+    quint32 keyLength; // QChars
+    quint32 dataOffset;
+    quint32 dataSize; // As returned by qCompress()
+    qint32 width;
+    qint32 height;
+    qint32 format;
+    qint32 originalWidth;
+    qint32 originalHeight;
+};
+
+AssetPack::AssetPack()
+    : m_loaded(false)
+    , m_mapping(0)
+    , m_mappingSize(0)
+{
+}
+
+void AssetPack::setFileName(const QString &fileName)
+{
+    QMutexLocker locker(&m_mutex);
+    m_entries.clear();
+    if (m_mapping)
+        m_file.unmap(const_cast<uchar*>(m_mapping));
+    m_mapping = 0;
+    m_mappingSize = 0;
+    m_file.close();
+    m_loaded = false;
+    m_fileName = fileName;
+}
+
+void AssetPack::load()
+{
+    if (m_loaded)
+        return;
+    m_loaded = true;
+    if (m_fileName.isEmpty())
+        return;
+
+    m_file.setFileName(m_fileName);
+    if (!m_file.open(QIODevice::ReadOnly))
+        return;
+    m_mappingSize = m_file.size();
+    if (m_mappingSize >= qint64(sizeof(FileHeader)))
+        m_mapping = m_file.map(0, m_mappingSize);
+    if (!m_mapping) {
+        m_file.close();
+        return;
+    }
+
+    const FileHeader *header = reinterpret_cast<const FileHeader*>(m_mapping);
+    if (header->magic != packFileMagic || header->version != packFileVersion
+            || header->indexOffset % sizeof(quint64) != 0
+            || quint64(header->indexOffset) + quint64(header->entryCount) * sizeof(FileEntry) > quint64(m_mappingSize)) {
+        qDebug() << "Ignoring invalid asset pack" << m_fileName;
+        return;
+    }
+    const FileEntry *entries = reinterpret_cast<const FileEntry*>(m_mapping + header->indexOffset);
+    for (quint32 i = 0; i < header->entryCount; i++) {
+        const FileEntry *entry = entries + i;
+        if (quint64(entry->keyOffset) + entry->keyLength * sizeof(QChar) > quint64(m_mappingSize)
+                || entry->keyOffset % sizeof(QChar) != 0
+                || quint64(entry->dataOffset) + entry->dataSize > quint64(m_mappingSize)
+                || entry->width < 1 || entry->height < 1)
+            continue;
+        const QString key(reinterpret_cast<const QChar*>(m_mapping + entry->keyOffset), entry->keyLength);
+        m_entries.insert(key, entry);
+    }
+}
+
+QImage AssetPack::image(const QString &key, quint64 sourceHash, QSize *originalSize)
+{
+    const FileEntry *entry;
+    {
+        QMutexLocker locker(&m_mutex);
+        load();
+        entry = m_entries.value(key);
+    }
+    // The mapping and the entries do not change after load()
+    if (!entry || entry->sourceHash != sourceHash)
+        return QImage();
+    const QByteArray data = qUncompress(m_mapping + entry->dataOffset, entry->dataSize);
+    QImage result(entry->width, entry->height, QImage::Format(entry->format));
+    if (data.size() != result.byteCount()) {
+        qDebug() << "****************** Corrupt asset pack entry" << key;
+        return QImage();
+    }
+    memcpy(result.bits(), data.constData(), data.size());
+    if (originalSize)
+        *originalSize = QSize(entry->originalWidth, entry->originalHeight);
+    return result;
+}
+
+struct AssetPackWriter::Entry
+{
+    QString key;
+    AssetPack::FileEntry fileEntry;
+};
+
+AssetPackWriter::AssetPackWriter(const QString &fileName)
+    : m_file(fileName)
+{
+}
+
+AssetPackWriter::~AssetPackWriter()
+{
+    qDeleteAll(m_entries);
+}
+
+bool AssetPackWriter::open()
+{
+    QDir().mkpath(QFileInfo(m_file.fileName()).absolutePath());
+    if (!m_file.open(QIODevice::WriteOnly | QIODevice::Truncate))
+        return false;
+    const FileHeader header = { 0, 0, 0, 0 }; // Written by close()
+    return m_file.write(reinterpret_cast<const char*>(&header), sizeof(header)) == sizeof(header);
+}
+
+bool AssetPackWriter::contains(const QString &key) const
+{
+    return m_keys.contains(key);
+}
+
+void AssetPackWriter::add(const QString &key, quint64 sourceHash, const QImage &image, const QSize &originalSize)
+{
+    if (image.isNull() || m_keys.contains(key))
+        return;
+    const QImage packedImage =
+            image.depth() == 32 ? image : image.convertToFormat(QImage::Format_ARGB32_Premultiplied);
+    const QByteArray data = qCompress(packedImage.constBits(), packedImage.byteCount(), compressionLevel);
+    Entry *entry = new Entry;
+    entry->key = key;
+    AssetPack::FileEntry &fileEntry = entry->fileEntry;
+    memset(&fileEntry, 0, sizeof(fileEntry)); // Including the padding, which is written too
+    fileEntry.sourceHash = sourceHash;
+    fileEntry.keyLength = key.length();
+    fileEntry.dataOffset = m_file.pos();
+    fileEntry.dataSize = data.size();
+    fileEntry.width = packedImage.width();
+    fileEntry.height = packedImage.height();
+    fileEntry.format = packedImage.format();
+    fileEntry.originalWidth = originalSize.width();
+    fileEntry.originalHeight = originalSize.height();
+    m_file.write(data);
+    m_keys.insert(key);
+    m_entries.append(entry);
+}
+
+bool AssetPackWriter::close()
+{
+    static const char padding[sizeof(quint64)] = {0};
+    m_file.write(padding, (sizeof(quint64) - m_file.pos() % sizeof(quint64)) % sizeof(quint64));
+    const quint64 indexOffset = m_file.pos();
+    quint64 keyOffset = indexOffset + m_entries.count() * sizeof(AssetPack::FileEntry);
+    foreach (Entry *entry, m_entries) {
+        entry->fileEntry.keyOffset = keyOffset;
+        keyOffset += entry->fileEntry.keyLength * sizeof(QChar);
+    }
+    if (keyOffset > 0xffffffffu) {
+        qDebug() << "****************** Asset pack is too large" << m_file.fileName();
+        m_file.remove();
+        return false;
+    }
+    foreach (const Entry *entry, m_entries)
+        m_file.write(reinterpret_cast<const char*>(&entry->fileEntry), sizeof(AssetPack::FileEntry));
+    foreach (const Entry *entry, m_entries)
+        m_file.write(reinterpret_cast<const char*>(entry->key.constData()), entry->key.length() * sizeof(QChar));
+    FileHeader header;
+    memset(&header, 0, sizeof(header));
+    header.magic = packFileMagic;
+    header.version = packFileVersion;
+    header.entryCount = m_entries.count();
+    header.indexOffset = indexOffset;
+    m_file.seek(0);
+    m_file.write(reinterpret_cast<const char*>(&header), sizeof(header));
+    m_file.close();
+    if (m_file.error() != QFile::NoError) {
+        m_file.remove();
+        return false;
+    }
+    return true;
+}
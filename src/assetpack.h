@@ -0,0 +1,85 @@
+/*
+    Touch'n'learn - Fun and easy mobile lessons for kids
+    Copyright (C) 2010, 2011 by Alessandro Portale
+    http://touchandlearn.sourceforge.net
+
+    This file is part of Touch'n'learn
+
+    Touch'n'learn is free software; you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    Touch'n'learn is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with Touch'n'learn; if not, write to the Free Software
+    Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA 02110-1301 USA
+*/
+
+#ifndef ASSETPACK_H
+#define ASSETPACK_H
+
+#include <QtCore/QFile>
+#include <QtCore/QHash>
+#include <QtCore/QList>
+#include <QtCore/QMutex>
+#include <QtCore/QSet>
+#include <QtGui/QImage>
+
+// Read-only file of images which were rendered offline for one screen
+// profile, see bin/bakeassetpacks.sh. Each image is compressed on its own and
+// found via an index, so that a lookup only decompresses the one image.
+class AssetPack
+{
+public:
+    AssetPack();
+
+    // Must not be called while images are looked up
+    void setFileName(const QString &fileName);
+
+    // Lookups with a different hash of the source SVG file(s) fail, like in
+    // the ImageDiskCache
+    QImage image(const QString &key, quint64 sourceHash, QSize *originalSize);
+
+private:
+    friend class AssetPackWriter;
+    struct FileEntry;
+
+    void load();
+
+    QMutex m_mutex;
+    QString m_fileName;
+    bool m_loaded;
+    QFile m_file;
+    const uchar *m_mapping;
+    qint64 m_mappingSize;
+    QHash<QString, const FileEntry*> m_entries;
+};
+
+// Writes an asset pack. The images are compressed and written as they are
+// added, the index is written by close().
+class AssetPackWriter
+{
+public:
+    AssetPackWriter(const QString &fileName);
+    ~AssetPackWriter();
+
+    bool open();
+    bool contains(const QString &key) const;
+    // Images with a key that was already added are skipped
+    void add(const QString &key, quint64 sourceHash, const QImage &image, const QSize &originalSize);
+    bool close();
+
+private:
+    struct Entry;
+
+    QFile m_file;
+    QList<Entry*> m_entries;
+    QSet<QString> m_keys;
+};
+
+#endif // ASSETPACK_H
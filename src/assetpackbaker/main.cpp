@@ -0,0 +1,250 @@
+/*
+    Touch'n'learn - Fun and easy mobile lessons for kids
+    Copyright (C) 2010, 2011 by Alessandro Portale
+    http://touchandlearn.sourceforge.net
+
+    This file is part of Touch'n'learn
+
+    Touch'n'learn is free software; you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    Touch'n'learn is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with Touch'n'learn; if not, write to the Free Software
+    Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA 02110-1301 USA
+*/
+
+#include <QtCore/QDir>
+#include <QtCore/QFileInfo>
+#include <QtCore/QMap>
+#include <QtCore/QMutex>
+#include <QtCore/QStringList>
+#include <QtCore/QTextStream>
+#include <QtCore/QTime>
+#include <QtCore/QUrl>
+#include <QtGui/QApplication>
+#include <QtGui/QGraphicsScene>
+#include <QtDeclarative/QDeclarativeComponent>
+#include <QtDeclarative/QDeclarativeEngine>
+#include <QtDeclarative/QDeclarativeItem>
+#include <QtSvg/QSvgRenderer>
+
+#include "exercisegenerator.h"
+#include "imageprovider.h"
+#include "imagerequest.h"
+#include "svgelementindex.h"
+
+typedef QPair<QString, QSize> Request;
+
+// Records the ids and sizes which the QML UI requests
+class RecordingImageProvider : public ImageProvider
+{
+public:
+    RecordingImageProvider()
+        : ImageProvider(QDeclarativeImageProvider::Image)
+    {
+        m_lastRequest.start();
+    }
+
+    QImage requestImage(const QString &id, QSize *size, const QSize &requestedSize)
+    {
+        {
+            QMutexLocker locker(&m_mutex);
+            const Request request(id, requestedSize);
+            if (!m_requests.contains(request)) {
+                m_requests.append(request);
+                m_lastRequest.start();
+            }
+        }
+        return ImageProvider::requestImage(id, size, requestedSize);
+    }
+
+    QList<Request> requests()
+    {
+        QMutexLocker locker(&m_mutex);
+        return m_requests;
+    }
+
+    // Milliseconds since the last new request, or since construction
+    int quietTime()
+    {
+        QMutexLocker locker(&m_mutex);
+        return m_lastRequest.elapsed();
+    }
+
+private:
+    QMutex m_mutex;
+    QList<Request> m_requests;
+    QTime m_lastRequest;
+};
+
+// Lets the UI run until its images are loaded
+static void waitForImages(RecordingImageProvider *imageProvider)
+{
+    QTime time;
+    time.start();
+    while (time.elapsed() < 1000 || (imageProvider->quietTime() < 1000 && time.elapsed() < 30000))
+        QCoreApplication::processEvents(QEventLoop::AllEvents, 50);
+}
+
+// Shows each screen of the UI with the screen profile, and returns the
+// images which were requested for it
+static QList<Request> recordedRequests(const QString &qmlPath, const QSize &screenSize)
+{
+    QDeclarativeEngine engine;
+    engine.setOfflineStoragePath(QDir::tempPath() + QLatin1String("/assetpackbaker"));
+    RecordingImageProvider *imageProvider = new RecordingImageProvider;
+    engine.addImageProvider(QLatin1String("imageprovider"), imageProvider);
+    QDeclarativeComponent component(&engine, QUrl::fromLocalFile(qmlPath + QLatin1String("/main.qml")));
+    QDeclarativeItem *mainMenu = qobject_cast<QDeclarativeItem*>(component.create());
+    if (!mainMenu) {
+        QTextStream(stdout) << component.errorString() << endl;
+        return QList<Request>();
+    }
+    QGraphicsScene scene;
+    scene.addItem(mainMenu);
+    mainMenu->setWidth(screenSize.width());
+    mainMenu->setHeight(screenSize.height());
+    waitForImages(imageProvider); // The lesson menu comes up by itself
+
+    const QStringList screens =
+            QDir(qmlPath).entryList(QStringList(QLatin1String("Lesson*.qml")), QDir::Files, QDir::Name);
+    foreach (const QString &screen, screens) {
+        QMetaObject::invokeMethod(mainMenu, "switchToScreen", Q_ARG(QVariant, QFileInfo(screen).baseName()));
+        waitForImages(imageProvider);
+    }
+    QMetaObject::invokeMethod(mainMenu, "handleVolumeChange", Q_ARG(QVariant, 60));
+    waitForImages(imageProvider);
+    const QList<Request> result = imageProvider->requests();
+    delete mainMenu;
+    return result;
+}
+
+// Mirrors the data of database.js
+static const char* const noteIds[] = {
+    "C", "C sharp", "D flat", "D", "D sharp", "E flat", "E", "F flat", "E sharp", "F",
+    "F sharp", "G flat", "G", "G sharp", "A flat", "A", "A sharp", "B flat", "B", "C flat"
+};
+static const char* const colorIds[] = {
+    "#FF3030", "#0AC00A", "#3030FF", "#FAFAFA", "#808080", "#000000",
+    "#FFE800", "#FF8C00", "#905020", "#9F00FF", "#FFA0C0"
+};
+static const char* const countableIds[] = { "fish", "apple", "balloon" };
+static const int quantityLayoutsCount = 12; // See countExerciseFunction in database.js
+static const int maximumQuantity = 20;
+// Higher variations end up with the cache key of a lower one
+static const int variationsCount = 16;
+
+static QStringList svgElementNames(const QString &graphicsPath, const QString &svgFileBaseName)
+{
+    QFile svgFile(graphicsPath + QLatin1Char('/') + svgFileBaseName + QLatin1String(".svg"));
+    if (!svgFile.open(QIODevice::ReadOnly))
+        return QStringList();
+    const QByteArray svgDocument = svgFile.readAll();
+    QSvgRenderer renderer(svgDocument);
+    SvgElementIndex index;
+    index.build(svgDocument, &renderer, QLatin1String("id_"));
+    QStringList result;
+    foreach (const QString &name, index.elementNames())
+        if (!name.contains(QLatin1Char('_'))) // Companions and parts
+            result.append(name);
+    return result;
+}
+
+// All ids which the lessons can request from one image family
+static QStringList imageIds(ImageFamily family, const QString &graphicsPath)
+{
+    const QString prefix = ImageRequest::familyName(family) + QLatin1Char('/');
+    QStringList result;
+    switch (family) {
+    case ImageFamilyButton:
+        for (int variation = 0; variation < variationsCount; variation++)
+            result.append(prefix + QString::number(variation));
+        break;
+    case ImageFamilyObject:
+        foreach (const QString &name, svgElementNames(graphicsPath, QLatin1String("objects")))
+            result.append(prefix + name);
+        break;
+    case ImageFamilyClock:
+        for (int hour = 1; hour <= 12; hour++)
+            for (int minute = 0; minute < 60; minute += 5)
+                for (int variation = 0; variation < variationsCount; variation++)
+                    result.append(prefix + QString::number(hour) + QLatin1Char('/') + QString::number(minute)
+                                  + QLatin1Char('/') + QString::number(variation));
+        break;
+    case ImageFamilyNotes:
+        for (size_t i = 0; i < sizeof noteIds / sizeof noteIds[0]; i++)
+            result.append(prefix + QLatin1String(noteIds[i]));
+        break;
+    case ImageFamilyQuantity:
+        for (int quantity = 1; quantity <= maximumQuantity; quantity++)
+            for (int seed = 0; seed < quantityLayoutsCount; seed++)
+                result.append(prefix + QString::number(quantity) + QLatin1Char('/')
+                              + QLatin1String(countableIds[seed % 3]) + QLatin1Char('/') + QString::number(seed));
+        break;
+    case ImageFamilyLessonIcon:
+        foreach (const QString &name, svgElementNames(graphicsPath, QLatin1String("lessonicons")))
+            for (int variation = 0; variation < variationsCount; variation++)
+                result.append(prefix + name + QLatin1Char('/') + QString::number(variation));
+        break;
+    case ImageFamilyColor:
+        for (size_t i = 0; i < sizeof colorIds / sizeof colorIds[0]; i++)
+            for (int variation = 0; variation < variationsCount; variation++)
+                result.append(prefix + QLatin1String(colorIds[i]) + QLatin1Char('/') + QString::number(variation));
+        break;
+    default:
+        break; // Only the recorded ids
+    }
+    return result;
+}
+
+int main(int argc, char *argv[])
+{
+    QApplication app(argc, argv);
+    QTextStream out(stdout);
+    const QStringList arguments = app.arguments();
+    const QStringList profile = arguments.value(2).split(QLatin1Char('x'));
+    const QSize screenSize(profile.value(0).toInt(), profile.value(1).toInt());
+    if (arguments.count() != 4 || screenSize.isEmpty()) {
+        out << "Usage: assetpackbaker <source directory> <width>x<height> <pack file>" << endl;
+        return 1;
+    }
+    const QString graphicsPath = arguments.at(1) + QLatin1String("/data/graphics");
+    ImageProvider::setDataPath(graphicsPath);
+    ImageProvider::loadAllAssets();
+    qmlRegisterType<QObject>("TouchAndLearn", 1, 0, "QObject");
+    qmlRegisterType<ExerciseGenerator>("TouchAndLearn", 1, 0, "ExerciseGenerator");
+
+    // The recorded sizes of each family are used for all ids of the family
+    const QList<Request> recorded = recordedRequests(arguments.at(1) + QLatin1String("/qml/touchandlearn"), screenSize);
+    QMap<int, QList<QSize> > familySizes;
+    QList<Request> requests;
+    foreach (const Request &request, recorded) {
+        ImageRequest parsed;
+        if (!parsed.parse(request.first))
+            continue;
+        QList<QSize> &sizes = familySizes[parsed.family()];
+        if (!sizes.contains(request.second))
+            sizes.append(request.second);
+        requests.append(request);
+    }
+    for (QMap<int, QList<QSize> >::const_iterator i = familySizes.constBegin(); i != familySizes.constEnd(); ++i)
+        foreach (const QString &id, imageIds(ImageFamily(i.key()), graphicsPath))
+            foreach (const QSize &size, i.value())
+                requests.append(Request(id, size));
+
+    const QString packFileName = arguments.at(3);
+    if (!ImageProvider::writeAssetPack(packFileName, requests)) {
+        out << "Could not write " << packFileName << endl;
+        return 1;
+    }
+    out << packFileName << ": " << recorded.count() << " recorded requests, "
+        << QFileInfo(packFileName).size() / 1024 << " KB" << endl;
+    return 0;
+}
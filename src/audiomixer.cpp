@@ -0,0 +1,169 @@
+/*
+    Touch'n'learn - Fun and easy mobile lessons for kids
+    Copyright (C) 2010, 2011 by Alessandro Portale
+    http://touchandlearn.sourceforge.net
+
+    This file is part of Touch'n'learn
+
+    Touch'n'learn is free software; you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    Touch'n'learn is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with Touch'n'learn; if not, write to the Free Software
+    Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA 02110-1301 USA
+*/
+
+#include "audiomixer.h"
+#include <QtCore/QDebug>
+#include <QtCore/QFile>
+#include <QtCore/QVarLengthArray>
+#include <QtCore/QtEndian>
+#include <string.h>
+
+inline static quint16 readUInt16(const char *data)
+{
+    return qFromLittleEndian<quint16>(reinterpret_cast<const uchar*>(data));
+}
+
+inline static quint32 readUInt32(const char *data)
+{
+    return qFromLittleEndian<quint32>(reinterpret_cast<const uchar*>(data));
+}
+
+PcmClip decodeWav(const QByteArray &data, int sampleRate)
+{
+    const char *bytes = data.constData();
+    if (data.size() < 12 || qstrncmp(bytes, "RIFF", 4) != 0 || qstrncmp(bytes + 8, "WAVE", 4) != 0)
+        return PcmClip();
+    int channels = 0;
+    int sourceRate = 0;
+    int bitsPerSample = 0;
+    const char *sampleData = 0;
+    int sampleDataSize = 0;
+    for (qint64 offset = 12; offset + 8 <= data.size(); ) {
+        const quint32 chunkSize = readUInt32(bytes + offset + 4);
+        const char *chunk = bytes + offset + 8;
+        const int available = int(qMin<qint64>(chunkSize, data.size() - offset - 8));
+        if (qstrncmp(bytes + offset, "fmt ", 4) == 0 && available >= 16) {
+            if (readUInt16(chunk) != 1) // PCM
+                return PcmClip();
+            channels = readUInt16(chunk + 2);
+            sourceRate = readUInt32(chunk + 4);
+            bitsPerSample = readUInt16(chunk + 14);
+        } else if (qstrncmp(bytes + offset, "data", 4) == 0) {
+            sampleData = chunk;
+            sampleDataSize = available;
+        }
+        offset += 8 + ((qint64(chunkSize) + 1) & ~qint64(1));
+    }
+    if (!sampleData || channels < 1 || sourceRate < 1 || (bitsPerSample != 8 && bitsPerSample != 16))
+        return PcmClip();
+
+    const int frameSize = channels * bitsPerSample / 8;
+    const int sourceFrames = sampleDataSize / frameSize;
+    QVector<qint16> source(sourceFrames);
+    for (int frame = 0; frame < sourceFrames; frame++) {
+        int sum = 0;
+        for (int channel = 0; channel < channels; channel++) {
+            const char *sample = sampleData + frame * frameSize + channel * bitsPerSample / 8;
+            sum += bitsPerSample == 8 ? (int(uchar(*sample)) - 128) << 8
+                                      : int(qint16(readUInt16(sample)));
+        }
+        source[frame] = qint16(sum / channels);
+    }
+    if (sourceRate == sampleRate)
+        return source;
+
+    const int frames = int(qint64(sourceFrames) * sampleRate / sourceRate);
+    PcmClip result(frames);
+    for (int frame = 0; frame < frames; frame++) {
+        // 16.16 fixed point position in the source
+        const qint64 position = (qint64(frame) * sourceRate << 16) / sampleRate;
+        const int index = int(position >> 16);
+        const int fraction = int(position & 0xffff);
+        const int next = qMin(index + 1, sourceFrames - 1);
+        result[frame] = qint16(source.at(index) + int((qint64(source.at(next)) - source.at(index)) * fraction >> 16));
+    }
+    return result;
+}
+
+PcmClip loadWav(const QString &fileName, int sampleRate)
+{
+    QFile file(fileName);
+    if (!file.open(QIODevice::ReadOnly))
+        return PcmClip();
+    const PcmClip result = decodeWav(file.readAll(), sampleRate);
+    if (result.isEmpty())
+        qDebug() << "****************** Could not decode" << fileName;
+    return result;
+}
+
+AudioMixer::AudioMixer()
+{
+    stopAll();
+}
+
+void AudioMixer::play(const PcmClip *clip, int volume)
+{
+    if (!clip || clip->isEmpty())
+        return;
+    QMutexLocker locker(&m_mutex);
+    Voice *voice = m_voices;
+    for (int i = 0; i < VoiceCount; i++) {
+        if (!m_voices[i].clip) {
+            voice = m_voices + i;
+            break;
+        }
+        if (m_voices[i].position > voice->position)
+            voice = m_voices + i;
+    }
+    voice->clip = clip;
+    voice->position = 0;
+    voice->gain = qBound(0, volume, 100) * 256 / 100;
+}
+
+void AudioMixer::stopAll()
+{
+    QMutexLocker locker(&m_mutex);
+    for (int i = 0; i < VoiceCount; i++)
+        m_voices[i].clip = 0;
+}
+
+bool AudioMixer::isPlaying() const
+{
+    QMutexLocker locker(&m_mutex);
+    for (int i = 0; i < VoiceCount; i++)
+        if (m_voices[i].clip)
+            return true;
+    return false;
+}
+
+void AudioMixer::mix(qint16 *samples, int count)
+{
+    QVarLengthArray<int, 1024> sums(count);
+    memset(sums.data(), 0, count * sizeof(int));
+    {
+        QMutexLocker locker(&m_mutex);
+        for (int i = 0; i < VoiceCount; i++) {
+            Voice &voice = m_voices[i];
+            if (!voice.clip)
+                continue;
+            const qint16 *clipSamples = voice.clip->constData() + voice.position;
+            const int voiceCount = qMin(count, voice.clip->count() - voice.position);
+            for (int j = 0; j < voiceCount; j++)
+                sums[j] += clipSamples[j] * voice.gain;
+            voice.position += voiceCount;
+            if (voice.position >= voice.clip->count())
+                voice.clip = 0;
+        }
+    }
+    for (int i = 0; i < count; i++)
+        samples[i] = qint16(qBound(-32768, sums[i] >> 8, 32767));
+}
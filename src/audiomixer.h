@@ -0,0 +1,73 @@
+/*
+    Touch'n'learn - Fun and easy mobile lessons for kids
+    Copyright (C) 2010, 2011 by Alessandro Portale
+    http://touchandlearn.sourceforge.net
+
+    This file is part of Touch'n'learn
+
+    Touch'n'learn is free software; you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    Touch'n'learn is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with Touch'n'learn; if not, write to the Free Software
+    Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA 02110-1301 USA
+*/
+
+#ifndef AUDIOMIXER_H
+#define AUDIOMIXER_H
+
+#include <QtCore/QByteArray>
+#include <QtCore/QMutex>
+#include <QtCore/QString>
+#include <QtCore/QVector>
+
+// Mono 16 bit samples at the sample rate of the mixer
+typedef QVector<qint16> PcmClip;
+
+// Decodes uncompressed 8 or 16 bit RIFF WAVE data. Stereo is mixed down,
+// other sample rates are resampled linearly. Returns an empty clip on errors.
+PcmClip decodeWav(const QByteArray &data, int sampleRate);
+PcmClip loadWav(const QString &fileName, int sampleRate);
+
+// Mixes the playing clips into mono 16 bit samples. play() only takes a
+// free voice, so that a sound starts with the next mix() call. The clips
+// must outlive their playback.
+class AudioMixer
+{
+public:
+    enum {
+        SampleRate = 44100,
+        VoiceCount = 8
+    };
+
+    AudioMixer();
+
+    // Volume 0 - 100. If all voices are busy, the one which played longest
+    // is replaced.
+    void play(const PcmClip *clip, int volume);
+    void stopAll();
+    bool isPlaying() const;
+
+    // Called by the sink, possibly from another thread
+    void mix(qint16 *samples, int count);
+
+private:
+    struct Voice
+    {
+        const PcmClip *clip;
+        int position;
+        int gain; // 256 is unity
+    };
+
+    mutable QMutex m_mutex;
+    Voice m_voices[VoiceCount];
+};
+
+#endif // AUDIOMIXER_H
@@ -0,0 +1,102 @@
+/*
+    Touch'n'learn - Fun and easy mobile lessons for kids
+    Copyright (C) 2010, 2011 by Alessandro Portale
+    http://touchandlearn.sourceforge.net
+
+    This file is part of Touch'n'learn
+
+    Touch'n'learn is free software; you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    Touch'n'learn is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with Touch'n'learn; if not, write to the Free Software
+    Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA 02110-1301 USA
+*/
+
+#include "audiooutputsink.h"
+#include "audiomixer.h"
+#include <QtCore/QDebug>
+#include <QtCore/QIODevice>
+#include <QtMultimedia/QAudioOutput>
+
+class MixerDevice : public QIODevice
+{
+public:
+    MixerDevice(AudioMixer *mixer, QObject *parent)
+        : QIODevice(parent)
+        , m_mixer(mixer)
+    { }
+
+    bool isSequential() const
+    {
+        return true;
+    }
+
+protected:
+    // Silence while nothing plays keeps the device running, and ready
+    qint64 readData(char *data, qint64 maxSize)
+    {
+        const int samples = int(maxSize / sizeof(qint16));
+        m_mixer->mix(reinterpret_cast<qint16*>(data), samples);
+        return samples * sizeof(qint16);
+    }
+
+    qint64 writeData(const char *data, qint64 maxSize)
+    {
+        Q_UNUSED(data)
+        Q_UNUSED(maxSize)
+        return -1;
+    }
+
+private:
+    AudioMixer *m_mixer;
+};
+
+AudioOutputSink::AudioOutputSink(AudioMixer *mixer, QObject *parent)
+    : AudioSink(mixer, parent)
+    , m_output(0)
+    , m_device(new MixerDevice(mixer, this))
+{
+}
+
+AudioOutputSink::~AudioOutputSink()
+{
+    stop();
+}
+
+bool AudioOutputSink::start()
+{
+    QAudioFormat format;
+    format.setFrequency(AudioMixer::SampleRate);
+    format.setChannels(1);
+    format.setSampleSize(16);
+    format.setCodec(QLatin1String("audio/pcm"));
+    format.setByteOrder(QSysInfo::ByteOrder == QSysInfo::LittleEndian ? QAudioFormat::LittleEndian
+                                                                      : QAudioFormat::BigEndian);
+    format.setSampleType(QAudioFormat::SignedInt);
+    const QAudioDeviceInfo device = QAudioDeviceInfo::defaultOutputDevice();
+    if (!device.isFormatSupported(format)) {
+        qDebug() << "****************** Audio format not supported by" << device.deviceName();
+        return false;
+    }
+    delete m_output;
+    m_output = new QAudioOutput(device, format, this);
+    m_output->setBufferSize(BufferSamples * sizeof(qint16));
+    m_device->open(QIODevice::ReadOnly);
+    m_output->start(m_device);
+    return m_output->error() == QAudio::NoError;
+}
+
+void AudioOutputSink::stop()
+{
+    if (m_output)
+        m_output->stop();
+    m_device->close();
+}
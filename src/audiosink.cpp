@@ -0,0 +1,152 @@
+/*
+    Touch'n'learn - Fun and easy mobile lessons for kids
+    Copyright (C) 2010, 2011 by Alessandro Portale
+    http://touchandlearn.sourceforge.net
+
+    This file is part of Touch'n'learn
+
+    Touch'n'learn is free software; you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    Touch'n'learn is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with Touch'n'learn; if not, write to the Free Software
+    Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA 02110-1301 USA
+*/
+
+#include "audiosink.h"
+#include "audiomixer.h"
+#include <QtCore/QtEndian>
+#include <QtCore/QVarLengthArray>
+
+const int renderInterval = 10; // Milliseconds
+
+AudioSink::AudioSink(AudioMixer *mixer, QObject *parent)
+    : QObject(parent)
+    , m_mixer(mixer)
+{
+}
+
+OfflineAudioSink::OfflineAudioSink(AudioMixer *mixer, QObject *parent)
+    : AudioSink(mixer, parent)
+    , m_renderedSamples(0)
+{
+    m_timer.setInterval(renderInterval);
+    connect(&m_timer, SIGNAL(timeout()), SLOT(renderElapsed()));
+}
+
+bool OfflineAudioSink::start()
+{
+    m_renderedSamples = 0;
+    m_elapsed.start();
+    m_timer.start();
+    return true;
+}
+
+void OfflineAudioSink::stop()
+{
+    m_timer.stop();
+}
+
+void OfflineAudioSink::render(int sampleCount)
+{
+    QVarLengthArray<qint16, 1024> samples(sampleCount);
+    m_mixer->mix(samples.data(), sampleCount);
+    consume(samples.constData(), sampleCount);
+    m_renderedSamples += sampleCount;
+}
+
+void OfflineAudioSink::renderElapsed()
+{
+    const qint64 dueSamples = m_elapsed.elapsed() * AudioMixer::SampleRate / 1000;
+    if (dueSamples > m_renderedSamples)
+        render(int(dueSamples - m_renderedSamples));
+}
+
+NullAudioSink::NullAudioSink(AudioMixer *mixer, QObject *parent)
+    : OfflineAudioSink(mixer, parent)
+{
+}
+
+void NullAudioSink::consume(const qint16 *samples, int count)
+{
+    Q_UNUSED(samples)
+    Q_UNUSED(count)
+}
+
+WavFileAudioSink::WavFileAudioSink(AudioMixer *mixer, const QString &fileName, QObject *parent)
+    : OfflineAudioSink(mixer, parent)
+    , m_file(fileName)
+{
+}
+
+WavFileAudioSink::~WavFileAudioSink()
+{
+    stop();
+}
+
+bool WavFileAudioSink::start()
+{
+    if (!m_file.open(QIODevice::WriteOnly | QIODevice::Truncate))
+        return false;
+    writeHeader(0);
+    return OfflineAudioSink::start();
+}
+
+void WavFileAudioSink::stop()
+{
+    OfflineAudioSink::stop();
+    if (!m_file.isOpen())
+        return;
+    const int dataBytes = int(m_file.pos()) - 44;
+    m_file.seek(0);
+    writeHeader(dataBytes);
+    m_file.close();
+}
+
+void WavFileAudioSink::consume(const qint16 *samples, int count)
+{
+    if (!m_file.isOpen())
+        return;
+    QVarLengthArray<qint16, 1024> littleEndian(count);
+    for (int i = 0; i < count; i++)
+        littleEndian[i] = qToLittleEndian(samples[i]);
+    m_file.write(reinterpret_cast<const char*>(littleEndian.constData()), count * sizeof(qint16));
+}
+
+inline static void appendUInt16(QByteArray *data, quint16 value)
+{
+    uchar bytes[2];
+    qToLittleEndian(value, bytes);
+    data->append(reinterpret_cast<const char*>(bytes), 2);
+}
+
+inline static void appendUInt32(QByteArray *data, quint32 value)
+{
+    uchar bytes[4];
+    qToLittleEndian(value, bytes);
+    data->append(reinterpret_cast<const char*>(bytes), 4);
+}
+
+void WavFileAudioSink::writeHeader(int dataBytes)
+{
+    QByteArray header("RIFF");
+    appendUInt32(&header, 36 + dataBytes);
+    header.append("WAVEfmt ");
+    appendUInt32(&header, 16);
+    appendUInt16(&header, 1); // PCM
+    appendUInt16(&header, 1); // Mono
+    appendUInt32(&header, AudioMixer::SampleRate);
+    appendUInt32(&header, AudioMixer::SampleRate * 2);
+    appendUInt16(&header, 2);
+    appendUInt16(&header, 16);
+    header.append("data");
+    appendUInt32(&header, dataBytes);
+    m_file.write(header);
+}
@@ -0,0 +1,101 @@
+/*
+    Touch'n'learn - Fun and easy mobile lessons for kids
+    Copyright (C) 2010, 2011 by Alessandro Portale
+    http://touchandlearn.sourceforge.net
+
+    This file is part of Touch'n'learn
+
+    Touch'n'learn is free software; you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    Touch'n'learn is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with Touch'n'learn; if not, write to the Free Software
+    Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA 02110-1301 USA
+*/
+
+#ifndef AUDIOSINK_H
+#define AUDIOSINK_H
+
+#include <QtCore/QElapsedTimer>
+#include <QtCore/QFile>
+#include <QtCore/QObject>
+#include <QtCore/QTimer>
+
+class AudioMixer;
+
+// Plays the output of an AudioMixer
+class AudioSink : public QObject
+{
+    Q_OBJECT
+
+public:
+    explicit AudioSink(AudioMixer *mixer, QObject *parent = 0);
+
+    virtual bool start() = 0;
+    virtual void stop() = 0;
+
+protected:
+    AudioMixer *m_mixer;
+};
+
+// Pulls the mixer output in real time without a sound device, or via
+// render() in tests
+class OfflineAudioSink : public AudioSink
+{
+    Q_OBJECT
+
+public:
+    explicit OfflineAudioSink(AudioMixer *mixer, QObject *parent = 0);
+
+    bool start();
+    void stop();
+    void render(int sampleCount);
+
+protected:
+    virtual void consume(const qint16 *samples, int count) = 0;
+
+private slots:
+    void renderElapsed();
+
+private:
+    QTimer m_timer;
+    QElapsedTimer m_elapsed;
+    qint64 m_renderedSamples;
+};
+
+class NullAudioSink : public OfflineAudioSink
+{
+public:
+    explicit NullAudioSink(AudioMixer *mixer, QObject *parent = 0);
+
+protected:
+    void consume(const qint16 *samples, int count);
+};
+
+// Writes a mono 16 bit WAVE file, which is complete after stop()
+class WavFileAudioSink : public OfflineAudioSink
+{
+public:
+    WavFileAudioSink(AudioMixer *mixer, const QString &fileName, QObject *parent = 0);
+    ~WavFileAudioSink();
+
+    bool start();
+    void stop();
+
+protected:
+    void consume(const qint16 *samples, int count);
+
+private:
+    void writeHeader(int dataBytes);
+
+    QFile m_file;
+};
+
+#endif // AUDIOSINK_H
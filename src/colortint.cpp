@@ -0,0 +1,172 @@
+/*
+    Touch'n'learn - Fun and easy mobile lessons for kids
+    Copyright (C) 2010, 2011 by Alessandro Portale
+    http://touchandlearn.sourceforge.net
+
+    This file is part of Touch'n'learn
+
+    Touch'n'learn is free software; you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    Touch'n'learn is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with Touch'n'learn; if not, write to the Free Software
+    Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA 02110-1301 USA
+*/
+
+#include "colortint.h"
+#include "simd.h"
+#include <string.h>
+#include <QtCore/QVector>
+
+bool colorTintImplementationSupported(ColorTintImplementation implementation)
+{
+    switch (implementation) {
+    case ColorTintImplementationScalar:
+        return true;
+    case ColorTintImplementationSse2:
+#ifdef SIMD_SSE2
+        return true;
+#else
+        return false;
+#endif
+    }
+    return false;
+}
+
+ColorTintImplementation fastestColorTintImplementation()
+{
+    if (colorTintImplementationSupported(ColorTintImplementationSse2))
+        return ColorTintImplementationSse2;
+    return ColorTintImplementationScalar;
+}
+
+QImage alphaMask(const QImage &image)
+{
+    Q_ASSERT(image.format() == QImage::Format_ARGB32_Premultiplied);
+    QImage result(image.size(), QImage::Format_Indexed8);
+    QVector<QRgb> grayScale(256);
+    for (int i = 0; i < grayScale.count(); i++)
+        grayScale[i] = qRgb(i, i, i);
+    result.setColorTable(grayScale);
+    for (int y = 0; y < image.height(); y++) {
+        const QRgb *source = reinterpret_cast<const QRgb*>(image.constScanLine(y));
+        uchar *alpha = result.scanLine(y);
+        for (int x = 0; x < image.width(); x++)
+            alpha[x] = qAlpha(source[x]);
+    }
+    return result;
+}
+
+// QPainter's BYTE_MUL, multiplies all four channels with alpha / 255
+inline static uint byteMul(uint pixel, uint alpha)
+{
+    uint t = (pixel & 0xff00ff) * alpha;
+    t = (t + ((t >> 8) & 0xff00ff) + 0x800080) >> 8;
+    t &= 0xff00ff;
+    pixel = ((pixel >> 8) & 0xff00ff) * alpha;
+    pixel = (pixel + ((pixel >> 8) & 0xff00ff) + 0x800080);
+    pixel &= 0xff00ff00;
+    return pixel | t;
+}
+
+// QPainter's PREMUL
+QRgb premultipliedColor(QRgb color)
+{
+    const uint alpha = qAlpha(color);
+    uint t = (color & 0xff00ff) * alpha;
+    t = (t + ((t >> 8) & 0xff00ff) + 0x800080) >> 8;
+    t &= 0xff00ff;
+    uint green = ((color >> 8) & 0xff) * alpha;
+    green = (green + ((green >> 8) & 0xff) + 0x80);
+    green &= 0xff00;
+    return green | t | (alpha << 24);
+}
+
+static int tintAndCompositeScalar(QRgb *destination, const uchar *mask, QRgb color, const QRgb *highlight,
+                                  int x, int width)
+{
+    for (; x < width; x++) {
+        const QRgb tinted = byteMul(color, mask[x]);
+        destination[x] = highlight[x] + byteMul(tinted, qAlpha(~highlight[x]));
+    }
+    return x;
+}
+
+#ifdef SIMD_SSE2
+// Same rounding as byteMul(), on unpacked 16 bit channels
+inline static __m128i byteMulSse2(__m128i channels, __m128i alphas)
+{
+    const __m128i half = _mm_set1_epi16(0x80);
+    __m128i t = _mm_mullo_epi16(channels, alphas);
+    t = _mm_add_epi16(t, _mm_add_epi16(_mm_srli_epi16(t, 8), half));
+    return _mm_srli_epi16(t, 8);
+}
+
+// Alpha of each pixel in all of its four 16 bit channels
+inline static __m128i broadcastAlphas(__m128i channels)
+{
+    return _mm_shufflehi_epi16(_mm_shufflelo_epi16(channels, _MM_SHUFFLE(3, 3, 3, 3)), _MM_SHUFFLE(3, 3, 3, 3));
+}
+
+static void tintAndCompositeSse2(QRgb *destination, const uchar *mask, QRgb color, const QRgb *highlight, int width)
+{
+    const __m128i zero = _mm_setzero_si128();
+    const __m128i opaque = _mm_set1_epi16(0xff);
+    const __m128i colorChannels = _mm_unpacklo_epi8(_mm_set1_epi32(int(color)), zero);
+    int x = 0;
+    for (; x + 3 < width; x += 4) {
+        int maskBytes;
+        memcpy(&maskBytes, mask + x, 4);
+        __m128i maskAlphas = _mm_unpacklo_epi8(_mm_cvtsi32_si128(maskBytes), zero);
+        maskAlphas = _mm_unpacklo_epi16(maskAlphas, maskAlphas);
+        const __m128i maskAlphasLow = _mm_unpacklo_epi32(maskAlphas, maskAlphas);
+        const __m128i maskAlphasHigh = _mm_unpackhi_epi32(maskAlphas, maskAlphas);
+
+        const __m128i highlightPixels = _mm_loadu_si128(reinterpret_cast<const __m128i*>(highlight + x));
+        const __m128i highlightLow = _mm_unpacklo_epi8(highlightPixels, zero);
+        const __m128i highlightHigh = _mm_unpackhi_epi8(highlightPixels, zero);
+
+        const __m128i tintedLow = byteMulSse2(colorChannels, maskAlphasLow);
+        const __m128i tintedHigh = byteMulSse2(colorChannels, maskAlphasHigh);
+        const __m128i resultLow = _mm_add_epi16(highlightLow,
+                byteMulSse2(tintedLow, _mm_sub_epi16(opaque, broadcastAlphas(highlightLow))));
+        const __m128i resultHigh = _mm_add_epi16(highlightHigh,
+                byteMulSse2(tintedHigh, _mm_sub_epi16(opaque, broadcastAlphas(highlightHigh))));
+        _mm_storeu_si128(reinterpret_cast<__m128i*>(destination + x), _mm_packus_epi16(resultLow, resultHigh));
+    }
+    tintAndCompositeScalar(destination, mask, color, highlight, x, width);
+}
+#endif // SIMD_SSE2
+
+void tintAndComposite(QImage *destination, const QImage &alphaMask, QRgb premultipliedColor, const QImage &highlight,
+                      ColorTintImplementation implementation)
+{
+    Q_ASSERT(colorTintImplementationSupported(implementation));
+    Q_ASSERT(destination->format() == QImage::Format_ARGB32_Premultiplied);
+    Q_ASSERT(highlight.format() == QImage::Format_ARGB32_Premultiplied);
+    Q_ASSERT(alphaMask.format() == QImage::Format_Indexed8);
+    Q_ASSERT(destination->size() == alphaMask.size() && destination->size() == highlight.size());
+    const int width = destination->width();
+    for (int y = 0; y < destination->height(); y++) {
+        QRgb *destinationLine = reinterpret_cast<QRgb*>(destination->scanLine(y));
+        const uchar *maskLine = alphaMask.constScanLine(y);
+        const QRgb *highlightLine = reinterpret_cast<const QRgb*>(highlight.constScanLine(y));
+        switch (implementation) {
+#ifdef SIMD_SSE2
+        case ColorTintImplementationSse2:
+            tintAndCompositeSse2(destinationLine, maskLine, premultipliedColor, highlightLine, width);
+            break;
+#endif
+        default:
+            tintAndCompositeScalar(destinationLine, maskLine, premultipliedColor, highlightLine, 0, width);
+            break;
+        }
+    }
+}
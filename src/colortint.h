@@ -0,0 +1,50 @@
+/*
+    Touch'n'learn - Fun and easy mobile lessons for kids
+    Copyright (C) 2010, 2011 by Alessandro Portale
+    http://touchandlearn.sourceforge.net
+
+    This file is part of Touch'n'learn
+
+    Touch'n'learn is free software; you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    Touch'n'learn is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with Touch'n'learn; if not, write to the Free Software
+    Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA 02110-1301 USA
+*/
+
+#ifndef COLORTINT_H
+#define COLORTINT_H
+
+#include <QtGui/QImage>
+
+enum ColorTintImplementation {
+    ColorTintImplementationScalar,
+    ColorTintImplementationSse2
+};
+
+bool colorTintImplementationSupported(ColorTintImplementation implementation);
+ColorTintImplementation fastestColorTintImplementation();
+
+// Alpha channel of a premultiplied image, as Format_Indexed8 image
+QImage alphaMask(const QImage &image);
+
+// The color as QPainter premultiplies it for solid fills
+QRgb premultipliedColor(QRgb color);
+
+// Fills the destination with the premultiplied color, masked by the alpha
+// mask, and blends the premultiplied highlight on top (source over). The
+// result is exactly what QPainter's SourceIn and SourceOver produce.
+// Destination and highlight are of Format_ARGB32_Premultiplied, and all
+// three images have the same size. All implementations have the same output.
+void tintAndComposite(QImage *destination, const QImage &alphaMask, QRgb premultipliedColor, const QImage &highlight,
+                      ColorTintImplementation implementation);
+
+#endif // COLORTINT_H
@@ -0,0 +1,109 @@
+/*
+    Touch'n'learn - Fun and easy mobile lessons for kids
+    Copyright (C) 2010, 2011 by Alessandro Portale
+    http://touchandlearn.sourceforge.net
+
+    This file is part of Touch'n'learn
+
+    Touch'n'learn is free software; you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    Touch'n'learn is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with Touch'n'learn; if not, write to the Free Software
+    Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA 02110-1301 USA
+*/
+
+#include "displaylist.h"
+#include <QtCore/QCryptographicHash>
+#include <QtCore/QDataStream>
+#include <QtCore/QDebug>
+#include <QtCore/QFile>
+#include <QtGui/QPainter>
+#include <QtGui/QPicture>
+#include <QtSvg/QSvgRenderer>
+
+static const quint32 displayListFileMagic = 0x534c4e44; // "DNLS"
+static const quint32 displayListFileVersion = 1;
+
+DisplayList compiledDisplayList(QSvgRenderer *renderer, const QString &elementId)
+{
+    DisplayList result;
+    result.bounds = renderer->boundsOnElement(elementId);
+    QPicture picture;
+    QPainter p(&picture);
+    renderer->render(&p, elementId, result.bounds);
+    p.end();
+    result.pictureData = QByteArray(picture.data(), picture.size());
+    return result;
+}
+
+void replayDisplayList(QPainter *painter, QPicture *picture, const QRectF &bounds, const QRectF &target)
+{
+    if (bounds.width() <= 0 || bounds.height() <= 0)
+        return;
+    painter->save();
+    painter->translate(target.topLeft());
+    painter->scale(target.width() / bounds.width(), target.height() / bounds.height());
+    painter->translate(-bounds.topLeft());
+    painter->drawPicture(0, 0, *picture);
+    painter->restore();
+}
+
+quint64 svgDocumentHash(const QByteArray &svgDocument)
+{
+    const QByteArray md5 = QCryptographicHash::hash(svgDocument, QCryptographicHash::Md5);
+    quint64 result = 0;
+    for (int byte = 0; byte < 8; byte++)
+        result = (result << 8) | quint8(md5.at(byte));
+    return result;
+}
+
+bool readDisplayLists(const QString &fileName, quint64 sourceHash, DisplayLists *displayLists)
+{
+    QFile file(fileName);
+    if (!file.open(QIODevice::ReadOnly))
+        return false;
+    QDataStream stream(&file);
+    stream.setVersion(QDataStream::Qt_4_7);
+    quint32 magic;
+    quint32 version;
+    quint64 fileSourceHash;
+    stream >> magic >> version >> fileSourceHash;
+    if (magic != displayListFileMagic || version != displayListFileVersion || fileSourceHash != sourceHash)
+        return false;
+    quint32 count;
+    stream >> count;
+    DisplayLists result;
+    for (quint32 i = 0; i < count && stream.status() == QDataStream::Ok; i++) {
+        QString elementId;
+        DisplayList displayList;
+        stream >> elementId >> displayList.bounds >> displayList.pictureData;
+        result.insert(elementId, displayList);
+    }
+    if (stream.status() != QDataStream::Ok) {
+        qDebug() << "****************** Corrupt display list file:" << fileName;
+        return false;
+    }
+    *displayLists = result;
+    return true;
+}
+
+bool writeDisplayLists(const QString &fileName, quint64 sourceHash, const DisplayLists &displayLists)
+{
+    QFile file(fileName);
+    if (!file.open(QIODevice::WriteOnly))
+        return false;
+    QDataStream stream(&file);
+    stream.setVersion(QDataStream::Qt_4_7);
+    stream << displayListFileMagic << displayListFileVersion << sourceHash << quint32(displayLists.count());
+    for (DisplayLists::const_iterator it = displayLists.constBegin(); it != displayLists.constEnd(); ++it)
+        stream << it.key() << it.value().bounds << it.value().pictureData;
+    return stream.status() == QDataStream::Ok;
+}
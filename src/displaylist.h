@@ -0,0 +1,58 @@
+/*
+    Touch'n'learn - Fun and easy mobile lessons for kids
+    Copyright (C) 2010, 2011 by Alessandro Portale
+    http://touchandlearn.sourceforge.net
+
+    This file is part of Touch'n'learn
+
+    Touch'n'learn is free software; you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    Touch'n'learn is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with Touch'n'learn; if not, write to the Free Software
+    Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA 02110-1301 USA
+*/
+
+#ifndef DISPLAYLIST_H
+#define DISPLAYLIST_H
+
+#include <QtCore/QHash>
+#include <QtCore/QRectF>
+#include <QtCore/QString>
+
+class QPainter;
+class QPicture;
+class QSvgRenderer;
+
+// Paint commands of an SVG element, recorded once from QSvgRenderer into
+// QPicture data. Replaying them skips the node tree traversal and the
+// style resolution of QSvgRenderer.
+struct DisplayList
+{
+    QRectF bounds;
+    QByteArray pictureData;
+};
+
+typedef QHash<QString, DisplayList> DisplayLists;
+
+DisplayList compiledDisplayList(QSvgRenderer *renderer, const QString &elementId);
+
+// Maps the bounds of the element to the target rect, like QSvgRenderer::render().
+// QPicture::play() is not reentrant, each thread needs its own QPicture.
+void replayDisplayList(QPainter *painter, QPicture *picture, const QRectF &bounds, const QRectF &target);
+
+// Hash of the contents of an SVG file
+quint64 svgDocumentHash(const QByteArray &svgDocument);
+
+// Display list files belong to the SVG file with the given source hash
+bool readDisplayLists(const QString &fileName, quint64 sourceHash, DisplayLists *displayLists);
+bool writeDisplayLists(const QString &fileName, quint64 sourceHash, const DisplayLists &displayLists);
+
+#endif // DISPLAYLIST_H
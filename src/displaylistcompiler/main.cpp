@@ -0,0 +1,76 @@
+/*
+    Touch'n'learn - Fun and easy mobile lessons for kids
+    Copyright (C) 2010, 2011 by Alessandro Portale
+    http://touchandlearn.sourceforge.net
+
+    This file is part of Touch'n'learn
+
+    Touch'n'learn is free software; you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    Touch'n'learn is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with Touch'n'learn; if not, write to the Free Software
+    Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA 02110-1301 USA
+*/
+
+#include <QtCore/QFile>
+#include <QtCore/QStringList>
+#include <QtCore/QTextStream>
+#include <QtGui/QApplication>
+#include <QtSvg/QSvgRenderer>
+
+#include "displaylist.h"
+#include "svgelementindex.h"
+
+// The SVG files whose elements the ImageProvider draws via display lists
+static const char* const svgFileBaseNames[] = {
+    "design",
+    "objects",
+    "countables",
+    "lessonicons"
+};
+
+int main(int argc, char *argv[])
+{
+    QApplication app(argc, argv);
+    QTextStream out(stdout);
+    const QStringList arguments = app.arguments();
+    if (arguments.count() != 2) {
+        out << "Usage: displaylistcompiler <graphics directory>" << endl;
+        return 1;
+    }
+    const QString idPrefix = QLatin1String("id_");
+    const QString rectSuffix = QLatin1String("_rect");
+    for (size_t i = 0; i < sizeof svgFileBaseNames / sizeof svgFileBaseNames[0]; i++) {
+        const QString basePath = arguments.at(1) + QLatin1Char('/') + QLatin1String(svgFileBaseNames[i]);
+        QFile svgFile(basePath + QLatin1String(".svg"));
+        if (!svgFile.open(QIODevice::ReadOnly)) {
+            out << "Could not read " << svgFile.fileName() << endl;
+            return 1;
+        }
+        const QByteArray svgDocument = svgFile.readAll();
+        QSvgRenderer renderer(svgDocument);
+        SvgElementIndex index;
+        index.build(svgDocument, &renderer, idPrefix);
+        DisplayLists displayLists;
+        foreach (const QString &name, index.elementNames()) {
+            if (name.endsWith(rectSuffix)) // Only defines bounds
+                continue;
+            displayLists.insert(name, compiledDisplayList(&renderer, idPrefix + name));
+        }
+        const QString displayListFileName = basePath + QLatin1String(".displaylist");
+        if (!writeDisplayLists(displayListFileName, svgDocumentHash(svgDocument), displayLists)) {
+            out << "Could not write " << displayListFileName << endl;
+            return 1;
+        }
+        out << displayListFileName << ": " << displayLists.count() << " elements" << endl;
+    }
+    return 0;
+}
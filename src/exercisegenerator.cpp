@@ -0,0 +1,125 @@
+/*
+    Touch'n'learn - Fun and easy mobile lessons for kids
+    Copyright (C) 2010, 2011 by Alessandro Portale
+    http://touchandlearn.sourceforge.net
+
+    This file is part of Touch'n'learn
+
+    Touch'n'learn is free software; you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    Touch'n'learn is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with Touch'n'learn; if not, write to the Free Software
+    Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA 02110-1301 USA
+*/
+
+#include "exercisegenerator.h"
+#include <QtCore/QDateTime>
+
+ExerciseGenerator::ExerciseGenerator(QObject *parent)
+    : QObject(parent)
+{
+    setSeed(quint32(QDateTime::currentMSecsSinceEpoch()));
+}
+
+void ExerciseGenerator::setSeed(quint32 seed)
+{
+    m_randomState = seed;
+}
+
+int ExerciseGenerator::random(int bound)
+{
+    m_randomState = m_randomState * 1664525 + 1013904223;
+    return int((quint64(m_randomState >> 8) * bound) >> 24);
+}
+
+void ExerciseGenerator::moveToFront(PoolHistory &history, int index, int &front) const
+{
+    const int position = history.positions.at(index);
+    if (position < front)
+        return;
+    const int frontIndex = history.order.at(front);
+    history.order[front] = index;
+    history.order[position] = frontIndex;
+    history.positions[index] = front;
+    history.positions[frontIndex] = position;
+    front++;
+}
+
+QVariantList ExerciseGenerator::createExercises(const QString &pool, int poolSize, int answersCount, int count)
+{
+    QVariantList result;
+    if (poolSize < answersCount || answersCount < 1)
+        return result;
+    PoolHistory &history = m_histories[pool];
+    if (history.order.count() != poolSize) {
+        history = PoolHistory();
+        history.order.resize(poolSize);
+        history.positions.resize(poolSize);
+        for (int i = 0; i < poolSize; i++)
+            history.order[i] = history.positions[i] = i;
+    }
+    if (history.previousAnswers.count() != answersCount)
+        history.previousAnswers.clear();
+    // The correct answer is not among the last half of the pool
+    const int recentCorrectAnswersCount = qRound(poolSize * 0.5);
+
+    for (int exercise = 0; exercise < count; exercise++) {
+        QVector<int> answers(answersCount);
+        const int correctAnswerIndex = random(answersCount);
+        int front = 0;
+        for (int i = 0; i < history.recentCorrectAnswers.count(); i++)
+            moveToFront(history, history.recentCorrectAnswers.at(i), front);
+        if (!history.previousAnswers.isEmpty())
+            moveToFront(history, history.previousAnswers.at(correctAnswerIndex), front);
+        // Small pools run out of answers. Only the previous position is then excluded.
+        if (front >= poolSize) {
+            front = 0;
+            if (!history.previousAnswers.isEmpty() && poolSize > 1)
+                moveToFront(history, history.previousAnswers.at(correctAnswerIndex), front);
+        }
+        const int correctAnswer = history.order.at(front + random(poolSize - front));
+        answers[correctAnswerIndex] = correctAnswer;
+
+        // Chosen answers stay in front, the previous answer at the current
+        // position is excluded for one draw only
+        front = 0;
+        moveToFront(history, correctAnswer, front);
+        for (int j = 0; j < answersCount; j++) {
+            if (j == correctAnswerIndex)
+                continue;
+            int drawFront = front;
+            if (!history.previousAnswers.isEmpty() && drawFront < poolSize - 1)
+                moveToFront(history, history.previousAnswers.at(j), drawFront);
+            const int answer = history.order.at(drawFront + random(poolSize - drawFront));
+            moveToFront(history, answer, front);
+            answers[j] = answer;
+        }
+
+        history.previousAnswers = answers;
+        history.recentCorrectAnswers.append(correctAnswer);
+        if (history.recentCorrectAnswers.count() > recentCorrectAnswersCount)
+            history.recentCorrectAnswers.remove(0);
+
+        QVariantList answersList;
+        for (int j = 0; j < answersCount; j++)
+            answersList.append(answers.at(j));
+        QVariantMap exerciseMap;
+        exerciseMap.insert(QLatin1String("correctAnswerIndex"), correctAnswerIndex);
+        exerciseMap.insert(QLatin1String("answers"), answersList);
+        result.append(exerciseMap);
+    }
+    return result;
+}
+
+void ExerciseGenerator::reset()
+{
+    m_histories.clear();
+}
@@ -0,0 +1,69 @@
+/*
+    Touch'n'learn - Fun and easy mobile lessons for kids
+    Copyright (C) 2010, 2011 by Alessandro Portale
+    http://touchandlearn.sourceforge.net
+
+    This file is part of Touch'n'learn
+
+    Touch'n'learn is free software; you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    Touch'n'learn is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with Touch'n'learn; if not, write to the Free Software
+    Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA 02110-1301 USA
+*/
+
+#ifndef EXERCISEGENERATOR_H
+#define EXERCISEGENERATOR_H
+
+#include <QtCore/QHash>
+#include <QtCore/QObject>
+#include <QtCore/QVariant>
+#include <QtCore/QVector>
+
+// Picks the answers of multiple choice exercises from a pool of possible
+// answers, without rejection sampling. The correct answer is not one of the
+// recent correct answers of the pool, and no answer is at the same position
+// as in the previous exercise of the pool.
+class ExerciseGenerator : public QObject
+{
+    Q_OBJECT
+
+public:
+    explicit ExerciseGenerator(QObject *parent = 0);
+
+    void setSeed(quint32 seed);
+
+    // Returns 'count' maps with the "correctAnswerIndex" and the pool indexes
+    // of the "answers". Consecutive calls for the same pool continue its
+    // history.
+    Q_INVOKABLE QVariantList createExercises(const QString &pool, int poolSize, int answersCount, int count);
+    // Forgets the history of all pools
+    Q_INVOKABLE void reset();
+
+private:
+    struct PoolHistory
+    {
+        QVector<int> previousAnswers;
+        QVector<int> recentCorrectAnswers; // Oldest first
+        // Permutation of the pool indexes and its inverse. Excluded indexes
+        // are swapped to the front, the draw is from the rest.
+        QVector<int> order;
+        QVector<int> positions;
+    };
+
+    int random(int bound);
+    void moveToFront(PoolHistory &history, int index, int &front) const;
+
+    QHash<QString, PoolHistory> m_histories;
+    quint32 m_randomState;
+};
+
+#endif // EXERCISEGENERATOR_H
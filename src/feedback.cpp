@@ -21,15 +21,22 @@
 */
 
 #include "feedback.h"
+#include "tracer.h"
 #include <QtCore/QDir>
+#include <QtCore/QRunnable>
+#include <QtCore/QStringList>
 #include <QtCore/QTimer>
 
-#ifdef USING_QT_MOBILITY
+#if defined(USING_PCM_MIXER)
+#include "audiomixer.h"
+#include "audiooutputsink.h"
+#include "midisynth.h"
+#elif defined(USING_QT_MOBILITY)
 #include <QMediaPlayer>
-#else // USING_QT_MOBILITY
+#else // USING_PCM_MIXER
 #include <phonon/MediaObject>
 #include <phonon/AudioOutput>
-#endif // USING_QT_MOBILITY
+#endif // USING_PCM_MIXER
 
 static QString dataPath = QLatin1String("data");
 
@@ -117,19 +124,89 @@ VolumeKeyListener::VolumeKeyListener(Feedback *feedback)
 }
 #endif // Q_OS_SYMBIAN
 
+// Filled on a worker thread, handed over via handleSoundsLoaded()
+struct LoadedSounds
+{
+#if defined(USING_PCM_MIXER)
+    QList<PcmClip> correctSounds;
+    QList<PcmClip> incorrectSounds;
+#else // USING_PCM_MIXER
+    QStringList correctSounds;
+    QStringList incorrectSounds;
+#endif // USING_PCM_MIXER
+};
+
+class LoadSoundsTask : public QRunnable
+{
+public:
+    LoadSoundsTask(Feedback *feedback, LoadedSounds *sounds)
+        : m_feedback(feedback)
+        , m_sounds(sounds)
+    { }
+
+    void run()
+    {
+        {
+            TraceSpan span("audio", QLatin1String("load"));
+            const QDir path(dataPath);
+#if defined(USING_PCM_MIXER)
+            // Rendered or decoded once, playing a sound only starts a mixer voice
+            const QStringList filters = QStringList() << QLatin1String("*.mid") << QLatin1String("*.wav");
+            foreach (const QFileInfo &soundFile, path.entryInfoList(filters, QDir::Files, QDir::Name)) {
+                const PcmClip clip = soundFile.suffix() == QLatin1String("mid")
+                        ? loadMidi(soundFile.absoluteFilePath(), AudioMixer::SampleRate)
+                        : loadWav(soundFile.absoluteFilePath(), AudioMixer::SampleRate);
+                if (clip.isEmpty())
+                    continue;
+                if (soundFile.fileName().startsWith(QLatin1String("correct")))
+                    m_sounds->correctSounds.append(clip);
+                else if (soundFile.fileName().startsWith(QLatin1String("incorrect")))
+                    m_sounds->incorrectSounds.append(clip);
+            }
+#else // USING_PCM_MIXER
+            foreach (const QFileInfo &midiFile, path.entryInfoList(QDir::Files)) {
+                if (midiFile.fileName().startsWith(QLatin1String("correct")))
+                    m_sounds->correctSounds.append(midiFile.absoluteFilePath());
+                else if (midiFile.fileName().startsWith(QLatin1String("incorrect")))
+                    m_sounds->incorrectSounds.append(midiFile.absoluteFilePath());
+            }
+#endif // USING_PCM_MIXER
+        }
+        QMetaObject::invokeMethod(m_feedback, "handleSoundsLoaded", Qt::QueuedConnection);
+    }
+
+private:
+    Feedback *m_feedback;
+    LoadedSounds *m_sounds;
+};
+
 Feedback::Feedback(QObject *parent)
     : QObject(parent)
-    , m_previousCorrectSound(0)
-    , m_previousIncorrectSound(0)
+#if defined(USING_PCM_MIXER)
+    , m_mixer(new AudioMixer)
+    , m_sink(0)
+#endif // USING_PCM_MIXER
+    , m_previousCorrectSound(-1)
+    , m_previousIncorrectSound(-1)
     , m_audioVolume(100)
+    , m_loadedSounds(new LoadedSounds)
+    , m_ready(false)
 {
+    m_loader.start(new LoadSoundsTask(this, m_loadedSounds));
     QTimer::singleShot(1, this, SLOT(init()));
 }
 
 Feedback::~Feedback()
 {
+    m_loader.waitForDone();
+    delete m_loadedSounds;
+#if defined(USING_PCM_MIXER)
+    delete m_sink;
+    delete m_mixer;
+#else // USING_PCM_MIXER
     qDeleteAll(m_correctSounds);
     qDeleteAll(m_incorrectSounds);
+#endif // USING_PCM_MIXER
 }
 
 void Feedback::setDataPath(const QString &path)
@@ -137,6 +214,11 @@ void Feedback::setDataPath(const QString &path)
     dataPath = path;
 }
 
+bool Feedback::isReady() const
+{
+    return m_ready;
+}
+
 int Feedback::audioVolume() const
 {
     return m_audioVolume;
@@ -149,27 +231,41 @@ void Feedback::setAudioVolume(int volume, bool emitChangedSignal)
         emit volumeChanged(m_audioVolume);
 }
 
-#ifdef USING_QT_MOBILITY
-static void playSound(const QList<QMediaPlayer*> &sounds, QMediaPlayer* &previousSound, int volume)
+// Returns -1 if there is no sound
+static int soundIndex(int soundsCount, int &previousSound)
 {
-    if (sounds.isEmpty())
-        return;
+    if (soundsCount <= 1)
+        return soundsCount - 1;
+    int index;
+    do {
+        index = qrand() % soundsCount;
+    } while (index == previousSound);
+    previousSound = index;
+    return index;
+}
 
-    QMediaPlayer *currentSound = 0;
-    if (sounds.count() == 1) {
-        currentSound = sounds.first();
-    } else {
-        do {
-            const int index = qrand() % sounds.count();
-            currentSound = sounds.at(index);
-        } while (currentSound == previousSound);
-        previousSound = currentSound;
-    }
-    currentSound->setVolume(volume);
-    currentSound->stop();
-    currentSound->play();
+#if defined(USING_PCM_MIXER)
+static void playSound(AudioMixer *mixer, const QList<PcmClip> &sounds, int &previousSound, int volume)
+{
+    const int index = soundIndex(sounds.count(), previousSound);
+    if (index < 0)
+        return;
+    // A second sound is mixed in, instead of cutting off the first one
+    mixer->play(&sounds.at(index), volume);
 }
 
+// TOUCHANDLEARN_AUDIO_SINK may be "null" or "wav:<file name>" for running
+// without a sound device
+static AudioSink *audioSink(AudioMixer *mixer)
+{
+    const QString sink = QString::fromLocal8Bit(qgetenv("TOUCHANDLEARN_AUDIO_SINK"));
+    if (sink == QLatin1String("null"))
+        return new NullAudioSink(mixer);
+    if (sink.startsWith(QLatin1String("wav:")))
+        return new WavFileAudioSink(mixer, sink.mid(4));
+    return new AudioOutputSink(mixer);
+}
+#elif defined(USING_QT_MOBILITY)
 static QMediaPlayer *player(const QString &file)
 {
     QMediaPlayer *result = new QMediaPlayer;
@@ -177,29 +273,21 @@ static QMediaPlayer *player(const QString &file)
     result->setMedia(content);
     return result;
 }
-#else // USING_QT_MOBILITY
-static void playSound(const QList<Phonon::MediaObject*> &sounds, Phonon::MediaObject* &previousSound, int volume)
-{
-    Q_UNUSED(volume)
 
-    if (sounds.isEmpty())
+// Players are created when their sound is played the first time
+static void playSound(const QStringList &files, QList<QMediaPlayer*> &sounds, int &previousSound, int volume)
+{
+    const int index = soundIndex(files.count(), previousSound);
+    if (index < 0)
         return;
-
-    Phonon::MediaObject *currentSound = 0;
-    if (sounds.count() == 1) {
-        currentSound = sounds.first();
-    } else {
-        do {
-            const int index = qrand() % sounds.count();
-            currentSound = sounds.at(index);
-        } while (currentSound == previousSound);
-        previousSound = currentSound;
-    }
+    if (!sounds.at(index))
+        sounds[index] = player(files.at(index));
+    QMediaPlayer *currentSound = sounds.at(index);
+    currentSound->setVolume(volume);
     currentSound->stop();
-    currentSound->seek(0);
     currentSound->play();
 }
-
+#else // USING_PCM_MIXER
 static Phonon::MediaObject *player(const QString &file)
 {
     Phonon::MediaObject *result = new Phonon::MediaObject();
@@ -208,28 +296,68 @@ static Phonon::MediaObject *player(const QString &file)
     Phonon::createPath(result, audioOutput);
     return result;
 }
-#endif // USING_QT_MOBILITY
+
+// Players are created when their sound is played the first time
+static void playSound(const QStringList &files, QList<Phonon::MediaObject*> &sounds, int &previousSound, int volume)
+{
+    Q_UNUSED(volume)
+
+    const int index = soundIndex(files.count(), previousSound);
+    if (index < 0)
+        return;
+    if (!sounds.at(index))
+        sounds[index] = player(files.at(index));
+    Phonon::MediaObject *currentSound = sounds.at(index);
+    currentSound->stop();
+    currentSound->seek(0);
+    currentSound->play();
+}
+#endif // USING_PCM_MIXER
 
 void Feedback::init()
 {
     new VolumeKeyListener(this);
-    const QDir path(dataPath);
-    foreach (const QFileInfo &midiFile, path.entryInfoList(QDir::Files)) {
-        if (midiFile.fileName().startsWith(QLatin1String("correct")))
-            m_correctSounds.append(player(midiFile.absoluteFilePath()));
-        else if (midiFile.fileName().startsWith(QLatin1String("incorrect")))
-            m_incorrectSounds.append(player(midiFile.absoluteFilePath()));
-    }
 }
 
+void Feedback::handleSoundsLoaded()
+{
+    TraceSpan span("audio", QLatin1String("ready"));
+#if defined(USING_PCM_MIXER)
+    m_correctSounds = m_loadedSounds->correctSounds;
+    m_incorrectSounds = m_loadedSounds->incorrectSounds;
+    m_sink = audioSink(m_mixer);
+    m_sink->start();
+#else // USING_PCM_MIXER
+    m_correctSoundFiles = m_loadedSounds->correctSounds;
+    m_incorrectSoundFiles = m_loadedSounds->incorrectSounds;
+    for (int i = 0; i < m_correctSoundFiles.count(); i++)
+        m_correctSounds.append(0);
+    for (int i = 0; i < m_incorrectSoundFiles.count(); i++)
+        m_incorrectSounds.append(0);
+#endif // USING_PCM_MIXER
+    m_ready = true;
+    emit ready();
+}
+
+// Before the sounds are loaded, nothing is played
 void Feedback::playCorrectSound() const
 {
-    playSound(m_correctSounds, m_previousCorrectSound, m_audioVolume);
+    TraceSpan span("feedback", QLatin1String("correct"));
+#if defined(USING_PCM_MIXER)
+    playSound(m_mixer, m_correctSounds, m_previousCorrectSound, m_audioVolume);
+#else // USING_PCM_MIXER
+    playSound(m_correctSoundFiles, m_correctSounds, m_previousCorrectSound, m_audioVolume);
+#endif // USING_PCM_MIXER
 }
 
 void Feedback::playIncorrectSound() const
 {
-    playSound(m_incorrectSounds, m_previousIncorrectSound, m_audioVolume);
+    TraceSpan span("feedback", QLatin1String("incorrect"));
+#if defined(USING_PCM_MIXER)
+    playSound(m_mixer, m_incorrectSounds, m_previousIncorrectSound, m_audioVolume);
+#else // USING_PCM_MIXER
+    playSound(m_incorrectSoundFiles, m_incorrectSounds, m_previousIncorrectSound, m_audioVolume);
+#endif // USING_PCM_MIXER
 }
 
 void VolumeKeyListener::volumeUp()
@@ -24,14 +24,22 @@
 #define FEEDBACK_H
 
 #include <QtCore/QObject>
+#include <QtCore/QStringList>
+#include <QtCore/QThreadPool>
 #include <QtCore/QVariant>
+#include <QtCore/QVector>
 
+class AudioMixer;
+class AudioSink;
+struct LoadedSounds;
 class QMediaPlayer;
 namespace Phonon {
     class MediaObject;
     class AudioOutput;
 }
 
+// Sound files are found, and decoded with USING_PCM_MIXER, on a worker
+// thread. Sounds requested before ready() are dropped.
 class Feedback : public QObject
 {
     Q_OBJECT
@@ -42,6 +50,7 @@ public:
 
     Q_INVOKABLE void playCorrectSound() const;
     Q_INVOKABLE void playIncorrectSound() const;
+    Q_INVOKABLE bool isReady() const;
 
     int audioVolume() const;
     Q_INVOKABLE void setAudioVolume(int volume, bool emitChangedSignal = true);
@@ -49,23 +58,35 @@ public:
 
 signals:
     void volumeChanged(QVariant volume);
+    void ready();
 
 private slots:
     void init();
+    void handleSoundsLoaded();
 
 private:
-#ifdef USING_QT_MOBILITY
-    QList<QMediaPlayer*> m_correctSounds;
-    mutable QMediaPlayer *m_previousCorrectSound;
-    QList<QMediaPlayer*> m_incorrectSounds;
-    mutable QMediaPlayer *m_previousIncorrectSound;
+#if defined(USING_PCM_MIXER)
+    QList<QVector<qint16> > m_correctSounds;
+    QList<QVector<qint16> > m_incorrectSounds;
+    AudioMixer *m_mixer;
+    AudioSink *m_sink;
+#elif defined(USING_QT_MOBILITY)
+    QStringList m_correctSoundFiles;
+    mutable QList<QMediaPlayer*> m_correctSounds;
+    QStringList m_incorrectSoundFiles;
+    mutable QList<QMediaPlayer*> m_incorrectSounds;
 #else
-    QList<Phonon::MediaObject*> m_correctSounds;
-    mutable Phonon::MediaObject *m_previousCorrectSound;
-    QList<Phonon::MediaObject*> m_incorrectSounds;
-    mutable Phonon::MediaObject *m_previousIncorrectSound;
+    QStringList m_correctSoundFiles;
+    mutable QList<Phonon::MediaObject*> m_correctSounds;
+    QStringList m_incorrectSoundFiles;
+    mutable QList<Phonon::MediaObject*> m_incorrectSounds;
 #endif // USING_QT_MOBILITY
+    mutable int m_previousCorrectSound;
+    mutable int m_previousIncorrectSound;
     int m_audioVolume;
+    LoadedSounds *m_loadedSounds;
+    bool m_ready;
+    QThreadPool m_loader;
 };
 
 #endif // FEEDBACK_H
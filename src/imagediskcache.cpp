@@ -0,0 +1,374 @@
+/*
+    Touch'n'learn - Fun and easy mobile lessons for kids
+    Copyright (C) 2010, 2011 by Alessandro Portale
+    http://touchandlearn.sourceforge.net
+
+    This file is part of Touch'n'learn
+
+    Touch'n'learn is free software; you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    Touch'n'learn is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with Touch'n'learn; if not, write to the Free Software
+    Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA 02110-1301 USA
+*/
+
+#include "imagediskcache.h"
+#include <QtCore/QDebug>
+#include <QtCore/QDir>
+#include <QtCore/QFile>
+#include <QtCore/QFileInfo>
+#include <QtCore/QPair>
+#include <string.h>
+
+// The file is only read on the device which wrote it, therefore everything
+// is stored in host byte order. A foreign byte order fails the magic check.
+static const quint32 cacheFileMagic = 0x434c4e54; // "TNLC"
+static const quint32 cacheFileVersion = 1;
+static const int dataAlignment = 16;
+// New images which are kept in memory until save() writes them
+static const qint64 maxNewEntriesBytes = 4 * 1024 * 1024;
+
+struct FileHeader
+{
+    quint32 magic;
+    quint32 version;
+    quint32 entryCount;
+    quint32 reserved;
+};
+
+struct ImageDiskCache::FileEntry
+{
+    quint64 sourceHash;
+    quint32 keyOffset; // Bytes from the start of the file
+    quint32 keyLength; // QChars
+    quint32 dataOffset;
+    quint32 dataSize;
+    qint32 width;
+    qint32 height;
+    qint32 bytesPerLine;
+    qint32 format;
+    qint32 originalWidth;
+    qint32 originalHeight;
+};
+
+// A mapped cache file, and the images which were returned from it. The
+// file is unmapped once only the mapping itself refers to them.
+struct ImageDiskCache::Mapping
+{
+    Mapping(const QString &fileName)
+        : file(fileName)
+        , data(0)
+        , size(0)
+    { }
+
+    bool isReferenced() const
+    {
+        foreach (const QImage &image, images)
+            if (!image.isDetached())
+                return true;
+        return false;
+    }
+
+    QFile file;
+    const uchar *data;
+    qint64 size;
+    QHash<const FileEntry*, QImage> images;
+};
+
+struct ImageDiskCache::Entry
+{
+    quint64 sourceHash;
+    QImage image;
+    QSize originalSize;
+};
+
+ImageDiskCache::ImageDiskCache()
+    : m_loaded(false)
+    , m_dirty(false)
+    , m_maxBytes(32 * 1024 * 1024)
+    , m_mapping(0)
+    , m_newEntriesBytes(0)
+{
+}
+
+ImageDiskCache::~ImageDiskCache()
+{
+    qDeleteAll(m_newEntries);
+    delete m_mapping;
+    qDeleteAll(m_retiredMappings);
+}
+
+void ImageDiskCache::setFileName(const QString &fileName)
+{
+    QMutexLocker locker(&m_mutex);
+    Q_ASSERT_X(!m_loaded, "ImageDiskCache::setFileName", "Cache file was already loaded");
+    m_fileName = fileName;
+}
+
+void ImageDiskCache::setMaxBytes(int bytes)
+{
+    QMutexLocker locker(&m_mutex);
+    m_maxBytes = bytes;
+}
+
+void ImageDiskCache::load()
+{
+    if (m_loaded)
+        return;
+    m_loaded = true;
+    if (m_fileName.isEmpty())
+        return;
+
+    // A previous save() could not replace the mapped file
+    const QString newFileName = m_fileName + QLatin1String(".new");
+    if (QFile::exists(newFileName)) {
+        QFile::remove(m_fileName);
+        QFile::rename(newFileName, m_fileName);
+    }
+    mapFile(m_fileName);
+}
+
+// Replaces the current mapping. The previous one stays mapped until
+// releaseRetiredMappings() finds it unused. Requires m_mutex to be locked.
+bool ImageDiskCache::mapFile(const QString &fileName)
+{
+    Mapping *newMapping = new Mapping(fileName);
+    const qint64 mappingSize = newMapping->file.open(QIODevice::ReadOnly) ? newMapping->file.size() : 0;
+    const uchar *mapping = 0;
+    if (mappingSize >= qint64(sizeof(FileHeader)))
+        mapping = newMapping->file.map(0, mappingSize);
+    const FileHeader *header = reinterpret_cast<const FileHeader*>(mapping);
+    if (!mapping || header->magic != cacheFileMagic || header->version != cacheFileVersion
+            || sizeof(FileHeader) + quint64(header->entryCount) * sizeof(FileEntry) > quint64(mappingSize)) {
+        if (mapping)
+            qDebug() << "Ignoring invalid image cache file" << fileName;
+        delete newMapping;
+        return false;
+    }
+
+    QHash<QString, const FileEntry*> mappedEntries;
+    const FileEntry *entries = reinterpret_cast<const FileEntry*>(mapping + sizeof(FileHeader));
+    for (quint32 i = 0; i < header->entryCount; i++) {
+        const FileEntry *entry = entries + i;
+        if (quint64(entry->keyOffset) + entry->keyLength * sizeof(QChar) > quint64(mappingSize)
+                || quint64(entry->dataOffset) + entry->dataSize > quint64(mappingSize)
+                || entry->dataOffset % dataAlignment != 0
+                || entry->width < 1 || entry->height < 1
+                || quint64(entry->bytesPerLine) * entry->height > entry->dataSize)
+            continue;
+        const QString key(reinterpret_cast<const QChar*>(mapping + entry->keyOffset), entry->keyLength);
+        mappedEntries.insert(key, entry);
+    }
+    if (m_mapping)
+        m_retiredMappings.append(m_mapping);
+    newMapping->data = mapping;
+    newMapping->size = mappingSize;
+    m_mapping = newMapping;
+    m_mappedEntries = mappedEntries;
+    return true;
+}
+
+// Unmaps the previous files which no returned image points into anymore.
+// Only save() maps files, the data which it writes stays therefore valid.
+// Requires m_saveMutex and m_mutex to be locked.
+void ImageDiskCache::releaseRetiredMappings()
+{
+    QList<Mapping*>::iterator i = m_retiredMappings.begin();
+    while (i != m_retiredMappings.end()) {
+        if ((*i)->isReferenced()) {
+            ++i;
+        } else {
+            delete *i;
+            i = m_retiredMappings.erase(i);
+        }
+    }
+}
+
+int ImageDiskCache::mappedFileCount() const
+{
+    QMutexLocker locker(&m_mutex);
+    return (m_mapping ? 1 : 0) + m_retiredMappings.count();
+}
+
+QImage ImageDiskCache::image(const QString &key, quint64 sourceHash, QSize *originalSize)
+{
+    QMutexLocker locker(&m_mutex);
+    load();
+    if (const Entry *entry = m_newEntries.value(key)) {
+        if (entry->sourceHash != sourceHash)
+            return QImage();
+        if (originalSize)
+            *originalSize = entry->originalSize;
+        return entry->image;
+    }
+    const FileEntry *entry = m_mappedEntries.value(key);
+    if (!entry || entry->sourceHash != sourceHash)
+        return QImage();
+    if (originalSize)
+        *originalSize = QSize(entry->originalWidth, entry->originalHeight);
+    // Read-only image without copy. Writing to it would detach. The mapping
+    // keeps a copy, to know whether the image is still in use.
+    QImage &image = m_mapping->images[entry];
+    if (image.isNull())
+        image = QImage(m_mapping->data + entry->dataOffset, entry->width, entry->height,
+                       entry->bytesPerLine, QImage::Format(entry->format));
+    return image;
+}
+
+void ImageDiskCache::insert(const QString &key, quint64 sourceHash, const QImage &image, const QSize &originalSize)
+{
+    QMutexLocker locker(&m_mutex);
+    load();
+    if (m_fileName.isEmpty() || image.isNull())
+        return;
+    const FileEntry *mappedEntry = m_mappedEntries.value(key);
+    if (mappedEntry && mappedEntry->sourceHash == sourceHash)
+        return;
+    Entry *previousEntry = m_newEntries.value(key);
+    const qint64 previousBytes = previousEntry ? previousEntry->image.byteCount() : 0;
+    // Further images are only taken after save() wrote these
+    if (m_newEntriesBytes - previousBytes + image.byteCount() > qMin(qint64(m_maxBytes), maxNewEntriesBytes))
+        return;
+    Entry *entry = new Entry;
+    entry->sourceHash = sourceHash;
+    entry->image = image;
+    entry->originalSize = originalSize;
+    delete previousEntry;
+    m_newEntries.insert(key, entry);
+    m_newEntriesBytes += image.byteCount() - previousBytes;
+    m_dirty = true;
+}
+
+inline static quint32 aligned(quint32 offset)
+{
+    return (offset + dataAlignment - 1) / dataAlignment * dataAlignment;
+}
+
+bool ImageDiskCache::save(const QSet<quint64> &validSourceHashes)
+{
+    QMutexLocker saveLocker(&m_saveMutex);
+
+    // The entries are collected while m_mutex is locked, the file is written
+    // without it. Mapped data stays valid, since only save() unmaps files.
+    // The new images are kept by newImages.
+    QString fileName;
+    QList<QPair<QString, FileEntry> > entries;
+    QList<const uchar*> entriesData;
+    QList<QImage> newImages;
+    {
+        QMutexLocker locker(&m_mutex);
+        load();
+        if (m_fileName.isEmpty() || !m_dirty)
+            return true;
+        fileName = m_fileName;
+        m_dirty = false;
+
+        // New images first. Images of the previous file fill up the remaining space.
+        qint64 dataBytes = 0;
+        for (QHash<QString, Entry*>::const_iterator i = m_newEntries.constBegin(); i != m_newEntries.constEnd(); ++i) {
+            const Entry *entry = i.value();
+            if (!validSourceHashes.contains(entry->sourceHash))
+                continue;
+            FileEntry fileEntry;
+            memset(&fileEntry, 0, sizeof(fileEntry));
+            fileEntry.sourceHash = entry->sourceHash;
+            fileEntry.keyLength = i.key().length();
+            fileEntry.dataSize = entry->image.byteCount();
+            fileEntry.width = entry->image.width();
+            fileEntry.height = entry->image.height();
+            fileEntry.bytesPerLine = entry->image.bytesPerLine();
+            fileEntry.format = entry->image.format();
+            fileEntry.originalWidth = entry->originalSize.width();
+            fileEntry.originalHeight = entry->originalSize.height();
+            if (dataBytes + fileEntry.dataSize > m_maxBytes)
+                continue;
+            dataBytes += fileEntry.dataSize;
+            entries.append(qMakePair(i.key(), fileEntry));
+            newImages.append(entry->image);
+            entriesData.append(entry->image.constBits());
+        }
+        for (QHash<QString, const FileEntry*>::const_iterator i = m_mappedEntries.constBegin(); i != m_mappedEntries.constEnd(); ++i) {
+            const FileEntry *fileEntry = i.value();
+            if (m_newEntries.contains(i.key()) || !validSourceHashes.contains(fileEntry->sourceHash)
+                    || dataBytes + fileEntry->dataSize > m_maxBytes)
+                continue;
+            dataBytes += fileEntry->dataSize;
+            entries.append(qMakePair(i.key(), *fileEntry));
+            entriesData.append(m_mapping->data + fileEntry->dataOffset);
+        }
+    }
+
+    quint32 offset = sizeof(FileHeader) + entries.count() * sizeof(FileEntry);
+    for (int i = 0; i < entries.count(); i++) {
+        entries[i].second.keyOffset = offset;
+        offset += entries.at(i).second.keyLength * sizeof(QChar);
+    }
+    for (int i = 0; i < entries.count(); i++) {
+        offset = aligned(offset);
+        entries[i].second.dataOffset = offset;
+        offset += entries.at(i).second.dataSize;
+    }
+
+    QDir().mkpath(QFileInfo(fileName).absolutePath());
+    const QString newFileName = fileName + QLatin1String(".new");
+    QFile file(newFileName);
+    bool written = file.open(QIODevice::WriteOnly | QIODevice::Truncate);
+    if (written) {
+        FileHeader header;
+        memset(&header, 0, sizeof(header));
+        header.magic = cacheFileMagic;
+        header.version = cacheFileVersion;
+        header.entryCount = entries.count();
+        file.write(reinterpret_cast<const char*>(&header), sizeof(header));
+        for (int i = 0; i < entries.count(); i++)
+            file.write(reinterpret_cast<const char*>(&entries.at(i).second), sizeof(FileEntry));
+        for (int i = 0; i < entries.count(); i++)
+            file.write(reinterpret_cast<const char*>(entries.at(i).first.constData()),
+                       entries.at(i).second.keyLength * sizeof(QChar));
+        static const char padding[dataAlignment] = {0};
+        for (int i = 0; i < entries.count(); i++) {
+            file.write(padding, entries.at(i).second.dataOffset - file.pos());
+            file.write(reinterpret_cast<const char*>(entriesData.at(i)), entries.at(i).second.dataSize);
+        }
+        file.close();
+        written = file.error() == QFile::NoError;
+        if (!written)
+            QFile::remove(newFileName);
+    }
+
+    QMutexLocker locker(&m_mutex);
+    if (!written) {
+        m_dirty = true;
+        return false;
+    }
+    // Replacing a mapped file is not possible on every platform. In that
+    // case, load() picks up the new file on the next start, and the new
+    // images stay in memory until then.
+    if ((QFile::remove(fileName) || !QFile::exists(fileName)) && QFile::rename(newFileName, fileName)
+            && mapFile(fileName)) {
+        // Now in the mapping, or stale
+        QHash<QString, Entry*>::iterator i = m_newEntries.begin();
+        while (i != m_newEntries.end()) {
+            const Entry *entry = i.value();
+            const FileEntry *mappedEntry = m_mappedEntries.value(i.key());
+            if ((mappedEntry && mappedEntry->sourceHash == entry->sourceHash)
+                    || !validSourceHashes.contains(entry->sourceHash)) {
+                m_newEntriesBytes -= entry->image.byteCount();
+                delete entry;
+                i = m_newEntries.erase(i);
+            } else {
+                ++i;
+            }
+        }
+    }
+    releaseRetiredMappings();
+    return true;
+}
@@ -0,0 +1,78 @@
+/*
+    Touch'n'learn - Fun and easy mobile lessons for kids
+    Copyright (C) 2010, 2011 by Alessandro Portale
+    http://touchandlearn.sourceforge.net
+
+    This file is part of Touch'n'learn
+
+    Touch'n'learn is free software; you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    Touch'n'learn is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with Touch'n'learn; if not, write to the Free Software
+    Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA 02110-1301 USA
+*/
+
+#ifndef IMAGEDISKCACHE_H
+#define IMAGEDISKCACHE_H
+
+#include <QtCore/QHash>
+#include <QtCore/QList>
+#include <QtCore/QMutex>
+#include <QtCore/QSet>
+#include <QtGui/QImage>
+
+// Persistent cache of rendered images. The cache file is memory mapped, and
+// the returned images point directly into the mapping. New images are kept
+// in memory, up to a few megabytes, until save() writes a new cache file.
+class ImageDiskCache
+{
+public:
+    ImageDiskCache();
+    ~ImageDiskCache();
+
+    void setFileName(const QString &fileName);
+    void setMaxBytes(int bytes);
+
+    // Each image is stored together with the hash of the SVG file(s) it was
+    // rendered from. Lookups with a different hash fail.
+    QImage image(const QString &key, quint64 sourceHash, QSize *originalSize);
+    void insert(const QString &key, quint64 sourceHash, const QImage &image, const QSize &originalSize);
+    // Only entries with one of the validSourceHashes are written. Lookups
+    // and inserts are not blocked while the file is written.
+    bool save(const QSet<quint64> &validSourceHashes);
+    // Mapped cache files, including previous ones which returned images
+    // still point into
+    int mappedFileCount() const;
+
+private:
+    struct Entry;
+    struct FileEntry;
+    struct Mapping;
+
+    void load();
+    bool mapFile(const QString &fileName);
+    void releaseRetiredMappings();
+
+    QMutex m_saveMutex; // Serializes save()
+    mutable QMutex m_mutex; // Guards the members below
+    QString m_fileName;
+    bool m_loaded;
+    bool m_dirty;
+    int m_maxBytes;
+    Mapping *m_mapping;
+    // Previously mapped files. Returned images may still point into them.
+    QList<Mapping*> m_retiredMappings;
+    QHash<QString, const FileEntry*> m_mappedEntries;
+    QHash<QString, Entry*> m_newEntries;
+    qint64 m_newEntriesBytes;
+};
+
+#endif // IMAGEDISKCACHE_H
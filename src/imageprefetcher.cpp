@@ -0,0 +1,145 @@
+/*
+    Touch'n'learn - Fun and easy mobile lessons for kids
+    Copyright (C) 2010, 2011 by Alessandro Portale
+    http://touchandlearn.sourceforge.net
+
+    This file is part of Touch'n'learn
+
+    Touch'n'learn is free software; you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    Touch'n'learn is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with Touch'n'learn; if not, write to the Free Software
+    Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA 02110-1301 USA
+*/
+
+#include "imageprefetcher.h"
+#include <QtCore/QCoreApplication>
+#include <QtCore/QEvent>
+#include <QtCore/QRunnable>
+#include <QtCore/QThread>
+
+const QString imageProviderPrefix = QLatin1String("image://imageprovider/");
+const int idleTimeout = 2000; // Milliseconds without input
+
+class SaveDiskCacheTask : public QRunnable
+{
+public:
+    void run()
+    {
+        ImageProvider::saveDiskCache();
+    }
+};
+
+class PrefetchTask : public QRunnable
+{
+public:
+    PrefetchTask(ImageProvider *imageProvider, const QAtomicInt &generation,
+                 const QString &id, const QSize &requestedSize)
+        : m_imageProvider(imageProvider)
+        , m_generation(generation)
+        , m_taskGeneration(generation)
+        , m_id(id)
+        , m_requestedSize(requestedSize)
+    { }
+
+    void run()
+    {
+        if (m_generation != m_taskGeneration)
+            return; // Lesson or screen changed after this task was queued
+        QThread::currentThread()->setPriority(QThread::LowPriority);
+        m_imageProvider->requestImage(m_id, 0, m_requestedSize);
+    }
+
+private:
+    ImageProvider *m_imageProvider;
+    const QAtomicInt &m_generation;
+    const int m_taskGeneration;
+    const QString m_id;
+    const QSize m_requestedSize;
+};
+
+ImagePrefetcher::ImagePrefetcher(QObject *parent)
+    : QObject(parent)
+    , m_imageProvider(QDeclarativeImageProvider::Image)
+    , m_generation(0)
+{
+    // Leave one core for the GUI thread
+    m_threadPool.setMaxThreadCount(qMax(1, QThread::idealThreadCount() - 1));
+    m_idleTimer.setSingleShot(true);
+    m_idleTimer.setInterval(idleTimeout);
+    connect(&m_idleTimer, SIGNAL(timeout()), SLOT(prefetchIdleImages()));
+    QCoreApplication::instance()->installEventFilter(this);
+}
+
+ImagePrefetcher::~ImagePrefetcher()
+{
+    cancel();
+}
+
+void ImagePrefetcher::prefetch(const QVariantList &ids, int width, int height, int priority)
+{
+    const QSize requestedSize(width, height);
+    if (requestedSize.isEmpty())
+        return;
+    foreach (const QVariant &idVariant, ids) {
+        QString id = idVariant.toString();
+        if (id.startsWith(imageProviderPrefix))
+            id.remove(0, imageProviderPrefix.length());
+        if (id.isEmpty())
+            continue;
+        m_threadPool.start(new PrefetchTask(&m_imageProvider, m_generation, id, requestedSize), priority);
+    }
+}
+
+void ImagePrefetcher::prefetchWhenIdle(const QVariantList &ids, int width, int height)
+{
+    m_idleIds.clear();
+    foreach (const QVariant &id, ids)
+        m_idleIds.append(id.toString());
+    m_idleSize = QSize(width, height);
+    m_idleTimer.start();
+}
+
+void ImagePrefetcher::cancel()
+{
+    m_generation.fetchAndAddOrdered(1);
+}
+
+bool ImagePrefetcher::eventFilter(QObject *watched, QEvent *event)
+{
+    switch (event->type()) {
+    case QEvent::MouseButtonPress:
+    case QEvent::MouseMove:
+    case QEvent::TouchBegin:
+    case QEvent::TouchUpdate:
+    case QEvent::KeyPress:
+        m_idleTimer.start();
+        break;
+    default:
+        break;
+    }
+    return QObject::eventFilter(watched, event);
+}
+
+void ImagePrefetcher::prefetchIdleImages()
+{
+    // Also a good moment for loading the remaining assets, and for writing
+    // newly rendered images to disk
+    ImageProvider::loadRemainingAssets();
+    m_threadPool.start(new SaveDiskCacheTask, -2);
+    if (m_idleIds.isEmpty())
+        return;
+    QVariantList ids;
+    foreach (const QString &id, m_idleIds)
+        ids.append(id);
+    m_idleIds.clear();
+    prefetch(ids, m_idleSize.width(), m_idleSize.height(), -1);
+}
@@ -0,0 +1,68 @@
+/*
+    Touch'n'learn - Fun and easy mobile lessons for kids
+    Copyright (C) 2010, 2011 by Alessandro Portale
+    http://touchandlearn.sourceforge.net
+
+    This file is part of Touch'n'learn
+
+    Touch'n'learn is free software; you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    Touch'n'learn is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with Touch'n'learn; if not, write to the Free Software
+    Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA 02110-1301 USA
+*/
+
+#ifndef IMAGEPREFETCHER_H
+#define IMAGEPREFETCHER_H
+
+#include <QtCore/QObject>
+#include <QtCore/QStringList>
+#include <QtCore/QThreadPool>
+#include <QtCore/QTimer>
+#include <QtCore/QVariant>
+
+#include "imageprovider.h"
+
+// Renders images into the ImageProvider cache in the background, before
+// QML requests them.
+class ImagePrefetcher : public QObject
+{
+    Q_OBJECT
+
+public:
+    explicit ImagePrefetcher(QObject *parent = 0);
+    ~ImagePrefetcher();
+
+    // Ids may be passed with or without the "image://imageprovider/" prefix.
+    // Images with a higher priority are rendered first.
+    Q_INVOKABLE void prefetch(const QVariantList &ids, int width, int height, int priority = 0);
+    // Images which are rendered once no input happened for a while. The disk
+    // cache of the ImageProvider gets saved at that moment, too.
+    Q_INVOKABLE void prefetchWhenIdle(const QVariantList &ids, int width, int height);
+    // Drops all images that are not yet rendered
+    Q_INVOKABLE void cancel();
+
+protected:
+    bool eventFilter(QObject *watched, QEvent *event);
+
+private slots:
+    void prefetchIdleImages();
+
+private:
+    ImageProvider m_imageProvider;
+    QAtomicInt m_generation;
+    QStringList m_idleIds;
+    QSize m_idleSize;
+    QTimer m_idleTimer;
+    QThreadPool m_threadPool; // Declared last, so that it waits for the running tasks first
+};
+
+#endif // IMAGEPREFETCHER_H
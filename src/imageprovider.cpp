@@ -21,10 +21,30 @@
 */
 
 #include "imageprovider.h"
+#include "assetpack.h"
+#include "colortint.h"
+#include "displaylist.h"
+#include "imagediskcache.h"
+#include "imageprovidermetrics.h"
+#include "imagerequest.h"
+#include "svgelementindex.h"
+#include "tracer.h"
+#include "vignette.h"
 #include "QtCore/qglobal.h"
 #include <math.h>
+#include <QtCore/qmath.h>
 #include <QtGui/QPainter>
+#include <QtGui/QPicture>
 #include <QtCore/QDebug>
+#include <QtCore/QCache>
+#include <QtCore/QCryptographicHash>
+#include <QtCore/QFile>
+#include <QtCore/QHash>
+#include <QtCore/QMutex>
+#include <QtCore/QThread>
+#include <QtCore/QThreadPool>
+#include <QtCore/QThreadStorage>
+#include <QtCore/QVector>
 #include <QtSvg/QSvgRenderer>
 
 #define PI 3.14159265
@@ -37,31 +57,323 @@ enum DesignElementType {
 const QString frameString = QLatin1String("frame");
 const QString buttonString = QLatin1String("button");
 const QString idPrefix = QLatin1String("id_");
+// Only set before the first image is requested, read-only afterwards
 static QString dataPath = QLatin1String("data/graphics");
 
-Q_GLOBAL_STATIC_WITH_INITIALIZER(QSvgRenderer, designRenderer, {
-    x->load(dataPath + QLatin1String("/design.svg"));
-})
+enum SvgFile {
+    SvgFileDesign,
+    SvgFileObjects,
+    SvgFileCountables,
+    SvgFileClocks,
+    SvgFileNotes,
+    SvgFileLessonIcons,
+    SvgFileCount
+};
 
-Q_GLOBAL_STATIC_WITH_INITIALIZER(QSvgRenderer, objectRenderer, {
-    x->load(dataPath + QLatin1String("/objects.svg"));
-})
+static const char* const svgFileNames[SvgFileCount] = {
+    "/design.svg",
+    "/objects.svg",
+    "/countables.svg",
+    "/clocks.svg",
+    "/notes.svg",
+    "/lessonicons.svg"
+};
 
-Q_GLOBAL_STATIC_WITH_INITIALIZER(QSvgRenderer, countablesRenderer, {
-    x->load(dataPath + QLatin1String("/countables.svg"));
-})
+// Contents and hash of an SVG file. Read once, never modified afterwards.
+struct SvgAsset
+{
+    QByteArray document;
+    quint64 hash;
+};
 
-Q_GLOBAL_STATIC_WITH_INITIALIZER(QSvgRenderer, clocksRenderer, {
-    x->load(dataPath + QLatin1String("/clocks.svg"));
-})
+static QMutex svgAssetMutexes[SvgFileCount];
+static QBasicAtomicPointer<SvgAsset> svgAssets[SvgFileCount];
 
-Q_GLOBAL_STATIC_WITH_INITIALIZER(QSvgRenderer, notesRenderer, {
-    x->load(dataPath + QLatin1String("/notes.svg"));
-})
+inline static const SvgAsset &svgAsset(SvgFile file)
+{
+    if (const SvgAsset *asset = svgAssets[file])
+        return *asset;
+    QMutexLocker locker(&svgAssetMutexes[file]);
+    if (!svgAssets[file]) {
+        SvgAsset *asset = new SvgAsset;
+        QFile svgFile(dataPath + QLatin1String(svgFileNames[file]));
+        if (!svgFile.open(QIODevice::ReadOnly))
+            qDebug() << "****************** Could not read" << svgFile.fileName();
+        asset->document = svgFile.readAll();
+        asset->hash = svgDocumentHash(asset->document);
+        svgAssets[file].fetchAndStoreOrdered(asset);
+    }
+    return *svgAssets[file];
+}
 
-Q_GLOBAL_STATIC_WITH_INITIALIZER(QSvgRenderer, lessonIconsRenderer, {
-    x->load(dataPath + QLatin1String("/lessonicons.svg"));
-})
+// The asset loader parses SVG files on worker threads, and leaves the
+// renderers here until a rendering thread adopts them. The renderers have
+// no thread affinity, since they are only used for synchronous rendering.
+static QMutex parsingMutexes[SvgFileCount]; // Held while the asset loader parses a file
+static QList<QSvgRenderer*> spareRenderers[SvgFileCount]; // Guarded by parsingMutexes
+
+inline static QSvgRenderer *adoptedOrParsedRenderer(SvgFile file)
+{
+    {
+        QMutexLocker locker(&parsingMutexes[file]); // Waits, if the file is just being parsed
+        if (!spareRenderers[file].isEmpty())
+            return spareRenderers[file].takeFirst();
+    }
+    return new QSvgRenderer(svgAsset(file).document);
+}
+
+// QSvgRenderer is not reentrant. Each thread which renders images gets its
+// own set of renderers, which are loaded on first use.
+class SvgRendererPool
+{
+public:
+    SvgRendererPool()
+    {
+        for (int i = 0; i < SvgFileCount; i++)
+            m_renderers[i] = 0;
+    }
+
+    ~SvgRendererPool()
+    {
+        for (int i = 0; i < SvgFileCount; i++)
+            delete m_renderers[i];
+    }
+
+    QSvgRenderer *renderer(SvgFile file)
+    {
+        if (!m_renderers[file])
+            m_renderers[file] = adoptedOrParsedRenderer(file);
+        return m_renderers[file];
+    }
+
+    struct Picture
+    {
+        QPicture picture;
+        QRectF bounds;
+    };
+
+    // Display lists of this thread, by element name
+    QHash<QString, Picture> &pictures(SvgFile file)
+    {
+        return m_pictures[file];
+    }
+
+private:
+    QSvgRenderer *m_renderers[SvgFileCount];
+    QHash<QString, Picture> m_pictures[SvgFileCount];
+};
+
+static QThreadStorage<SvgRendererPool*> threadRendererPool;
+
+inline static SvgRendererPool *svgRendererPool()
+{
+    if (!threadRendererPool.hasLocalData())
+        threadRendererPool.setLocalData(new SvgRendererPool);
+    return threadRendererPool.localData();
+}
+
+inline static QSvgRenderer *svgRenderer(SvgFile file)
+{
+    return svgRendererPool()->renderer(file);
+}
+
+inline static QSvgRenderer *designRenderer()
+{
+    return svgRenderer(SvgFileDesign);
+}
+
+inline static QSvgRenderer *clocksRenderer()
+{
+    return svgRenderer(SvgFileClocks);
+}
+
+inline static QSvgRenderer *notesRenderer()
+{
+    return svgRenderer(SvgFileNotes);
+}
+
+static QString elementIndexFileName; // Only set before the first image is requested
+static QMutex elementIndexMutex; // Guards storedElementIndexes and the flags below
+static QMutex elementIndexBuildMutexes[SvgFileCount];
+static QBasicAtomicPointer<SvgElementIndex> elementIndexes[SvgFileCount];
+static SvgElementIndex::IndexesBySourceHash storedElementIndexes;
+static bool storedElementIndexesRead = false;
+static bool elementIndexesChanged = false;
+
+// Publishes the index of the file from the element index file, if it has
+// one. Requires elementIndexBuildMutexes[file] to be locked.
+inline static bool publishStoredElementIndex(SvgFile file)
+{
+    if (elementIndexes[file])
+        return true;
+    const quint64 hash = svgAsset(file).hash;
+    QMutexLocker locker(&elementIndexMutex);
+    if (!storedElementIndexesRead && !elementIndexFileName.isEmpty())
+        storedElementIndexes = SvgElementIndex::readFile(elementIndexFileName);
+    storedElementIndexesRead = true;
+    const SvgElementIndex storedIndex = storedElementIndexes.value(hash);
+    if (storedIndex.isEmpty())
+        return false;
+    elementIndexes[file].fetchAndStoreOrdered(new SvgElementIndex(storedIndex));
+    return true;
+}
+
+inline static const SvgElementIndex &elementIndex(SvgFile file, QSvgRenderer *renderer)
+{
+    QMutexLocker buildLocker(&elementIndexBuildMutexes[file]);
+    if (!publishStoredElementIndex(file)) {
+        SvgElementIndex *index = new SvgElementIndex;
+        index->build(svgAsset(file).document, renderer, idPrefix);
+        {
+            QMutexLocker locker(&elementIndexMutex);
+            storedElementIndexes.insert(svgAsset(file).hash, *index);
+            elementIndexesChanged = true;
+        }
+        elementIndexes[file].fetchAndStoreOrdered(index);
+    }
+    return *elementIndexes[file];
+}
+
+// Read from the element index file, or built once from the SVG file.
+// Indexes are never modified afterwards.
+inline static const SvgElementIndex &elementIndex(SvgFile file)
+{
+    if (const SvgElementIndex *index = elementIndexes[file])
+        return *index;
+    {
+        // A stored index does not need the SVG file to be parsed
+        QMutexLocker buildLocker(&elementIndexBuildMutexes[file]);
+        if (publishStoredElementIndex(file))
+            return *elementIndexes[file];
+    }
+    // The renderer is obtained first, the asset loader locks in the same
+    // order. Callers must not hold a lock which the asset loader takes
+    // while parsing, see AssetLoadTask.
+    return elementIndex(file, svgRenderer(file));
+}
+
+inline static quint64 lessonIconSourceHash()
+{
+    return svgAsset(SvgFileLessonIcons).hash ^ (svgAsset(SvgFileDesign).hash * 31);
+}
+
+// Hash of the SVG file(s) from which the images of an id family are rendered
+inline static quint64 sourceHash(ImageFamily family)
+{
+    switch (family) {
+    case ImageFamilyObject: return svgAsset(SvgFileObjects).hash;
+    case ImageFamilyQuantity: return svgAsset(SvgFileCountables).hash;
+    case ImageFamilyClock: return svgAsset(SvgFileClocks).hash;
+    case ImageFamilyNotes: return svgAsset(SvgFileNotes).hash;
+    case ImageFamilyLessonIcon: return lessonIconSourceHash();
+    default: return svgAsset(SvgFileDesign).hash;
+    }
+}
+
+// Display lists of the elements, shared by all threads. Read from the
+// display list file of an SVG file if it matches, compiled on first use otherwise.
+static QAtomicInt displayListsEnabled(1);
+static QMutex displayListsMutex; // Guards the two arrays below
+static DisplayLists sharedDisplayLists[SvgFileCount];
+static bool displayListFilesRead[SvgFileCount];
+
+inline static QString displayListFileName(SvgFile file)
+{
+    QString result = dataPath + QLatin1String(svgFileNames[file]);
+    result.chop(4); // ".svg"
+    return result + QLatin1String(".displaylist");
+}
+
+// Requires displayListsMutex to be locked
+inline static void readDisplayListFile(SvgFile file)
+{
+    if (!displayListFilesRead[file]) {
+        readDisplayLists(displayListFileName(file), svgAsset(file).hash, &sharedDisplayLists[file]);
+        displayListFilesRead[file] = true;
+    }
+}
+
+inline static DisplayList sharedDisplayList(SvgFile file, const QString &elementName)
+{
+    {
+        QMutexLocker locker(&displayListsMutex);
+        readDisplayListFile(file);
+        const DisplayLists::const_iterator it = sharedDisplayLists[file].constFind(elementName);
+        if (it != sharedDisplayLists[file].constEnd())
+            return it.value();
+    }
+    const DisplayList result = compiledDisplayList(svgRenderer(file), idPrefix + elementName);
+    QMutexLocker locker(&displayListsMutex);
+    sharedDisplayLists[file].insert(elementName, result);
+    return result;
+}
+
+// Draws the element into the target rect, like QSvgRenderer::render()
+inline static void drawSvgElement(SvgFile file, QPainter *p, const QString &elementName, const QRectF &target)
+{
+    if (!displayListsEnabled) {
+        svgRenderer(file)->render(p, idPrefix + elementName, target);
+        return;
+    }
+    QHash<QString, SvgRendererPool::Picture> &pictures = svgRendererPool()->pictures(file);
+    QHash<QString, SvgRendererPool::Picture>::iterator picture = pictures.find(elementName);
+    if (picture == pictures.end()) {
+        const DisplayList displayList = sharedDisplayList(file, elementName);
+        SvgRendererPool::Picture newPicture;
+        newPicture.picture.setData(displayList.pictureData.constData(), displayList.pictureData.size());
+        newPicture.bounds = displayList.bounds;
+        picture = pictures.insert(elementName, newPicture);
+    }
+    replayDisplayList(p, &picture->picture, picture->bounds, target);
+}
+
+Q_GLOBAL_STATIC(ImageDiskCache, diskCache)
+Q_GLOBAL_STATIC(AssetPack, assetPack)
+
+// Data that is derived from the SVG files. It is initialized on first use,
+// and is not modified afterwards. unloadAssets() resets it, for measuring
+// cold starts.
+template <typename T>
+class DerivedData
+{
+public:
+    typedef void (*InitializeFunction)(T *x);
+
+    explicit DerivedData(InitializeFunction initialize)
+        : m_initialize(initialize)
+        , m_data(0)
+    { }
+
+    ~DerivedData()
+    {
+        delete m_data;
+    }
+
+    T *operator()()
+    {
+        if (T *data = m_data)
+            return data;
+        QMutexLocker locker(&m_mutex);
+        if (!m_data) {
+            T *data = new T;
+            m_initialize(data);
+            m_data.fetchAndStoreOrdered(data);
+        }
+        return m_data;
+    }
+
+    // Only while no images are rendered
+    void reset()
+    {
+        QMutexLocker locker(&m_mutex);
+        delete m_data.fetchAndStoreOrdered(0);
+    }
+
+private:
+    const InitializeFunction m_initialize;
+    QAtomicPointer<T> m_data;
+    QMutex m_mutex;
+};
 
 QImage gradientImage(DesignElementType type)
 {
@@ -81,84 +393,135 @@ QImage gradientImage(DesignElementType type)
     return result;
 }
 
-Q_GLOBAL_STATIC_WITH_INITIALIZER(QImage, buttonGradient, {
+static void initializeButtonGradient(QImage *x)
+{
     *x = gradientImage(DesignElementTypeButton);
-})
+}
+
+static DerivedData<QImage> buttonGradient(initializeButtonGradient);
 
-Q_GLOBAL_STATIC_WITH_INITIALIZER(QImage, frameGradient, {
+static void initializeFrameGradient(QImage *x)
+{
     *x = gradientImage(DesignElementTypeFrame);
-})
+}
 
-struct ElementVariations
+static DerivedData<QImage> frameGradient(initializeFrameGradient);
+
+typedef SvgElementIndex::AspectRatioBucket ElementVariations;
+typedef SvgElementIndex::AspectRatioBuckets ElementVariationList;
+
+static void initializeButtonVariations(ElementVariationList *x)
 {
-    QStringList elementIds;
-    qreal widthToHeightRatio;
-    inline bool operator<(const ElementVariations &other) const
-    {
-        return widthToHeightRatio < other.widthToHeightRatio;
-    }
+    *x = elementIndex(SvgFileDesign).aspectRatioBuckets(buttonString);
+}
+
+static DerivedData<ElementVariationList> buttonVariations(initializeButtonVariations);
+
+static void initializeFrameVariations(ElementVariationList *x)
+{
+    *x = elementIndex(SvgFileDesign).aspectRatioBuckets(frameString);
+}
+
+static DerivedData<ElementVariationList> frameVariations(initializeFrameVariations);
+
+struct CachedImage
+{
+    QImage image;
+    QSize originalSize;
 };
 
-typedef QList<ElementVariations> ElementVariationList;
+typedef QCache<QString, CachedImage> ImageCache;
+
+// Guards imageCache(), cacheHitsCount, cacheMissesCount and the gradient cache
+static QMutex cacheMutex;
+static int cacheHitsCount = 0;
+static int cacheMissesCount = 0;
+
+Q_GLOBAL_STATIC_WITH_INITIALIZER(ImageCache, imageCache, {
+    x->setMaxCost(10 * 1024 * 1024); // Bytes
+})
 
-ElementVariationList elementsWithSizes(const QString &elementBase)
+ImageProvider::ImageProvider(ImageType type)
+    : QDeclarativeImageProvider(type)
 {
-    ElementVariationList result;
-    QSvgRenderer *renderer = designRenderer();
-    ElementVariations element;
-    element.widthToHeightRatio = -1;
-    for (int i = 1; ; i++) {
-        const QString id = elementBase + QLatin1Char('_') + QString::number(i);
-        if (!renderer->elementExists(idPrefix + id))
-            break;
-        const QSizeF size = renderer->boundsOnElement(idPrefix + id).size();
-        const qreal widthToHeightRatio = size.width() / size.height();
-        if (!qFuzzyCompare(widthToHeightRatio, element.widthToHeightRatio)) {
-            if (element.widthToHeightRatio > 0) // Check, is it is the first element
-                result.append(element);
-            element.widthToHeightRatio = widthToHeightRatio;
-            element.elementIds.clear();
-        }
-        element.elementIds.append(id);
-    }
-    if (!element.elementIds.isEmpty())
-        result.append(element);
-    qSort(result);
+}
+
+inline static QImage transparentImage(const QSize &size)
+{
+    QImage result(size, QImage::Format_ARGB32_Premultiplied);
+    result.fill(0);
     return result;
 }
 
-Q_GLOBAL_STATIC_WITH_INITIALIZER(ElementVariationList, buttonVariations, {
-    x->append(elementsWithSizes(buttonString));
-})
+const int countableVariationsCount = 8;
+
+// All variations of one countable item, pre-rendered in one size. The
+// sprites get rendered the first time that they are needed.
+struct CountableAtlas
+{
+    QImage sprites[countableVariationsCount];
+};
+
+typedef QCache<QString, CountableAtlas> CountableAtlasCache;
+
+static QMutex countableAtlasMutex; // Guards countableAtlasCache() and its atlases
 
-Q_GLOBAL_STATIC_WITH_INITIALIZER(ElementVariationList, frameVariations, {
-    x->append(elementsWithSizes(frameString));
+Q_GLOBAL_STATIC_WITH_INITIALIZER(CountableAtlasCache, countableAtlasCache, {
+    x->setMaxCost(4 * 1024 * 1024); // Bytes
 })
 
-ImageProvider::ImageProvider()
-    : QDeclarativeImageProvider(QDeclarativeImageProvider::Pixmap)
+inline static QImage countableSprite(const QString &item, int variation, int itemSize)
 {
+    const QString atlasKey = item + QLatin1Char('@') + QString::number(itemSize);
+    {
+        QMutexLocker locker(&countableAtlasMutex);
+        const CountableAtlas *atlas = countableAtlasCache()->object(atlasKey);
+        if (atlas && !atlas->sprites[variation].isNull())
+            return atlas->sprites[variation];
+    }
+    QImage sprite = transparentImage(QSize(itemSize, itemSize));
+    QPainter p(&sprite);
+    drawSvgElement(SvgFileCountables, &p, item + QLatin1Char('_') + QString::number(variation + 1), sprite.rect());
+    p.end();
+    QMutexLocker locker(&countableAtlasMutex);
+    CountableAtlas *atlas = countableAtlasCache()->object(atlasKey);
+    if (!atlas) {
+        atlas = new CountableAtlas;
+        const int atlasBytes = countableVariationsCount * sprite.byteCount();
+        if (!countableAtlasCache()->insert(atlasKey, atlas, atlasBytes))
+            return sprite;
+    }
+    atlas->sprites[variation] = sprite;
+    return sprite;
 }
 
-inline static QPixmap quantity(int quantity, const QString &item, QSize *size, const QSize &requestedSize)
+// Same layout for the same seed. Each item gets a random variation if the seed is negative.
+inline static QImage quantity(int quantity, const QString &item, int seed, QSize *size, const QSize &requestedSize)
 {
-    QSvgRenderer *renderer = countablesRenderer();
+    uint randomState = uint(seed);
     const int columns = ceil(sqrt(qreal(quantity)));
     const int rows = ceil(quantity / qreal(columns));
     const int columnsInLastRow = quantity % columns == 0 ? columns : quantity % columns;
     const int itemSize = qMin((requestedSize.width() / qMax(3, columns)), (requestedSize.height() / qMax(3, rows)));
+    if (itemSize < 1)
+        return QImage();
     const QSize resultSize(itemSize * columns, itemSize * rows);
-    QPixmap result(resultSize);
-    result.fill(Qt::transparent);
+    QImage result = transparentImage(resultSize);
     QPainter p(&result);
     for (int row = 0; row < rows; row++) {
         for (int column = 0; column < columns; column++) {
             if (columns * row + column >= quantity)
                 break;
-            const QString itemId = item + QLatin1Char('_') + QString::number((qrand() % 8 + 1));
-            const QRect itemRect(column * itemSize + (row == rows-1 ? (columns - columnsInLastRow) * itemSize / 2 : 0),
-                                 row * itemSize, itemSize, itemSize);
-            renderer->render(&p, idPrefix + itemId, itemRect);
+            int variation;
+            if (seed < 0) {
+                variation = qrand() % countableVariationsCount;
+            } else {
+                randomState = randomState * 1103515245 + 12345; // Local, not affected by qsrand()
+                variation = (randomState >> 16) % countableVariationsCount;
+            }
+            const QPoint itemPosition(column * itemSize + (row == rows-1 ? (columns - columnsInLastRow) * itemSize / 2 : 0),
+                                      row * itemSize);
+            p.drawImage(itemPosition, countableSprite(item, variation, itemSize));
         }
     }
     if (size)
@@ -166,85 +529,245 @@ inline static QPixmap quantity(int quantity, const QString &item, QSize *size, c
     return result;
 }
 
-inline static int variationsCount(const QSvgRenderer *renderer, const QString &baseName)
+const QString clockBackgroundString = QLatin1String("background");
+const QString colorBlotString = QLatin1String("colorblot");
+
+static void initializeClockVariations(int *x)
 {
-    int count = 0;
-    const QString elementIdBase = baseName + QLatin1Char('_');
-    Q_FOREVER {
-        const QString elementId = elementIdBase + QString::number(count + 1);
-        if (renderer->elementExists(idPrefix + elementId))
-            count++;
-        else
-            break;
-    }
-    return count;
+    *x = elementIndex(SvgFileClocks).variationsCount(clockBackgroundString);
 }
 
-inline static void renderIndicator(const QString &indicatorId, int rotation, const QRectF &background,
-                                   qreal scaleFactor, QSvgRenderer *renderer, QPainter *p)
+static DerivedData<int> clockVariations(initializeClockVariations);
+
+static void initializeColorBlotVariations(int *x)
 {
-    const QPointF bgCenter = background.center();
-    QTransform transform;
-    transform
-            .scale(scaleFactor, scaleFactor)
-            .translate(bgCenter.x() - background.x(), bgCenter.y() - background.y())
-            .rotate(rotation)
-            .translate(-bgCenter.x(), -bgCenter.y());
-    p->setTransform(transform);
-    renderer->render(p, idPrefix + indicatorId, renderer->boundsOnElement(idPrefix + indicatorId));
+    *x = elementIndex(SvgFileDesign).variationsCount(colorBlotString);
+}
+
+static DerivedData<int> colorBlotVariations(initializeColorBlotVariations);
+
+inline static int clockVariationsCount()
+{
+    return *clockVariations();
+}
+
+inline static int colorBlotVariationsCount()
+{
+    return *colorBlotVariations();
+}
+
+// The face, the hands and the foreground of one clock variation, each
+// rendered once for a specific size. The hands are rendered in their
+// unrotated position and get rotated when composing the clock.
+struct ClockLayers
+{
+    QImage face;
+    QImage minuteHand;
+    QImage hourHand;
+    QImage foreground;
+    QSize originalSize;
+};
+
+typedef QCache<QString, ClockLayers> ClockLayersCache;
+
+static QMutex clockLayersMutex; // Guards clockLayersCache()
+
+Q_GLOBAL_STATIC_WITH_INITIALIZER(ClockLayersCache, clockLayersCache, {
+    x->setMaxCost(6 * 1024 * 1024); // Bytes
+})
+
+inline static QImage renderedClockLayer(QSvgRenderer *renderer, const QString &elementName,
+                                        const QTransform &transform, const QSize &size)
+{
+    QImage layer = transparentImage(size);
+    QPainter p(&layer);
+    p.setTransform(transform);
+    renderer->render(&p, idPrefix + elementName, elementIndex(SvgFileClocks).bounds(elementName));
+    return layer;
 }
 
-inline static QPixmap clock(int hour, int minute, int variation, QSize *size, const QSize &requestedSize)
+inline static ClockLayers *createdClockLayers(int actualVariation, const QSize &requestedSize)
 {
     QSvgRenderer *renderer = clocksRenderer();
-    const static QString clockBackgroundString = QLatin1String("background");
-    const static int variationsCnt = variationsCount(renderer, clockBackgroundString);
-    const int actualVariation = (variation % variationsCnt) + 1;
     const QString variationNumber = QLatin1Char('_') + QString::number(actualVariation);
     const QString backgroundElementId = clockBackgroundString + variationNumber;
-    const QRectF backgroundRect = renderer->boundsOnElement(idPrefix + backgroundElementId);
-    QSize pixmapSize = backgroundRect.size().toSize();
-    if (size)
-        *size = pixmapSize;
+    const QRectF backgroundRect = elementIndex(SvgFileClocks).bounds(backgroundElementId);
+    ClockLayers *layers = new ClockLayers;
+    layers->originalSize = backgroundRect.size().toSize();
+    QSize pixmapSize = layers->originalSize;
     pixmapSize.scale(requestedSize, Qt::KeepAspectRatio);
-    QPixmap pixmap(pixmapSize);
-    if (pixmap.isNull())
-        qDebug() << "****************** clock pixmap is NULL! Variation:" << variation;
-    pixmap.fill(Qt::transparent);
-    QPainter p(&pixmap);
     const qreal scaleFactor = pixmapSize.width() / backgroundRect.width();
     QTransform mainTransform;
     mainTransform
             .scale(scaleFactor, scaleFactor)
             .translate(-backgroundRect.left(), -backgroundRect.top());
-    p.setTransform(mainTransform);
-    renderer->render(&p, idPrefix + backgroundElementId, backgroundRect);
+    layers->face = renderedClockLayer(renderer, backgroundElementId, mainTransform, pixmapSize);
+    if (layers->face.isNull())
+        qDebug() << "****************** clock pixmap is NULL! Variation:" << actualVariation;
+    layers->minuteHand = renderedClockLayer(renderer, QLatin1String("minute") + variationNumber,
+                                            mainTransform, pixmapSize);
+    layers->hourHand = renderedClockLayer(renderer, QLatin1String("hour") + variationNumber,
+                                          mainTransform, pixmapSize);
+    const QString foregroundElementId = QLatin1String("foreground") + variationNumber;
+    if (elementIndex(SvgFileClocks).contains(foregroundElementId))
+        layers->foreground = renderedClockLayer(renderer, foregroundElementId, mainTransform, pixmapSize);
+    return layers;
+}
 
-    const int minuteRotation = (minute * 6) % 360;
-    renderIndicator(QLatin1String("minute") + variationNumber, minuteRotation,
-                    backgroundRect, scaleFactor, renderer, &p);
+inline static void drawClockHand(QPainter *p, const QImage &hand, int rotation)
+{
+    const QPointF center = QRectF(hand.rect()).center();
+    QTransform transform;
+    transform
+            .translate(center.x(), center.y())
+            .rotate(rotation)
+            .translate(-center.x(), -center.y());
+    p->setTransform(transform);
+    p->drawImage(0, 0, hand);
+}
 
-    const int hoursSkew = 6; // Initial position of hour in the SVG is 6
-    renderIndicator(QLatin1String("hour") + variationNumber, (((hour + hoursSkew) * 360 + minuteRotation) / 12) % 360,
-                    backgroundRect, scaleFactor, renderer, &p);
+inline static QImage clock(int hour, int minute, int variation, QSize *size, const QSize &requestedSize)
+{
+    const int actualVariation = (variation % clockVariationsCount()) + 1;
+    const QString layersKey = QString::number(actualVariation) + QLatin1Char('@')
+            + QString::number(requestedSize.width()) + QLatin1Char('x') + QString::number(requestedSize.height());
+    ClockLayers layers;
+    {
+        QMutexLocker locker(&clockLayersMutex);
+        if (const ClockLayers *cachedLayers = clockLayersCache()->object(layersKey))
+            layers = *cachedLayers;
+    }
+    if (layers.face.isNull()) {
+        ClockLayers *createdLayers = createdClockLayers(actualVariation, requestedSize);
+        layers = *createdLayers;
+        const int layersCount = layers.foreground.isNull() ? 3 : 4;
+        QMutexLocker locker(&clockLayersMutex);
+        clockLayersCache()->insert(layersKey, createdLayers, layersCount * layers.face.byteCount());
+    }
+    if (size)
+        *size = layers.originalSize;
 
-    const QString foregroundElementId = QLatin1String("foreground") + variationNumber;
-    if (renderer->elementExists(idPrefix + foregroundElementId)) {
-        p.setTransform(mainTransform);
-        renderer->render(&p, idPrefix + foregroundElementId, renderer->boundsOnElement(idPrefix + foregroundElementId));
+    QImage pixmap = layers.face;
+    QPainter p(&pixmap); // Detaches from the cached face
+    p.setRenderHint(QPainter::SmoothPixmapTransform);
+    const int minuteRotation = (minute * 6) % 360;
+    drawClockHand(&p, layers.minuteHand, minuteRotation);
+    const int hoursSkew = 6; // Initial position of hour in the SVG is 6
+    drawClockHand(&p, layers.hourHand, (((hour + hoursSkew) * 360 + minuteRotation) / 12) % 360);
+    if (!layers.foreground.isNull()) {
+        p.resetTransform();
+        p.drawImage(0, 0, layers.foreground);
     }
     return pixmap;
 }
 
-inline static QPixmap notes(const QStringList &notes, QSize *size, const QSize &requestedSize)
+const QString clefId = QLatin1String("clef");
+const QString staffLinesId = QLatin1String("stafflines");
+const QString sharpId = QLatin1String("sharp");
+const QString flatId = QLatin1String("flat");
+const int naturalNotesCount = 7; // 'a' to 'g'
+
+struct NotesMetrics
 {
-    QSvgRenderer *renderer = notesRenderer();
-    static const QString clefId = QLatin1String("clef");
-    static const QRectF clefRect = renderer->boundsOnElement(idPrefix + clefId);
-    static const QString staffLinesId = QLatin1String("stafflines");
-    static const QRectF staffLinesOriginalRect = renderer->boundsOnElement(idPrefix + staffLinesId);
-    static const qreal clefRightY = clefRect.right() - staffLinesOriginalRect.left();
-    static const qreal linesSpacePerNote = clefRect.width() * 1.75;
+    QRectF clefRect;
+    QRectF staffLinesOriginalRect;
+    QRectF noteCHeadRect;
+    QRectF sharpRect;
+    QRectF flatRect;
+    QString noteIds[naturalNotesCount];
+    QRectF noteRects[naturalNotesCount];
+    QRectF noteHeadRects[naturalNotesCount];
+    qreal clefRightY;
+    qreal linesSpacePerNote;
+};
+
+static void initializeNotesMetrics(NotesMetrics *x)
+{
+    const SvgElementIndex &index = elementIndex(SvgFileNotes);
+    x->clefRect = index.bounds(clefId);
+    x->staffLinesOriginalRect = index.bounds(staffLinesId);
+    x->noteCHeadRect = index.bounds(QLatin1String("note_c_head"));
+    x->sharpRect = index.bounds(sharpId);
+    x->flatRect = index.bounds(flatId);
+    for (int i = 0; i < naturalNotesCount; i++) {
+        const QString noteName = QLatin1String("note_") + QLatin1Char(char('a' + i));
+        x->noteIds[i] = idPrefix + noteName;
+        x->noteRects[i] = index.bounds(noteName);
+        if (index.hasCompanion(noteName, SvgElementIndex::CompanionHead))
+            x->noteHeadRects[i] = index.bounds(noteName + QLatin1String("_head"));
+    }
+    x->clefRightY = x->clefRect.right() - x->staffLinesOriginalRect.left();
+    x->linesSpacePerNote = x->clefRect.width() * 1.75;
+}
+
+static DerivedData<NotesMetrics> notesMetrics(initializeNotesMetrics);
+
+typedef QCache<QString, QImage> NotesLayerCache;
+
+static QMutex notesLayersMutex; // Guards notesLayerCache()
+
+// Staff lines with clef (per image size) and single glyphs (per scale factor)
+Q_GLOBAL_STATIC_WITH_INITIALIZER(NotesLayerCache, notesLayerCache, {
+    x->setMaxCost(2 * 1024 * 1024); // Bytes
+})
+
+inline static QImage cachedNotesLayer(const QString &key)
+{
+    QMutexLocker locker(&notesLayersMutex);
+    const QImage *layer = notesLayerCache()->object(key);
+    return layer ? *layer : QImage();
+}
+
+inline static void insertNotesLayer(const QString &key, const QImage &layer)
+{
+    QMutexLocker locker(&notesLayersMutex);
+    notesLayerCache()->insert(key, new QImage(layer), layer.byteCount());
+}
+
+inline static QImage notesStaff(const QRectF &pixmapRect, const QSize &pixmapSize)
+{
+    const QString key = staffLinesId + QLatin1Char('@') + QString::number(pixmapSize.width())
+            + QLatin1Char('x') + QString::number(pixmapSize.height());
+    QImage staff = cachedNotesLayer(key);
+    if (staff.isNull()) {
+        QSvgRenderer *renderer = notesRenderer();
+        staff = transparentImage(pixmapSize);
+        QPainter p(&staff);
+        const qreal scaleFactor = pixmapSize.width() / pixmapRect.width();
+        p.scale(scaleFactor, scaleFactor);
+        p.translate(-pixmapRect.topLeft());
+        renderer->render(&p, idPrefix + staffLinesId, pixmapRect);
+        renderer->render(&p, idPrefix + clefId, notesMetrics()->clefRect);
+        p.end();
+        insertNotesLayer(key, staff);
+    }
+    return staff;
+}
+
+// Draws a note or sign glyph at the place of glyphRect, which is in SVG
+// coordinates. The glyph is snapped to full pixels.
+inline static void drawNotesGlyph(QPainter *p, const QString &glyphId, const QRectF &glyphRect,
+                                  const QPointF &origin, qreal scaleFactor, const QString &scaleFactorString)
+{
+    const QString key = glyphId + QLatin1Char('@') + scaleFactorString;
+    QImage glyph = cachedNotesLayer(key);
+    if (glyph.isNull()) {
+        const QSizeF glyphSize = glyphRect.size() * scaleFactor;
+        glyph = transparentImage(QSize(qCeil(glyphSize.width()), qCeil(glyphSize.height())));
+        QPainter glyphPainter(&glyph);
+        notesRenderer()->render(&glyphPainter, glyphId, QRectF(QPointF(), glyphSize));
+        glyphPainter.end();
+        insertNotesLayer(key, glyph);
+    }
+    p->drawImage(((glyphRect.topLeft() - origin) * scaleFactor).toPoint(), glyph);
+}
+
+inline static QImage notes(const QStringList &notes, QSize *size, const QSize &requestedSize)
+{
+    const NotesMetrics *metrics = notesMetrics();
+    const QRectF &staffLinesOriginalRect = metrics->staffLinesOriginalRect;
+    const qreal clefRightY = metrics->clefRightY;
+    const qreal linesSpacePerNote = metrics->linesSpacePerNote;
     const qreal linesSpaceForNotes = notes.count() * linesSpacePerNote;
     QRectF pixmapRect = staffLinesOriginalRect;
     pixmapRect.setWidth(clefRightY + linesSpaceForNotes);
@@ -252,103 +775,117 @@ inline static QPixmap notes(const QStringList &notes, QSize *size, const QSize &
     if (size)
         *size = pixmapSize;
     pixmapSize.scale(requestedSize, Qt::KeepAspectRatio);
-    QPixmap pixmap(pixmapSize);
-    if (pixmap.isNull())
+    QImage pixmap = notesStaff(pixmapRect, pixmapSize);
+    if (pixmap.isNull()) {
         qDebug() << "****************** notes pixmap is NULL! Notes:" << notes;
-    pixmap.fill(Qt::transparent);
-    QPainter p(&pixmap);
+        return pixmap;
+    }
+    QPainter p(&pixmap); // Detaches from the cached staff
     const qreal scaleFactor = pixmapSize.width() / pixmapRect.width();
-    p.scale(scaleFactor, scaleFactor);
-    p.translate(-pixmapRect.topLeft());
-
-    renderer->render(&p, idPrefix + staffLinesId, pixmapRect);
-    renderer->render(&p, idPrefix + clefId, clefRect);
+    const QString scaleFactorString = QString::number(scaleFactor, 'f', 5);
+    const QPointF origin = pixmapRect.topLeft();
 
     int currentNoteIndex = 0;
     foreach(const QString &currentNote, notes) {
         const QString trimmedNote = currentNote.trimmed();
-        const QString note = trimmedNote.at(0).toLower();
-        const QString noteID = QLatin1String("note_") + note;
-        QRectF noteRect = renderer->boundsOnElement(idPrefix + noteID);
-        const qreal noteCenterX = clefRightY + (currentNoteIndex + 0.125) * linesSpacePerNote + noteRect.width();
+        const int noteIndex = trimmedNote.isEmpty() ? -1 : trimmedNote.at(0).toLower().unicode() - 'a';
+        const qreal noteOffset = (currentNoteIndex + 0.125) * linesSpacePerNote;
         currentNoteIndex++;
+        if (noteIndex < 0 || noteIndex >= naturalNotesCount)
+            continue;
+        const QRectF &noteRect = metrics->noteRects[noteIndex];
+        const qreal noteCenterX = clefRightY + noteOffset + noteRect.width();
         const qreal noteXTranslate = noteCenterX - noteRect.center().x();
-        noteRect.translate(noteXTranslate, 0);
-        renderer->render(&p, idPrefix + noteID, noteRect);
+        drawNotesGlyph(&p, metrics->noteIds[noteIndex], noteRect.translated(noteXTranslate, 0),
+                       origin, scaleFactor, scaleFactorString);
         if (trimmedNote.length() > 1) {
-            static const QString sharpId = QLatin1String("sharp");
-            static const QString flatId = QLatin1String("flat");
-            static const QRectF noteCHeadRect = renderer->boundsOnElement(idPrefix + QLatin1String("note_c_head"));
             const bool sharp = trimmedNote.endsWith(QLatin1String("sharp"));
-            const QString &noteSign = sharp ? sharpId : flatId;
-            const QRectF noteHeadRect = renderer->boundsOnElement(idPrefix + QLatin1String("note_") + note + QLatin1String("_head"));
-            const QRectF signRect = renderer->boundsOnElement(idPrefix + noteSign)
+            const QRectF signRect = (sharp ? metrics->sharpRect : metrics->flatRect)
                     .translated(noteXTranslate, 0)
-                    .translated(noteHeadRect.topLeft() - noteCHeadRect.topLeft());
-            renderer->render(&p, idPrefix + noteSign, signRect);
+                    .translated(metrics->noteHeadRects[noteIndex].topLeft() - metrics->noteCHeadRect.topLeft());
+            drawNotesGlyph(&p, idPrefix + (sharp ? sharpId : flatId), signRect,
+                           origin, scaleFactor, scaleFactorString);
         }
     }
 
     return pixmap;
 }
 
-inline static QPixmap renderedSvgElement(const QString &elementId, QSvgRenderer *renderer, Qt::AspectRatioMode aspectRatioMode,
+// Bounds of an SVG element which is requested by name, honoring "_rect"
+struct InternedElement
+{
+    QRectF bounds;
+};
+
+typedef QHash<QString, InternedElement> InternedElements;
+
+static QMutex internedElementsMutex;
+static InternedElements internedElements[SvgFileCount]; // Guarded by internedElementsMutex
+
+inline static InternedElement internedElement(SvgFile file, const QString &elementName)
+{
+    {
+        QMutexLocker locker(&internedElementsMutex);
+        const InternedElements::const_iterator it = internedElements[file].constFind(elementName);
+        if (it != internedElements[file].constEnd())
+            return it.value();
+    }
+    const SvgElementIndex &index = elementIndex(file);
+    InternedElement element;
+    element.bounds = index.bounds(index.hasCompanion(elementName, SvgElementIndex::CompanionRect)
+                                  ? elementName + QLatin1String("_rect") : elementName);
+    QMutexLocker locker(&internedElementsMutex);
+    internedElements[file].insert(elementName, element);
+    return element;
+}
+
+inline static QImage renderedSvgElement(const QString &elementName, SvgFile file, Qt::AspectRatioMode aspectRatioMode,
                                          QSize *size, const QSize &requestedSize)
 {
-    const QString rectId = elementId + QLatin1String("_rect");
-    const QRectF rect = renderer->boundsOnElement(idPrefix + (renderer->elementExists(idPrefix + rectId) ? rectId : elementId));
-    Q_ASSERT_X(rect.width() >= 1 && rect.height() >= 1, "renderedSvgElement", "SVG bounding rect is NULL");
-    QSize pixmapSize = rect.size().toSize();
+    const InternedElement element = internedElement(file, elementName);
+    Q_ASSERT_X(element.bounds.width() >= 1 && element.bounds.height() >= 1, "renderedSvgElement", "SVG bounding rect is NULL");
+    QSize pixmapSize = element.bounds.size().toSize();
     if (size)
         *size = pixmapSize;
     pixmapSize.scale(requestedSize, aspectRatioMode);
     Q_ASSERT_X(pixmapSize.width() >= 1 && pixmapSize.height() >= 1, "renderedSvgElement", "pixmapSize is NULL");
-    QPixmap pixmap(pixmapSize);
+    QImage pixmap = transparentImage(pixmapSize);
     Q_ASSERT_X(!pixmap.isNull(), "renderedSvgElement", "pixmap is NULL");
-    pixmap.fill(Qt::transparent);
     QPainter p(&pixmap);
-    renderer->render(&p, idPrefix + elementId, QRect(QPoint(), pixmapSize));
+    drawSvgElement(file, &p, elementName, QRect(QPoint(), pixmapSize));
     return pixmap;
 }
 
-inline static void drawGradient(DesignElementType type, QImage &image)
+// Vignette index tables by image size. They are shared by buttons and frames.
+typedef QCache<quint64, QByteArray> VignetteTableCache;
+Q_GLOBAL_STATIC_WITH_INITIALIZER(VignetteTableCache, vignetteTableCache, {
+    x->setMaxCost(2 * 1024 * 1024);
+})
+static QMutex vignetteTablesMutex; // Guards vignetteTableCache()
+
+inline static QByteArray vignetteTable(const QSize &size, VignetteImplementation implementation)
 {
-    const int imageWidth = image.width();
-    const QImage *gradient = type == DesignElementTypeButton ? buttonGradient() : frameGradient();
-    const QRgb *gradientRgb = reinterpret_cast<const QRgb*>(gradient->constBits());
-    QRgb *imageRgb = reinterpret_cast<QRgb*>(image.bits());
-    const int quarterWidth = imageWidth / 2;
-    const int quarterHeight = image.height() / 2;
-    // Right triangle with a, b = 181.0193359837561662; c = 256.
-    const qreal xScaleFactor = 181.0193359837561662 / quarterWidth;
-    const qreal yScaleFactor = 181.0193359837561662 / quarterHeight;
-
-    for (int y = 0; y <= quarterHeight; y++) {
-        const int scaledY = yScaleFactor * y;
-        const int scaledYSquare = scaledY * scaledY;
-        const int offsetYPlusQuarterWidth = quarterWidth + imageWidth * (quarterHeight - y);
-        for (int x = 0; x <= quarterWidth; x++) {
-            const int scaledX = xScaleFactor * x;
-            const int gradientColorIndex = int(sqrt(qreal(scaledYSquare + scaledX * scaledX)));
-            const QRgb gradientColor = gradientRgb[gradientColorIndex];
-            imageRgb[offsetYPlusQuarterWidth - x] = gradientColor;
-            imageRgb[offsetYPlusQuarterWidth + x] = gradientColor;
-        }
-    }
-    const int bytesPerLine = image.bytesPerLine();
-    QRgb *dst = imageRgb + imageWidth * image.height() - imageWidth;
-    QRgb *src = imageRgb;
-    for (int row = 0; row < quarterHeight; row++) {
-        memcpy(dst, src, bytesPerLine);
-        dst -= imageWidth;
-        src += imageWidth;
+    const quint64 key = (quint64(size.width()) << 32) | quint64(size.height());
+    {
+        QMutexLocker locker(&vignetteTablesMutex);
+        if (const QByteArray *table = vignetteTableCache()->object(key))
+            return *table;
     }
+    const QByteArray table = vignetteIndexTable(size, implementation);
+    QMutexLocker locker(&vignetteTablesMutex);
+    vignetteTableCache()->insert(key, new QByteArray(table), table.size());
+    return table;
 }
 
-inline static QPixmap renderedDesignElement(DesignElementType type, int variation, QSize *size, const QSize &requestedSize)
+inline static void drawGradient(DesignElementType type, QImage &image)
 {
-    Q_UNUSED(size)
+    const QImage *gradient = type == DesignElementTypeButton ? buttonGradient() : frameGradient();
+    const VignetteImplementation implementation = fastestVignetteImplementation();
+    drawVignette(&image, *gradient, vignetteTable(image.size(), implementation), implementation);
+}
 
+inline static const QString &designElementId(DesignElementType type, int variation, const QSize &requestedSize)
+{
     const ElementVariationList *elements = type == DesignElementTypeButton ? buttonVariations() : frameVariations();
     const qreal requestedRatio = requestedSize.width() / qreal(requestedSize.height());
     const ElementVariations *elementWithNearestRatio = &elements->last();
@@ -360,33 +897,82 @@ inline static QPixmap renderedDesignElement(DesignElementType type, int variatio
             break;
         }
     }
-    const QString &elementId = idPrefix + elementWithNearestRatio->elementIds.at(variation % elementWithNearestRatio->elementIds.count());
-    static QPixmap cachedGradientButton;
-    static QPixmap cachedGradientFrame;
-    QPixmap &cachedGradient = type == DesignElementTypeButton ? cachedGradientButton : cachedGradientFrame;
-    if (cachedGradient.size() == requestedSize) {
-        QPixmap result(cachedGradient);
-        QPainter p(&result);
-        designRenderer()->render(&p, elementId, result.rect());
-        return result;
-    } else {
-        QImage result(requestedSize, QImage::Format_ARGB32);
-        result.fill(0);
-        drawGradient(type, result);
-        cachedGradient = QPixmap::fromImage(result);
-        QPainter p(&result);
-        designRenderer()->render(&p, elementId, result.rect());
-        return QPixmap::fromImage(result);
-    }
-}
-
-inline static QPixmap renderedLessonIcon(const QString &iconId, int buttonVariation, QSize *size, const QSize &requestedSize)
-{
-    QPixmap icon(requestedSize);
-    icon.fill(Qt::transparent);
+    return elementWithNearestRatio->elementIds.at(variation % elementWithNearestRatio->elementIds.count());
+}
+
+typedef QCache<QString, QImage> DesignLayerCache;
+
+static QMutex designLayersMutex; // Guards designLayerCache()
+
+// Gradients (per type and size) and SVG overlays (per element and size) of
+// buttons and frames. Buttons, lesson icons and the frame of a screen have
+// different sizes, and would otherwise keep evicting each other.
+Q_GLOBAL_STATIC_WITH_INITIALIZER(DesignLayerCache, designLayerCache, {
+    x->setMaxCost(6 * 1024 * 1024); // Bytes
+})
+
+inline static QString designLayerKey(const QString &layerId, const QSize &size)
+{
+    return layerId + QLatin1Char('@') + QString::number(size.width())
+            + QLatin1Char('x') + QString::number(size.height());
+}
+
+inline static QImage cachedDesignLayer(const QString &key)
+{
+    QMutexLocker locker(&designLayersMutex);
+    const QImage *layer = designLayerCache()->object(key);
+    return layer ? *layer : QImage();
+}
+
+inline static void insertDesignLayer(const QString &key, const QImage &layer)
+{
+    QMutexLocker locker(&designLayersMutex);
+    designLayerCache()->insert(key, new QImage(layer), layer.byteCount());
+}
+
+inline static QImage designGradientLayer(DesignElementType type, const QSize &size)
+{
+    const QString key = designLayerKey(type == DesignElementTypeButton ? buttonString : frameString, size);
+    QImage gradient = cachedDesignLayer(key);
+    if (gradient.isNull()) {
+        QImage image(size, QImage::Format_ARGB32);
+        drawGradient(type, image);
+        gradient = image.convertToFormat(QImage::Format_ARGB32_Premultiplied);
+        insertDesignLayer(key, gradient);
+    }
+    return gradient;
+}
+
+inline static QImage designOverlayLayer(const QString &elementId, const QSize &size)
+{
+    const QString key = designLayerKey(elementId, size);
+    QImage overlay = cachedDesignLayer(key);
+    if (overlay.isNull()) {
+        overlay = transparentImage(size);
+        QPainter p(&overlay);
+        drawSvgElement(SvgFileDesign, &p, elementId, overlay.rect());
+        p.end();
+        insertDesignLayer(key, overlay);
+    }
+    return overlay;
+}
+
+inline static QImage renderedDesignElement(DesignElementType type, int variation, QSize *size, const QSize &requestedSize)
+{
+    Q_UNUSED(size)
+
+    const QImage overlay = designOverlayLayer(designElementId(type, variation, requestedSize), requestedSize);
+    QImage result = designGradientLayer(type, requestedSize);
+    QPainter p(&result); // Detaches from the cached gradient
+    p.drawImage(0, 0, overlay); // Premultiplied source-over
+    return result;
+}
+
+inline static QImage renderedLessonIcon(const QString &iconId, int buttonVariation, QSize *size, const QSize &requestedSize)
+{
+    QImage icon = transparentImage(requestedSize);
     QPainter p(&icon);
-    QSvgRenderer *renderer = lessonIconsRenderer();
-    const QRectF iconRectOriginal = renderer->boundsOnElement(idPrefix + iconId);
+    const QRectF iconRectOriginal = elementIndex(SvgFileLessonIcons).bounds(iconId);
     QSizeF iconSize = iconRectOriginal.size();
     iconSize.scale(requestedSize, Qt::KeepAspectRatio);
     QRectF iconRect(QPointF(), iconSize);
@@ -394,13 +980,13 @@ inline static QPixmap renderedLessonIcon(const QString &iconId, int buttonVariat
         iconRect.moveBottom(requestedSize.height());
     else
         iconRect.moveTop((requestedSize.height() - iconSize.height()) / 2);
-    renderer->render(&p, idPrefix + iconId, iconRect);
-    const QPixmap button = renderedDesignElement(DesignElementTypeButton, buttonVariation, size, requestedSize);
-    p.drawPixmap(QPointF(), button);
+    drawSvgElement(SvgFileLessonIcons, &p, iconId, iconRect);
+    const QImage button = renderedDesignElement(DesignElementTypeButton, buttonVariation, size, requestedSize);
+    p.drawImage(QPointF(), button);
     return icon;
 }
 
-inline static QPixmap spectrum(QSize *size, const QSize &requestedSize)
+inline static QImage spectrum(QSize *size, const QSize &requestedSize)
 {
     const QSize resultSize(360, requestedSize.height());
     QImage result(resultSize.width(), 1, QImage::Format_ARGB32);
@@ -409,129 +995,559 @@ inline static QPixmap spectrum(QSize *size, const QSize &requestedSize)
         *(bits++) = QColor::fromHsl(i, 120, 200).rgb();
     if (size)
         *size = result.size();
-    return QPixmap::fromImage(result.scaled(resultSize));
+    return result.scaled(resultSize);
 }
 
-inline static QPixmap colorBlot(const QColor &color, int blotVariation, QSize *size, const QSize &requestedSize)
+// The color independent parts of a color blot. The mask is tinted with the
+// requested color and the highlight is blended on top, per request.
+struct ColorBlotLayers
 {
-    QSvgRenderer *renderer = designRenderer();
-    const static QString elementIdBase = QLatin1String("colorblot");
-    const static int variationsCnt = variationsCount(renderer, elementIdBase);
-    const int actualVariation = (blotVariation % variationsCnt) + 1;
-    const QString elementId = elementIdBase + QLatin1Char('_') + QString::number(actualVariation);
+    QImage mask; // Format_Indexed8 alpha values
+    QImage highlight;
+    QSize originalSize;
+};
+
+typedef QCache<QString, ColorBlotLayers> ColorBlotLayersCache;
+
+static QMutex colorBlotLayersMutex; // Guards colorBlotLayersCache()
+
+Q_GLOBAL_STATIC_WITH_INITIALIZER(ColorBlotLayersCache, colorBlotLayersCache, {
+    x->setMaxCost(2 * 1024 * 1024); // Bytes
+})
+
+inline static ColorBlotLayers *createdColorBlotLayers(int actualVariation, const QSize &requestedSize)
+{
+    const QString elementId = colorBlotString + QLatin1Char('_') + QString::number(actualVariation);
     const QString maskElementId = elementId + QLatin1String("_mask");
     const QString highlightElementId = elementId + QLatin1String("_highlight");
-    const QRectF backgroundRect = renderer->boundsOnElement(idPrefix + elementId);
-    QSize pixmapSize = backgroundRect.size().toSize();
-    if (size)
-        *size = pixmapSize;
+    const SvgElementIndex &index = elementIndex(SvgFileDesign);
+    const QRectF backgroundRect = index.bounds(elementId);
+    ColorBlotLayers *layers = new ColorBlotLayers;
+    layers->originalSize = backgroundRect.size().toSize();
+    QSize pixmapSize = layers->originalSize;
     pixmapSize.scale(requestedSize, Qt::KeepAspectRatio);
     const qreal scaleFactor = pixmapSize.width() / backgroundRect.width();
     QTransform transform =
             QTransform::fromScale(scaleFactor, scaleFactor);
     transform.translate(-backgroundRect.topLeft().x(), -backgroundRect.topLeft().y());
-    QImage image(pixmapSize, QImage::Format_ARGB32);
-    if (image.isNull())
-        qDebug() << "****************** clock pixmap is NULL! Variation:" << blotVariation;
-    image.fill(0);
-    QPainter p(&image);
-    p.setTransform(transform);
-    renderer->render(&p, idPrefix + maskElementId, renderer->boundsOnElement(idPrefix + maskElementId));
-    p.save();
-    p.setCompositionMode(QPainter::CompositionMode_SourceIn);
-    p.fillRect(backgroundRect, color);
-    p.restore();
-    renderer->render(&p, idPrefix + highlightElementId, renderer->boundsOnElement(idPrefix + highlightElementId));
-    return QPixmap::fromImage(image);
+    QImage maskImage = transparentImage(pixmapSize);
+    if (maskImage.isNull())
+        qDebug() << "****************** color blot pixmap is NULL! Variation:" << actualVariation;
+    {
+        QPainter p(&maskImage);
+        p.setTransform(transform);
+        drawSvgElement(SvgFileDesign, &p, maskElementId, index.bounds(maskElementId));
+    }
+    layers->mask = alphaMask(maskImage);
+    layers->highlight = transparentImage(pixmapSize);
+    if (index.hasCompanion(elementId, SvgElementIndex::CompanionHighlight)) {
+        QPainter p(&layers->highlight);
+        p.setTransform(transform);
+        drawSvgElement(SvgFileDesign, &p, highlightElementId, index.bounds(highlightElementId));
+    }
+    return layers;
 }
 
-QPixmap ImageProvider::requestPixmap(const QString &id, QSize *size, const QSize &requestedSize)
+inline static QImage colorBlot(const QColor &color, int blotVariation, QSize *size, const QSize &requestedSize)
 {
-    QPixmap result;
-    const QStringList idSegments = id.split(QLatin1Char('/'));
-    if (requestedSize.width() < 1 && requestedSize.height() < 1) {
-        qDebug() << "****************** requestedSize is NULL!" << requestedSize << id;
-        return QPixmap();
-    }
-    if (idSegments.count() < 2) {
-        qDebug() << "Not enough parameters for the image provider: " << id;
-        return QPixmap();
-    }
-    const QString &elementId = idSegments.at(1);
-    if (idSegments.first() == QLatin1String("background")) {
-        return renderedSvgElement(elementId, designRenderer(), Qt::KeepAspectRatioByExpanding, size, requestedSize);
-    } else if (idSegments.first() == QLatin1String("title")) {
-        if (elementId == QLatin1String("textmask"))
-            result = renderedSvgElement(idSegments.first(), designRenderer(), Qt::KeepAspectRatio, size, requestedSize);
-        else
-            result = spectrum(size, requestedSize);
-    } else if (idSegments.first() == QLatin1String("specialbutton")) {
-        result = renderedSvgElement(elementId, designRenderer(), Qt::IgnoreAspectRatio, size, requestedSize);
-    } else if (idSegments.first() == buttonString) {
-        result = renderedDesignElement(DesignElementTypeButton, elementId.toInt(), size, requestedSize);
-    } else if (idSegments.first() == frameString) {
-        result = renderedDesignElement(DesignElementTypeFrame, 0, size, requestedSize);
-    } else if (idSegments.first() == QLatin1String("object")) {
-        result = renderedSvgElement(elementId, objectRenderer(), Qt::KeepAspectRatio, size, requestedSize);
-    } else if (idSegments.first() == QLatin1String("clock")) {
-        if (idSegments.count() != 4) {
-            qDebug() << "Wrong number of parameters for clock images:" << id;
-            return QPixmap();
+    const int actualVariation = (blotVariation % colorBlotVariationsCount()) + 1;
+    const QString layersKey = QString::number(actualVariation) + QLatin1Char('@')
+            + QString::number(requestedSize.width()) + QLatin1Char('x') + QString::number(requestedSize.height());
+    ColorBlotLayers layers;
+    {
+        QMutexLocker locker(&colorBlotLayersMutex);
+        if (const ColorBlotLayers *cachedLayers = colorBlotLayersCache()->object(layersKey))
+            layers = *cachedLayers;
+    }
+    if (layers.mask.isNull()) {
+        ColorBlotLayers *createdLayers = createdColorBlotLayers(actualVariation, requestedSize);
+        layers = *createdLayers;
+        QMutexLocker locker(&colorBlotLayersMutex);
+        colorBlotLayersCache()->insert(layersKey, createdLayers,
+                                       layers.mask.byteCount() + layers.highlight.byteCount());
+    }
+    if (size)
+        *size = layers.originalSize;
+    QImage image(layers.highlight.size(), QImage::Format_ARGB32_Premultiplied);
+    tintAndComposite(&image, layers.mask, premultipliedColor(color.rgba()), layers.highlight,
+                     fastestColorTintImplementation());
+    return image;
+}
+
+inline static void appendSize(QString *key, const QSize &size)
+{
+    key->append(QLatin1Char('@'));
+    key->append(QString::number(size.width()));
+    key->append(QLatin1Char('x'));
+    key->append(QString::number(size.height()));
+}
+
+// Each family appends a canonical id to the cache key. Ids which only
+// differ by a "variation % count" get the same key. Returns false if the
+// images of a family must not be cached.
+typedef bool (*CanonicalIdFunction)(const ImageRequest &request, const QSize &requestedSize, QString *key);
+typedef QImage (*RenderFunction)(const ImageRequest &request, QSize *size, const QSize &requestedSize);
+
+static bool canonicalIdAsRequested(const ImageRequest &request, const QSize &requestedSize, QString *key)
+{
+    Q_UNUSED(requestedSize)
+    key->append(request.id());
+    return true;
+}
+
+static bool canonicalButtonId(const ImageRequest &request, const QSize &requestedSize, QString *key)
+{
+    key->append(buttonString);
+    key->append(QLatin1Char('/'));
+    key->append(designElementId(DesignElementTypeButton, request.intArgument(0), requestedSize));
+    return true;
+}
+
+static bool canonicalFrameId(const ImageRequest &request, const QSize &requestedSize, QString *key)
+{
+    Q_UNUSED(request)
+    Q_UNUSED(requestedSize)
+    key->append(frameString);
+    return true;
+}
+
+static bool canonicalClockId(const ImageRequest &request, const QSize &requestedSize, QString *key)
+{
+    Q_UNUSED(requestedSize)
+    key->append(ImageRequest::familyName(ImageFamilyClock));
+    key->append(QLatin1Char('/'));
+    key->append(QString::number(request.intArgument(0)));
+    key->append(QLatin1Char('/'));
+    key->append(QString::number(request.intArgument(1)));
+    key->append(QLatin1Char('/'));
+    key->append(QString::number(request.intArgument(2) % clockVariationsCount()));
+    return true;
+}
+
+static bool canonicalColorId(const ImageRequest &request, const QSize &requestedSize, QString *key)
+{
+    Q_UNUSED(requestedSize)
+    key->append(ImageRequest::familyName(ImageFamilyColor));
+    key->append(QLatin1Char('/'));
+    key->append(request.argument(0)); // Not normalized, "#FF0" and "yellow" are cached separately
+    key->append(QLatin1Char('/'));
+    key->append(QString::number(request.intArgument(1) % colorBlotVariationsCount()));
+    return true;
+}
+
+static bool canonicalLessonIconId(const ImageRequest &request, const QSize &requestedSize, QString *key)
+{
+    key->append(ImageRequest::familyName(ImageFamilyLessonIcon));
+    key->append(QLatin1Char('/'));
+    key->append(request.argument(0));
+    key->append(QLatin1Char('/'));
+    key->append(designElementId(DesignElementTypeButton, request.intArgument(1), requestedSize));
+    return true;
+}
+
+static bool canonicalQuantityId(const ImageRequest &request, const QSize &requestedSize, QString *key)
+{
+    Q_UNUSED(requestedSize)
+    if (request.argumentCount() < 3)
+        return false; // Random layout on each request
+    key->append(ImageRequest::familyName(ImageFamilyQuantity));
+    key->append(QLatin1Char('/'));
+    key->append(QString::number(request.intArgument(0)));
+    key->append(QLatin1Char('/'));
+    key->append(request.argument(1));
+    key->append(QLatin1Char('/'));
+    key->append(QString::number(qAbs(request.intArgument(2))));
+    return true;
+}
+
+static QImage renderBackground(const ImageRequest &request, QSize *size, const QSize &requestedSize)
+{
+    return renderedSvgElement(request.argument(0).toString(), SvgFileDesign, Qt::KeepAspectRatioByExpanding, size, requestedSize);
+}
+
+static QImage renderTitle(const ImageRequest &request, QSize *size, const QSize &requestedSize)
+{
+    if (request.argument(0) == QLatin1String("textmask"))
+        return renderedSvgElement(ImageRequest::familyName(ImageFamilyTitle), SvgFileDesign, Qt::KeepAspectRatio, size, requestedSize);
+    return spectrum(size, requestedSize);
+}
+
+static QImage renderSpecialButton(const ImageRequest &request, QSize *size, const QSize &requestedSize)
+{
+    return renderedSvgElement(request.argument(0).toString(), SvgFileDesign, Qt::IgnoreAspectRatio, size, requestedSize);
+}
+
+static QImage renderButton(const ImageRequest &request, QSize *size, const QSize &requestedSize)
+{
+    return renderedDesignElement(DesignElementTypeButton, request.intArgument(0), size, requestedSize);
+}
+
+static QImage renderFrame(const ImageRequest &request, QSize *size, const QSize &requestedSize)
+{
+    Q_UNUSED(request)
+    return renderedDesignElement(DesignElementTypeFrame, 0, size, requestedSize);
+}
+
+static QImage renderObject(const ImageRequest &request, QSize *size, const QSize &requestedSize)
+{
+    return renderedSvgElement(request.argument(0).toString(), SvgFileObjects, Qt::KeepAspectRatio, size, requestedSize);
+}
+
+static QImage renderClock(const ImageRequest &request, QSize *size, const QSize &requestedSize)
+{
+    return clock(request.intArgument(0), request.intArgument(1), request.intArgument(2), size, requestedSize);
+}
+
+static QImage renderNotes(const ImageRequest &request, QSize *size, const QSize &requestedSize)
+{
+    return notes(request.argument(0).toString().split(QLatin1Char(','), QString::SkipEmptyParts), size, requestedSize);
+}
+
+static QImage renderQuantity(const ImageRequest &request, QSize *size, const QSize &requestedSize)
+{
+    const int seed = request.argumentCount() > 2 ? qAbs(request.intArgument(2)) : -1;
+    return quantity(request.intArgument(0), request.argument(1).toString(), seed, size, requestedSize);
+}
+
+static QImage renderLessonIcon(const ImageRequest &request, QSize *size, const QSize &requestedSize)
+{
+    return renderedLessonIcon(request.argument(0).toString(), request.intArgument(1), size, requestedSize);
+}
+
+static QImage renderColor(const ImageRequest &request, QSize *size, const QSize &requestedSize)
+{
+    return colorBlot(QColor(request.argument(0).toString()), request.intArgument(1), size, requestedSize);
+}
+
+struct ImageFamilyHandler
+{
+    CanonicalIdFunction canonicalId;
+    RenderFunction render;
+};
+
+// Indexed by ImageFamily
+static const ImageFamilyHandler imageFamilyHandlers[ImageFamilyCount] = {
+    { canonicalIdAsRequested,   renderBackground },
+    { canonicalIdAsRequested,   renderTitle },
+    { canonicalIdAsRequested,   renderSpecialButton },
+    { canonicalButtonId,        renderButton },
+    { canonicalFrameId,         renderFrame },
+    { canonicalIdAsRequested,   renderObject },
+    { canonicalClockId,         renderClock },
+    { canonicalIdAsRequested,   renderNotes },
+    { canonicalQuantityId,      renderQuantity },
+    { canonicalLessonIconId,    renderLessonIcon },
+    { canonicalColorId,         renderColor }
+};
+
+// Returns an empty key for images that must not be cached
+inline static QString cacheKey(const ImageRequest &request, const QSize &requestedSize)
+{
+    QString key;
+    key.reserve(request.id().length() + 24);
+    if (!imageFamilyHandlers[request.family()].canonicalId(request, requestedSize, &key))
+        return QString();
+    appendSize(&key, requestedSize);
+    return key;
+}
+
+inline static void insertIntoCache(const QString &key, const QImage &image, const QSize &originalSize)
+{
+    CachedImage *cached = new CachedImage;
+    cached->image = image;
+    cached->originalSize = originalSize;
+    QMutexLocker locker(&cacheMutex);
+    imageCache()->insert(key, cached, image.byteCount());
+}
+
+// Parses SVG files and builds their element indexes on worker threads
+class AssetLoadTask : public QRunnable
+{
+public:
+    AssetLoadTask(SvgFile file)
+        : m_file(file)
+    { }
+
+    void run()
+    {
+        {
+            QMutexLocker locker(&parsingMutexes[m_file]);
+            QSvgRenderer *renderer = new QSvgRenderer(svgAsset(m_file).document);
+            elementIndex(m_file, renderer);
+            {
+                QMutexLocker displayListsLocker(&displayListsMutex);
+                readDisplayListFile(m_file);
+            }
+            renderer->moveToThread(0);
+            spareRenderers[m_file].append(renderer);
         }
-        result = clock(idSegments.at(1).toInt(), idSegments.at(2).toInt(), idSegments.at(3).toInt(), size, requestedSize);
-    } else if (idSegments.first() == QLatin1String("notes")) {
-        result = notes(elementId.split(QLatin1Char(','), QString::SkipEmptyParts), size, requestedSize);
-    } else if (idSegments.first() == QLatin1String("quantity")) {
-        if (idSegments.count() != 3) {
-            qDebug() << "Wrong number of parameters for quantity images:" << id;
-            return QPixmap();
+        // Not while parsing: a rendering thread may derive them first, and
+        // wait for the parsed file meanwhile
+        if (m_file == SvgFileDesign) {
+            buttonVariations();
+            frameVariations();
         }
-        result = quantity(idSegments.at(1).toInt(), idSegments.at(2), size, requestedSize);
-    } else if (idSegments.first() == QLatin1String("lessonicon")) {
-        if (idSegments.count() != 3) {
-            qDebug() << "Wrong number of parameters for lessonicon:" << id;
-            return QPixmap();
+    }
+
+private:
+    const SvgFile m_file;
+};
+
+Q_GLOBAL_STATIC_WITH_INITIALIZER(QThreadPool, assetLoaderPool, {
+    x->setMaxThreadCount(qMax(2, QThread::idealThreadCount()));
+})
+
+static QBasicAtomicInt assetLoadRequested[SvgFileCount];
+
+// Each file is loaded in the background at most once. Files which are
+// needed before that are parsed by the rendering thread itself.
+inline static void loadAssetInBackground(SvgFile file, int priority)
+{
+    if (assetLoadRequested[file].testAndSetOrdered(0, 1))
+        assetLoaderPool()->start(new AssetLoadTask(file), priority);
+}
+
+inline static QImage requestedImage(const ImageRequest &request, QSize *size, const QSize &requestedSize)
+{
+    const QString key = cacheKey(request, requestedSize);
+    const quint64 hash = key.isEmpty() ? 0 : sourceHash(request.family());
+    QSize originalSize;
+    if (!key.isEmpty()) {
+        {
+            QMutexLocker locker(&cacheMutex);
+            if (const CachedImage *cached = imageCache()->object(key)) {
+                cacheHitsCount++;
+                if (size)
+                    *size = cached->originalSize;
+                return cached->image;
+            }
+            cacheMissesCount++;
         }
-        result = renderedLessonIcon(idSegments.at(1), idSegments.at(2).toInt(), size, requestedSize);
-    } else if (idSegments.first() == QLatin1String("color")) {
-        if (idSegments.count() != 3) {
-            qDebug() << "Wrong number of parameters for color:" << id;
-            return QPixmap();
+        const QImage packed = assetPack()->image(key, hash, &originalSize);
+        if (!packed.isNull()) {
+            insertIntoCache(key, packed, originalSize);
+            if (size)
+                *size = originalSize;
+            return packed;
+        }
+        const QImage stored = diskCache()->image(key, hash, &originalSize);
+        if (!stored.isNull()) {
+            insertIntoCache(key, stored, originalSize);
+            if (size)
+                *size = originalSize;
+            return stored;
         }
-        const QColor color(idSegments.at(1));
-        result = colorBlot(color, idSegments.at(2).toInt(), size, requestedSize);
-    } else {
-        qDebug() << "invalid image Id:" << id;
     }
-#if 0
-    if (idSegments.first() == QLatin1String("object")) {
-        QPainter p(&result);
-        QPolygon points;
-        for (int i = 0; i < result.width(); i += 2)
-            for (int j = 0; j < result.height(); j += 2)
-                points.append(QPoint(i, j));
-        p.drawPoints(points);
-        p.setPen(Qt::white);
-        p.translate(1, 1);
-        p.drawPoints(points);
+
+    // Rendering happens unlocked. Two threads may render the same image, the
+    // latter one then replaces the cache entry.
+    const QImage result = imageFamilyHandlers[request.family()].render(request, &originalSize, requestedSize);
+    if (size)
+        *size = originalSize;
+    if (!key.isEmpty() && !result.isNull()) {
+        insertIntoCache(key, result, originalSize);
+        diskCache()->insert(key, hash, result, originalSize);
     }
-#endif
     return result;
 }
 
+QImage ImageProvider::requestImage(const QString &id, QSize *size, const QSize &requestedSize)
+{
+    const qint64 startTime = ImageProviderMetrics::currentMicroseconds();
+    ImageRequest request;
+    QImage result;
+    if (!request.parse(id))
+        qDebug() << "invalid image Id:" << id;
+    else if (requestedSize.width() < 1 && requestedSize.height() < 1)
+        qDebug() << "****************** requestedSize is NULL!" << requestedSize << id;
+    else
+        result = requestedImage(request, size, requestedSize);
+    const qint64 elapsed = ImageProviderMetrics::currentMicroseconds() - startTime;
+    ImageProviderMetrics::recordRequest(request.family(), elapsed, result);
+    if (Tracer::isEnabled())
+        Tracer::addCompleteEvent("image", id, startTime, elapsed);
+    return result;
+}
+
+QPixmap ImageProvider::requestPixmap(const QString &id, QSize *size, const QSize &requestedSize)
+{
+    return QPixmap::fromImage(requestImage(id, size, requestedSize));
+}
+
 void ImageProvider::init()
 {
-    designRenderer()->boundsOnElement(QString());
-    objectRenderer()->boundsOnElement(QString());
-    countablesRenderer()->boundsOnElement(QString());
-    clocksRenderer()->boundsOnElement(QString());
-    notesRenderer()->boundsOnElement(QString());
-    lessonIconsRenderer()->boundsOnElement(QString());
+    // Needed by the lesson menu, the first screen
+    loadAssetInBackground(SvgFileDesign, 1);
+    loadAssetInBackground(SvgFileLessonIcons, 1);
+}
+
+void ImageProvider::loadRemainingAssets()
+{
+    for (int i = 0; i < SvgFileCount; i++)
+        loadAssetInBackground(SvgFile(i), 0);
+}
+
+void ImageProvider::loadAllAssets()
+{
+    for (int i = 0; i < SvgFileCount; i++) {
+        svgRenderer(SvgFile(i));
+        elementIndex(SvgFile(i));
+    }
     buttonVariations();
     frameVariations();
 }
 
+void ImageProvider::unloadAssets()
+{
+    assetLoaderPool()->waitForDone();
+    threadRendererPool.setLocalData(0);
+    for (int i = 0; i < SvgFileCount; i++) {
+        {
+            QMutexLocker locker(&parsingMutexes[i]);
+            qDeleteAll(spareRenderers[i]);
+            spareRenderers[i].clear();
+        }
+        assetLoadRequested[i].fetchAndStoreOrdered(0);
+        delete elementIndexes[i].fetchAndStoreOrdered(0);
+        delete svgAssets[i].fetchAndStoreOrdered(0);
+    }
+    {
+        QMutexLocker locker(&elementIndexMutex);
+        storedElementIndexes.clear();
+        storedElementIndexesRead = false;
+    }
+    {
+        QMutexLocker locker(&displayListsMutex);
+        for (int i = 0; i < SvgFileCount; i++) {
+            sharedDisplayLists[i].clear();
+            displayListFilesRead[i] = false;
+        }
+    }
+    buttonGradient.reset();
+    frameGradient.reset();
+    buttonVariations.reset();
+    frameVariations.reset();
+    clockVariations.reset();
+    colorBlotVariations.reset();
+    notesMetrics.reset();
+    clearCache();
+}
+
 void ImageProvider::setDataPath(const QString &path)
 {
     dataPath = path;
 }
+
+void ImageProvider::setDisplayListsEnabled(bool enabled)
+{
+    displayListsEnabled.fetchAndStoreOrdered(enabled ? 1 : 0);
+}
+
+void ImageProvider::setCacheByteBudget(int bytes)
+{
+    QMutexLocker locker(&cacheMutex);
+    imageCache()->setMaxCost(bytes);
+}
+
+int ImageProvider::cacheByteBudget()
+{
+    QMutexLocker locker(&cacheMutex);
+    return imageCache()->maxCost();
+}
+
+int ImageProvider::cacheHits()
+{
+    QMutexLocker locker(&cacheMutex);
+    return cacheHitsCount;
+}
+
+int ImageProvider::cacheMisses()
+{
+    QMutexLocker locker(&cacheMutex);
+    return cacheMissesCount;
+}
+
+void ImageProvider::clearCache()
+{
+    QMutexLocker locker(&cacheMutex);
+    imageCache()->clear();
+    QMutexLocker atlasLocker(&countableAtlasMutex);
+    countableAtlasCache()->clear();
+    QMutexLocker clockLocker(&clockLayersMutex);
+    clockLayersCache()->clear();
+    QMutexLocker notesLocker(&notesLayersMutex);
+    notesLayerCache()->clear();
+    QMutexLocker designLocker(&designLayersMutex);
+    designLayerCache()->clear();
+    QMutexLocker internedLocker(&internedElementsMutex);
+    for (int i = 0; i < SvgFileCount; i++)
+        internedElements[i].clear();
+    QMutexLocker vignetteLocker(&vignetteTablesMutex);
+    vignetteTableCache()->clear();
+    QMutexLocker colorBlotLocker(&colorBlotLayersMutex);
+    colorBlotLayersCache()->clear();
+    cacheHitsCount = 0;
+    cacheMissesCount = 0;
+}
+
+void ImageProvider::setDiskCacheFileName(const QString &fileName)
+{
+    diskCache()->setFileName(fileName);
+}
+
+void ImageProvider::setAssetPackFileName(const QString &fileName)
+{
+    assetPack()->setFileName(fileName);
+}
+
+bool ImageProvider::writeAssetPack(const QString &fileName, const QList<QPair<QString, QSize> > &requests)
+{
+    AssetPackWriter writer(fileName);
+    if (!writer.open())
+        return false;
+    for (int i = 0; i < requests.count(); i++) {
+        const QString &id = requests.at(i).first;
+        const QSize &requestedSize = requests.at(i).second;
+        ImageRequest request;
+        if (!request.parse(id)) {
+            qDebug() << "invalid image Id:" << id;
+            continue;
+        }
+        const QString key = cacheKey(request, requestedSize);
+        if (key.isEmpty() || writer.contains(key))
+            continue;
+        QSize originalSize;
+        const QImage image = imageFamilyHandlers[request.family()].render(request, &originalSize, requestedSize);
+        writer.add(key, sourceHash(request.family()), image, originalSize);
+    }
+    return writer.close();
+}
+
+void ImageProvider::setElementIndexFileName(const QString &fileName)
+{
+    elementIndexFileName = fileName;
+}
+
+void ImageProvider::saveDiskCache()
+{
+    QSet<quint64> svgFileHashes;
+    for (int i = 0; i < SvgFileCount; i++)
+        svgFileHashes.insert(svgAsset(SvgFile(i)).hash);
+
+    {
+        QMutexLocker locker(&elementIndexMutex);
+        if (elementIndexesChanged && !elementIndexFileName.isEmpty()) {
+            // Only keep the indexes of the current SVG files
+            SvgElementIndex::IndexesBySourceHash currentIndexes;
+            foreach (quint64 hash, svgFileHashes)
+                if (storedElementIndexes.contains(hash))
+                    currentIndexes.insert(hash, storedElementIndexes.value(hash));
+            if (SvgElementIndex::writeFile(elementIndexFileName, currentIndexes))
+                elementIndexesChanged = false;
+        }
+    }
+
+    QSet<quint64> validSourceHashes = svgFileHashes;
+    validSourceHashes.insert(lessonIconSourceHash());
+    diskCache()->save(validSourceHashes);
+}
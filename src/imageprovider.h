@@ -23,16 +23,56 @@
 #ifndef IMAGEPROVIDER_H
 #define IMAGEPROVIDER_H
 
+#include <QtCore/QList>
+#include <QtCore/QPair>
 #include <QtDeclarative/QDeclarativeImageProvider>
 
 class ImageProvider : public QDeclarativeImageProvider
 {
 public:
-    ImageProvider();
+    // With ImageType Image, the provider is reentrant and can be used for
+    // asynchronously loaded images.
+    ImageProvider(ImageType type = Pixmap);
 
+    QImage requestImage(const QString &id, QSize *size, const QSize &requestedSize);
     QPixmap requestPixmap(const QString &id, QSize *size, const QSize &requestedSize);
+    // Starts loading the assets for the first screen on worker threads, and
+    // returns immediately. Other assets load when they are first needed, or
+    // with loadRemainingAssets(), e.g. when the application is idle.
     static void init();
+    static void loadRemainingAssets();
+    // Loads all assets in the calling thread, and blocks until that is done
+    static void loadAllAssets();
+    // For measuring cold starts: drops the assets, everything derived from
+    // them and all caches. No images may be requested meanwhile.
+    static void unloadAssets();
     static void setDataPath(const QString &path);
+
+    // Replay display lists recorded from QSvgRenderer instead of rendering
+    // with it. Enabled by default.
+    static void setDisplayListsEnabled(bool enabled);
+
+    // Cache of rendered pixmaps, keyed by canonical id and requested size
+    static void setCacheByteBudget(int bytes);
+    static int cacheByteBudget();
+    static int cacheHits();
+    static int cacheMisses();
+    static void clearCache();
+
+    // Persistent cache of rendered images. Disabled without a file name.
+    static void setDiskCacheFileName(const QString &fileName);
+    // Images that were rendered offline for the screen profile, see
+    // bin/bakeassetpacks.sh. Images which are not in the pack get rendered.
+    // Must not be called while images are requested.
+    static void setAssetPackFileName(const QString &fileName);
+    // Renders the images into a new pack. Images that are never cached, and
+    // ids with the same cache key as a previous one, are skipped.
+    static bool writeAssetPack(const QString &fileName, const QList<QPair<QString, QSize> > &requests);
+    // Bounds and variations of the SVG elements, so that a warm start does
+    // not need to index the SVG files. Set before the first image is requested.
+    static void setElementIndexFileName(const QString &fileName);
+    // Saves the rendered images and, if it changed, the element index
+    static void saveDiskCache();
 };
 
 #endif // IMAGEPROVIDER_H
@@ -0,0 +1,51 @@
+# Touch'n'learn - Fun and easy mobile lessons for kids
+# Copyright (C) 2010, 2011 by Alessandro Portale
+# http://touchandlearn.sourceforge.net
+#
+# This file is part of Touch'n'learn
+#
+# Touch'n'learn is free software; you can redistribute it and/or modify
+# it under the terms of the GNU General Public License as published by
+# the Free Software Foundation, either version 3 of the License, or
+# (at your option) any later version.
+#
+# Touch'n'learn is distributed in the hope that it will be useful,
+# but WITHOUT ANY WARRANTY; without even the implied warranty of
+# MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+# GNU General Public License for more details.
+#
+# You should have received a copy of the GNU General Public License
+# along with Touch'n'learn; if not, write to the Free Software
+# Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA 02110-1301 USA
+
+# The image provider, shared by the application, the plugin and the tests
+
+INCLUDEPATH += $$PWD
+DEPENDPATH += $$PWD
+
+SOURCES += \
+    $$PWD/imageprovider.cpp \
+    $$PWD/assetpack.cpp \
+    $$PWD/colortint.cpp \
+    $$PWD/displaylist.cpp \
+    $$PWD/imagediskcache.cpp \
+    $$PWD/imageprovidermetrics.cpp \
+    $$PWD/imagerequest.cpp \
+    $$PWD/svgelementindex.cpp \
+    $$PWD/tracer.cpp \
+    $$PWD/vignette.cpp
+
+HEADERS += \
+    $$PWD/imageprovider.h \
+    $$PWD/assetpack.h \
+    $$PWD/colortint.h \
+    $$PWD/displaylist.h \
+    $$PWD/imagediskcache.h \
+    $$PWD/imageprovidermetrics.h \
+    $$PWD/imagerequest.h \
+    $$PWD/simd.h \
+    $$PWD/svgelementindex.h \
+    $$PWD/tracer.h \
+    $$PWD/vignette.h
+
+QT += svg
@@ -0,0 +1,216 @@
+/*
+    Touch'n'learn - Fun and easy mobile lessons for kids
+    Copyright (C) 2010, 2011 by Alessandro Portale
+    http://touchandlearn.sourceforge.net
+
+    This file is part of Touch'n'learn
+
+    Touch'n'learn is free software; you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    Touch'n'learn is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with Touch'n'learn; if not, write to the Free Software
+    Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA 02110-1301 USA
+*/
+
+#include "imageprovidermetrics.h"
+#include <QtCore/QDebug>
+#include <QtCore/QElapsedTimer>
+#include <QtCore/QStringList>
+#if defined(Q_OS_UNIX)
+#include <time.h>
+#elif defined(Q_OS_WIN)
+#include <QtCore/qt_windows.h>
+#endif
+
+// Families and ImageFamilyInvalid
+static const int countedFamiliesCount = ImageFamilyCount + 1;
+
+struct FamilyCounters
+{
+    QBasicAtomicInt requests;
+    QBasicAtomicInt failures;
+    QBasicAtomicInt outputKilobytes;
+    // The total latency is totalSeconds * 1000000 + totalMicroseconds, so
+    // that it does not wrap
+    QBasicAtomicInt totalSeconds;
+    QBasicAtomicInt totalMicroseconds;
+    QBasicAtomicInt histogram[ImageProviderMetrics::HistogramBucketCount];
+};
+
+static FamilyCounters familyCounters[countedFamiliesCount];
+
+inline static int histogramBucket(qint64 microseconds)
+{
+    int bucket = 0;
+    for (qint64 bound = 250; bucket < ImageProviderMetrics::HistogramBucketCount - 1 && microseconds >= bound;
+         bound *= 2)
+        bucket++;
+    return bucket;
+}
+
+inline static qint64 histogramBucketBound(int bucket)
+{
+    return qint64(250) << bucket;
+}
+
+inline static QString familyName(int family)
+{
+    return family < ImageFamilyCount ? ImageRequest::familyName(ImageFamily(family)) : QString::fromLatin1("invalid");
+}
+
+// Whoever moves totalMicroseconds across a multiple of a second carries one
+// second, so that totalMicroseconds stays small
+inline static void addToTotal(FamilyCounters *counters, qint64 microseconds)
+{
+    if (microseconds >= 1000000)
+        counters->totalSeconds.fetchAndAddRelaxed(int(microseconds / 1000000));
+    const int added = int(microseconds % 1000000);
+    const int previous = counters->totalMicroseconds.fetchAndAddRelaxed(added);
+    if ((previous + added) / 1000000 != previous / 1000000) {
+        counters->totalMicroseconds.fetchAndAddRelaxed(-1000000);
+        counters->totalSeconds.fetchAndAddRelaxed(1);
+    }
+}
+
+inline static qint64 totalMicroseconds(const FamilyCounters &counters)
+{
+    return qint64(int(counters.totalSeconds)) * 1000000 + int(counters.totalMicroseconds);
+}
+
+ImageProviderMetrics::ImageProviderMetrics(QObject *parent)
+    : QObject(parent)
+{
+    const int interval = qgetenv("TOUCHANDLEARN_METRICS_INTERVAL").toInt();
+    if (interval > 0) {
+        connect(&m_reportTimer, SIGNAL(timeout()), SLOT(printReport()));
+        m_reportTimer.start(interval * 1000);
+    }
+}
+
+void ImageProviderMetrics::recordRequest(ImageFamily family, qint64 microseconds, const QImage &image)
+{
+    FamilyCounters &counters = familyCounters[qBound(0, int(family), int(ImageFamilyInvalid))];
+    counters.requests.fetchAndAddRelaxed(1);
+    if (image.isNull())
+        counters.failures.fetchAndAddRelaxed(1);
+    else
+        counters.outputKilobytes.fetchAndAddRelaxed((image.byteCount() + 512) / 1024);
+    addToTotal(&counters, microseconds);
+    counters.histogram[histogramBucket(microseconds)].fetchAndAddRelaxed(1);
+}
+
+qint64 ImageProviderMetrics::currentMicroseconds()
+{
+#if defined(Q_OS_UNIX) && defined(CLOCK_MONOTONIC)
+    struct timespec time;
+    clock_gettime(CLOCK_MONOTONIC, &time);
+    return qint64(time.tv_sec) * 1000000 + time.tv_nsec / 1000;
+#elif defined(Q_OS_WIN)
+    LARGE_INTEGER frequency;
+    LARGE_INTEGER counter;
+    QueryPerformanceFrequency(&frequency);
+    QueryPerformanceCounter(&counter);
+    return counter.QuadPart / frequency.QuadPart * 1000000
+            + counter.QuadPart % frequency.QuadPart * 1000000 / frequency.QuadPart;
+#else
+    static QElapsedTimer timer;
+    if (!timer.isValid())
+        timer.start();
+    return timer.elapsed() * 1000;
+#endif
+}
+
+inline static QVariantMap familyMetrics(int family)
+{
+    const FamilyCounters &counters = familyCounters[family];
+    QVariantMap result;
+    result.insert(QLatin1String("family"), familyName(family));
+    result.insert(QLatin1String("requests"), int(counters.requests));
+    result.insert(QLatin1String("failures"), int(counters.failures));
+    result.insert(QLatin1String("outputKilobytes"), int(counters.outputKilobytes));
+    result.insert(QLatin1String("totalMicroseconds"), totalMicroseconds(counters));
+    QVariantList histogram;
+    for (int i = 0; i < ImageProviderMetrics::HistogramBucketCount; i++)
+        histogram.append(int(counters.histogram[i]));
+    result.insert(QLatin1String("histogram"), histogram);
+    return result;
+}
+
+QVariantList ImageProviderMetrics::families() const
+{
+    QVariantList result;
+    for (int i = 0; i < countedFamiliesCount; i++)
+        result.append(familyMetrics(i));
+    return result;
+}
+
+QVariantMap ImageProviderMetrics::family(const QString &name) const
+{
+    for (int i = 0; i < countedFamiliesCount; i++)
+        if (familyName(i) == name)
+            return familyMetrics(i);
+    return QVariantMap();
+}
+
+// Upper bound of the bucket which contains the percentile, in milliseconds
+inline static QString percentile(const FamilyCounters &counters, int requests, int percent)
+{
+    const int rank = (requests * percent + 99) / 100;
+    int count = 0;
+    for (int i = 0; i < ImageProviderMetrics::HistogramBucketCount - 1; i++) {
+        count += counters.histogram[i];
+        if (count >= rank)
+            return QLatin1Char('<') + QString::number(histogramBucketBound(i) / 1000.0);
+    }
+    return QLatin1String(">=") + QString::number(histogramBucketBound(ImageProviderMetrics::HistogramBucketCount - 2)
+                                                 / 1000.0);
+}
+
+QString ImageProviderMetrics::report() const
+{
+    QStringList lines;
+    lines.append(QLatin1String("family         requests failures       KB  mean ms   p50 ms   p90 ms   p99 ms"));
+    for (int i = 0; i < countedFamiliesCount; i++) {
+        const FamilyCounters &counters = familyCounters[i];
+        const int requests = counters.requests;
+        if (requests == 0)
+            continue;
+        lines.append(QString::fromLatin1("%1 %2 %3 %4 %5 %6 %7 %8")
+                     .arg(familyName(i), -14)
+                     .arg(requests, 8)
+                     .arg(int(counters.failures), 8)
+                     .arg(int(counters.outputKilobytes), 8)
+                     .arg(totalMicroseconds(counters) / 1000.0 / requests, 8, 'f', 2)
+                     .arg(percentile(counters, requests, 50), 8)
+                     .arg(percentile(counters, requests, 90), 8)
+                     .arg(percentile(counters, requests, 99), 8));
+    }
+    return lines.join(QLatin1String("\n"));
+}
+
+void ImageProviderMetrics::reset()
+{
+    for (int i = 0; i < countedFamiliesCount; i++) {
+        FamilyCounters &counters = familyCounters[i];
+        counters.requests.fetchAndStoreRelaxed(0);
+        counters.failures.fetchAndStoreRelaxed(0);
+        counters.outputKilobytes.fetchAndStoreRelaxed(0);
+        counters.totalSeconds.fetchAndStoreRelaxed(0);
+        counters.totalMicroseconds.fetchAndStoreRelaxed(0);
+        for (int j = 0; j < HistogramBucketCount; j++)
+            counters.histogram[j].fetchAndStoreRelaxed(0);
+    }
+}
+
+void ImageProviderMetrics::printReport()
+{
+    qDebug() << qPrintable(report());
+}
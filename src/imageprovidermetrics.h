@@ -0,0 +1,69 @@
+/*
+    Touch'n'learn - Fun and easy mobile lessons for kids
+    Copyright (C) 2010, 2011 by Alessandro Portale
+    http://touchandlearn.sourceforge.net
+
+    This file is part of Touch'n'learn
+
+    Touch'n'learn is free software; you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    Touch'n'learn is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with Touch'n'learn; if not, write to the Free Software
+    Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA 02110-1301 USA
+*/
+
+#ifndef IMAGEPROVIDERMETRICS_H
+#define IMAGEPROVIDERMETRICS_H
+
+#include <QtCore/QObject>
+#include <QtCore/QTimer>
+#include <QtCore/QVariant>
+#include <QtGui/QImage>
+
+#include "imagerequest.h"
+
+// Counts the ImageProvider requests of each image family: requests, failures,
+// output size and a latency histogram. The counters are shared by all
+// instances and updated without locks. If the environment variable
+// TOUCHANDLEARN_METRICS_INTERVAL is set, each instance prints a report every
+// that many seconds.
+class ImageProviderMetrics : public QObject
+{
+    Q_OBJECT
+
+public:
+    explicit ImageProviderMetrics(QObject *parent = 0);
+
+    // Histogram bucket i counts latencies below 250 << i microseconds, the
+    // last bucket all others
+    enum { HistogramBucketCount = 12 };
+
+    // Ids that could not be parsed are counted as family ImageFamilyInvalid
+    static void recordRequest(ImageFamily family, qint64 microseconds, const QImage &image);
+    // Monotonic, with a millisecond resolution on some platforms
+    static qint64 currentMicroseconds();
+
+    // Maps with the "family", "requests", "failures", "outputKilobytes",
+    // "totalMicroseconds" and "histogram" of each family
+    Q_INVOKABLE QVariantList families() const;
+    Q_INVOKABLE QVariantMap family(const QString &name) const;
+    // Table of all families that were requested, with latency percentiles
+    Q_INVOKABLE QString report() const;
+    Q_INVOKABLE void reset();
+
+private slots:
+    void printReport();
+
+private:
+    QTimer m_reportTimer;
+};
+
+#endif // IMAGEPROVIDERMETRICS_H
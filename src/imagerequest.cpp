@@ -0,0 +1,136 @@
+/*
+    Touch'n'learn - Fun and easy mobile lessons for kids
+    Copyright (C) 2010, 2011 by Alessandro Portale
+    http://touchandlearn.sourceforge.net
+
+    This file is part of Touch'n'learn
+
+    Touch'n'learn is free software; you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    Touch'n'learn is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with Touch'n'learn; if not, write to the Free Software
+    Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA 02110-1301 USA
+*/
+
+#include "imagerequest.h"
+#include <QtCore/QStringList>
+#include <limits.h>
+
+struct ImageFamilyGrammar
+{
+    const char *name;
+    int minimumArguments;
+    int maximumArguments; // -1: Additional arguments are ignored
+};
+
+// Indexed by ImageFamily
+static const ImageFamilyGrammar imageFamilyGrammars[ImageFamilyCount] = {
+    { "background",     1, -1 },
+    { "title",          1, -1 },
+    { "specialbutton",  1, -1 },
+    { "button",         1, -1 },
+    { "frame",          1, -1 },
+    { "object",         1, -1 },
+    { "clock",          3, 3 },
+    { "notes",          1, -1 },
+    { "quantity",       2, 3 },
+    { "lessonicon",     2, 2 },
+    { "color",          2, 2 }
+};
+
+static const QString emptyString;
+
+Q_GLOBAL_STATIC_WITH_INITIALIZER(QStringList, familyNames, {
+    for (int i = 0; i < ImageFamilyCount; i++)
+        x->append(QLatin1String(imageFamilyGrammars[i].name));
+})
+
+ImageRequest::ImageRequest()
+    : m_id(&emptyString)
+    , m_family(ImageFamilyInvalid)
+    , m_argumentCount(0)
+{
+}
+
+inline static ImageFamily imageFamily(const QChar *name, int length)
+{
+    for (int i = 0; i < ImageFamilyCount; i++) {
+        const char *familyName = imageFamilyGrammars[i].name;
+        int j = 0;
+        while (j < length && familyName[j] && name[j].unicode() == ushort(uchar(familyName[j])))
+            j++;
+        if (j == length && !familyName[j])
+            return ImageFamily(i);
+    }
+    return ImageFamilyInvalid;
+}
+
+bool ImageRequest::parse(const QString &id)
+{
+    m_id = &id;
+    m_family = ImageFamilyInvalid;
+    m_argumentCount = 0;
+
+    const QChar *characters = id.unicode();
+    const int length = id.length();
+    int segmentStart = 0;
+    while (segmentStart < length && characters[segmentStart] != QLatin1Char('/'))
+        segmentStart++;
+    const ImageFamily family = imageFamily(characters, segmentStart);
+    if (family == ImageFamilyInvalid)
+        return false;
+
+    int argumentsInId = 0;
+    while (segmentStart < length) {
+        segmentStart++; // Skip the slash
+        int segmentEnd = segmentStart;
+        while (segmentEnd < length && characters[segmentEnd] != QLatin1Char('/'))
+            segmentEnd++;
+        if (argumentsInId < MaxArguments)
+            m_arguments[argumentsInId] = QStringRef(&id, segmentStart, segmentEnd - segmentStart);
+        argumentsInId++;
+        segmentStart = segmentEnd;
+    }
+
+    const ImageFamilyGrammar &grammar = imageFamilyGrammars[family];
+    if (argumentsInId < grammar.minimumArguments
+            || (grammar.maximumArguments >= 0 && argumentsInId > grammar.maximumArguments))
+        return false;
+    m_family = family;
+    m_argumentCount = qMin(argumentsInId, int(MaxArguments));
+    return true;
+}
+
+int ImageRequest::intArgument(int index) const
+{
+    const QStringRef &argument = m_arguments[index];
+    const QChar *characters = argument.unicode();
+    const int length = argument.length();
+    int position = 0;
+    const bool negative = length > 0 && characters[0] == QLatin1Char('-');
+    if (negative)
+        position++;
+    if (position == length)
+        return 0;
+    int result = 0;
+    for (; position < length; position++) {
+        const ushort digit = characters[position].unicode() - '0';
+        if (digit > 9 || result > (INT_MAX - digit) / 10)
+            return 0;
+        result = result * 10 + digit;
+    }
+    return negative ? -result : result;
+}
+
+const QString &ImageRequest::familyName(ImageFamily family)
+{
+    return family < ImageFamilyCount ? familyNames()->at(family) : emptyString;
+}
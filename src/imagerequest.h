@@ -0,0 +1,73 @@
+/*
+    Touch'n'learn - Fun and easy mobile lessons for kids
+    Copyright (C) 2010, 2011 by Alessandro Portale
+    http://touchandlearn.sourceforge.net
+
+    This file is part of Touch'n'learn
+
+    Touch'n'learn is free software; you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    Touch'n'learn is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with Touch'n'learn; if not, write to the Free Software
+    Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA 02110-1301 USA
+*/
+
+#ifndef IMAGEREQUEST_H
+#define IMAGEREQUEST_H
+
+#include <QtCore/QString>
+
+enum ImageFamily {
+    ImageFamilyBackground,
+    ImageFamilyTitle,
+    ImageFamilySpecialButton,
+    ImageFamilyButton,
+    ImageFamilyFrame,
+    ImageFamilyObject,
+    ImageFamilyClock,
+    ImageFamilyNotes,
+    ImageFamilyQuantity,
+    ImageFamilyLessonIcon,
+    ImageFamilyColor,
+    ImageFamilyCount,
+    ImageFamilyInvalid = ImageFamilyCount
+};
+
+// Typed view of an image id like "clock/9/45/0". Parsing does not allocate,
+// the arguments reference the characters of the id, which therefore has to
+// outlive the request.
+class ImageRequest
+{
+public:
+    enum { MaxArguments = 3 };
+
+    ImageRequest();
+
+    // False, if the family is unknown or has a different number of arguments
+    bool parse(const QString &id);
+
+    ImageFamily family() const { return m_family; }
+    const QString &id() const { return *m_id; }
+    int argumentCount() const { return m_argumentCount; }
+    const QStringRef &argument(int index) const { return m_arguments[index]; }
+    // Decimal number, 0 if the argument is not a number or does not fit into an int
+    int intArgument(int index) const;
+
+    static const QString &familyName(ImageFamily family);
+
+private:
+    const QString *m_id;
+    ImageFamily m_family;
+    int m_argumentCount;
+    QStringRef m_arguments[MaxArguments];
+};
+
+#endif // IMAGEREQUEST_H
@@ -23,6 +23,8 @@
 #include <QtCore/QLocale>
 #include <QtCore/QTranslator>
 #include <QtGui/QApplication>
+#include <QtGui/QDesktopServices>
+#include <QtGui/QDesktopWidget>
 #include <QtGui/QGraphicsObject>
 #include <QtDeclarative/QDeclarativeEngine>
 #include <QtDeclarative/QDeclarativeContext>
@@ -32,18 +34,65 @@
 #endif // USING_OPENGL
 
 #include "qmlapplicationviewer.h"
+#include "exercisegenerator.h"
 #include "imageprovider.h"
+#include "imageprefetcher.h"
+#include "imageprovidermetrics.h"
+#include "settingsstore.h"
+#include "tracer.h"
 #ifndef NO_FEEDBACK
 #include "feedback.h"
 #endif // NO_FEEDBACK
 
+// Traces the paint events of the viewer, and every other event which blocks
+// the GUI thread for longer than a frame at 60 Hz. The startup span ends with
+// the first painted frame.
+class Application : public QApplication
+{
+public:
+    Application(int &argc, char **argv)
+        : QApplication(argc, argv)
+        , m_startTime(ImageProviderMetrics::currentMicroseconds())
+        , m_painted(false)
+    {
+    }
+
+    bool notify(QObject *receiver, QEvent *event)
+    {
+        if (!Tracer::isEnabled())
+            return QApplication::notify(receiver, event);
+        // The receiver may be deleted by the event
+        const QEvent::Type type = event->type();
+        const char *className = receiver->metaObject()->className();
+        const qint64 startTime = ImageProviderMetrics::currentMicroseconds();
+        const bool result = QApplication::notify(receiver, event);
+        const qint64 duration = ImageProviderMetrics::currentMicroseconds() - startTime;
+        if (type == QEvent::Paint) {
+            Tracer::addCompleteEvent("paint", QLatin1String(className), startTime, duration);
+            if (!m_painted) {
+                m_painted = true;
+                Tracer::addCompleteEvent("startup", QLatin1String("first frame"), m_startTime,
+                                         startTime + duration - m_startTime);
+            }
+        } else if (duration >= stallMicroseconds)
+            Tracer::addCompleteEvent("stall", QLatin1String(className) + QLatin1Char(' ')
+                                     + QString::number(type), startTime, duration);
+        return result;
+    }
+
+private:
+    static const qint64 stallMicroseconds = 16667;
+    const qint64 m_startTime;
+    bool m_painted;
+};
+
 int main(int argc, char *argv[])
 {
     qputenv("QML_ENABLE_TEXT_IMAGE_CACHE", "true");
     QCoreApplication::setApplicationName(QLatin1String("Touch'n'learn"));
     QApplication::setStartDragDistance(15);
     QApplication::setStyle(QLatin1String("windows"));
-    QApplication app(argc, argv);
+    Application app(argc, argv);
     const QString assetsPrefix =
 #if defined(ASSETS_VIA_QRC)
             QLatin1String(":/");
@@ -61,12 +110,40 @@ int main(int argc, char *argv[])
 
     // Registering dummy type to allow QML import of TouchAndLearn 1.0
     qmlRegisterType<QObject>("TouchAndLearn", 1, 0, "QObject");
+    qmlRegisterType<ExerciseGenerator>("TouchAndLearn", 1, 0, "ExerciseGenerator");
 
+#if defined(Q_WS_SIMULATOR) || defined(Q_WS_MAEMO_5) || defined(Q_WS_MAEMO_6) || defined(Q_OS_SYMBIAN) || defined(MEEGO_EDITION_HARMATTAN)
+    const QSize screenSize = QApplication::desktop()->screenGeometry().size();
+#else
+    const QSize screenSize(360, 640); // NHD. The N900 would be 480 x 800.
+#endif
+    // The UI is always laid out in portrait
+    const QString screenProfile = QString::number(qMin(screenSize.width(), screenSize.height())) + QLatin1Char('x')
+            + QString::number(qMax(screenSize.width(), screenSize.height()));
+
+    // Outlives the viewer, which writes the settings on destruction
+    SettingsStore settingsStore(QDesktopServices::storageLocation(QDesktopServices::DataLocation)
+                                + QLatin1String("/settings.bin"));
     QmlApplicationViewer viewer;
 #ifdef USING_OPENGL
     viewer.setViewport(new QGLWidget);
 #endif // USING_OPENGL
-    viewer.engine()->addImageProvider(QLatin1String("imageprovider"), new ImageProvider);
+    // Images may be requested from the loader thread as soon as the provider is added
+    ImageProvider::setDataPath(dataPath + QLatin1String("/graphics"));
+    const QString cacheLocation = QDesktopServices::storageLocation(QDesktopServices::CacheLocation);
+    ImageProvider::setDiskCacheFileName(cacheLocation + QLatin1String("/imagecache.bin"));
+    ImageProvider::setElementIndexFileName(cacheLocation + QLatin1String("/svgindex.bin"));
+    ImageProvider::setAssetPackFileName(dataPath + QLatin1String("/assetpacks/") + screenProfile + QLatin1String(".pack"));
+    ImageProvider::init(); // Loads in the background, while QML is being set up
+    viewer.engine()->addImageProvider(QLatin1String("imageprovider"), new ImageProvider(QDeclarativeImageProvider::Image));
+    ImagePrefetcher imagePrefetcher;
+    viewer.rootContext()->setContextProperty(QLatin1String("imageProvider"), &imagePrefetcher);
+    ImageProviderMetrics imageProviderMetrics;
+    viewer.rootContext()->setContextProperty(QLatin1String("imageProviderMetrics"), &imageProviderMetrics);
+    viewer.rootContext()->setContextProperty(QLatin1String("settingsStore"), &settingsStore);
+    Tracer tracer;
+    if (Tracer::isEnabled())
+        viewer.rootContext()->setContextProperty(QLatin1String("tracer"), &tracer);
     const QString mainQml = QLatin1String("qml/touchandlearn/main.qml");
 #ifdef ASSETS_VIA_QRC
     viewer.setSource(QUrl(QLatin1String("qrc:/") + mainQml));
@@ -77,11 +154,11 @@ int main(int argc, char *argv[])
 
 #ifndef NO_FEEDBACK
     Feedback::setDataPath(
-#ifdef USING_QT_MOBILITY
+#if defined(USING_PCM_MIXER) || defined(USING_QT_MOBILITY)
                 dataPath + QLatin1String("/audio")
-#else // USING_QT_MOBILITY
+#else // USING_PCM_MIXER || USING_QT_MOBILITY
                 assetsPrefix + QLatin1String("mp3audio")
-#endif // USING_QT_MOBILITY
+#endif // USING_PCM_MIXER || USING_QT_MOBILITY
     );
     Feedback feedback;
     viewer.rootContext()->setContextProperty("feedback", &feedback);
@@ -92,16 +169,12 @@ int main(int argc, char *argv[])
 #if defined(Q_WS_SIMULATOR)
     viewer.showFullScreen();
 #elif !defined(Q_WS_MAEMO_5) && !defined(Q_WS_MAEMO_6) && !defined(Q_OS_SYMBIAN) && !defined(MEEGO_EDITION_HARMATTAN)
-    if (false)
-        viewer.setGeometry(100, 100, 480, 800); // N900
-    else
-        viewer.setGeometry(100, 100, 360, 640); // NHD
+    viewer.setGeometry(QRect(QPoint(100, 100), screenSize));
 #endif
     viewer.setWindowFlags(Qt::Window | Qt::MSWindowsFixedSizeDialogHint | Qt::CustomizeWindowHint | Qt::WindowTitleHint | Qt::WindowCloseButtonHint);
     viewer.showExpanded();
 
-    ImageProvider::setDataPath(dataPath + QLatin1String("/graphics"));
-    ImageProvider::init();
-
-    return app.exec();
+    const int result = app.exec();
+    ImageProvider::saveDiskCache();
+    return result;
 }
@@ -0,0 +1,386 @@
+/*
+    Touch'n'learn - Fun and easy mobile lessons for kids
+    Copyright (C) 2010, 2011 by Alessandro Portale
+    http://touchandlearn.sourceforge.net
+
+    This file is part of Touch'n'learn
+
+    Touch'n'learn is free software; you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    Touch'n'learn is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with Touch'n'learn; if not, write to the Free Software
+    Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA 02110-1301 USA
+*/
+
+#include "midisynth.h"
+#include <QtCore/QDebug>
+#include <QtCore/QFile>
+#include <QtCore/QList>
+#include <QtCore/QtAlgorithms>
+
+struct MidiEvent
+{
+    qint64 tick;
+    uchar status;
+    uchar data1;
+    uchar data2;
+};
+
+struct TempoChange
+{
+    qint64 tick;
+    qint64 microsecondsPerQuarter;
+};
+
+inline static bool eventLessThan(const MidiEvent &a, const MidiEvent &b)
+{
+    return a.tick < b.tick;
+}
+
+inline static bool tempoChangeLessThan(const TempoChange &a, const TempoChange &b)
+{
+    return a.tick < b.tick;
+}
+
+inline static quint32 readBigEndian(const uchar *data, int bytes)
+{
+    quint32 result = 0;
+    for (int i = 0; i < bytes; i++)
+        result = (result << 8) | data[i];
+    return result;
+}
+
+inline static bool readVariableLength(const uchar *&data, const uchar *end, quint32 *value)
+{
+    *value = 0;
+    for (int i = 0; i < 4 && data < end; i++) {
+        const uchar byte = *data++;
+        *value = (*value << 7) | (byte & 0x7f);
+        if (!(byte & 0x80))
+            return true;
+    }
+    return false;
+}
+
+static bool parseTrack(const uchar *data, const uchar *end, QList<MidiEvent> *events, QList<TempoChange> *tempoChanges)
+{
+    qint64 tick = 0;
+    uchar runningStatus = 0;
+    while (data < end) {
+        quint32 delta;
+        if (!readVariableLength(data, end, &delta) || data >= end)
+            return false;
+        tick += delta;
+        uchar status = *data;
+        if (status & 0x80)
+            data++;
+        else if (runningStatus)
+            status = runningStatus;
+        else
+            return false;
+
+        if (status == 0xff) {
+            if (data >= end)
+                return false;
+            const uchar type = *data++;
+            quint32 length;
+            if (!readVariableLength(data, end, &length) || length > quint32(end - data))
+                return false;
+            if (type == 0x51 && length == 3) {
+                const TempoChange tempoChange = { tick, readBigEndian(data, 3) };
+                tempoChanges->append(tempoChange);
+            } else if (type == 0x2f) {
+                return true;
+            }
+            data += length;
+        } else if (status == 0xf0 || status == 0xf7) {
+            quint32 length;
+            if (!readVariableLength(data, end, &length) || length > quint32(end - data))
+                return false;
+            data += length;
+        } else if (status >= 0x80 && status < 0xf0) {
+            runningStatus = status;
+            const int dataBytes = (status & 0xe0) == 0xc0 ? 1 : 2; // Program change, channel pressure
+            if (end - data < dataBytes)
+                return false;
+            const MidiEvent event = { tick, status, data[0], uchar(dataBytes == 2 ? data[1] : 0) };
+            events->append(event);
+            data += dataBytes;
+        } else {
+            return false;
+        }
+    }
+    return true;
+}
+
+// Envelopes decay by 1/k per sample, but at least by 1. Half-lives in milliseconds.
+inline static int decayDivisor(int halfLife, int sampleRate)
+{
+    return qMax(1, int(qint64(halfLife) * sampleRate / 693)); // ln(2) * 1000
+}
+
+struct Instrument
+{
+    int modulatorRatio; // In quarters of the carrier frequency
+    int modulationIndex; // In hundredths of a radian
+    int attack; // Milliseconds
+    int decayHalfLife;
+    int modulationHalfLife; // 0: Follows the amplitude
+    int releaseHalfLife;
+};
+
+static const Instrument &instrument(int program)
+{
+    static const Instrument piano =             {  4, 150,  2,  600, 300,  80 };
+    static const Instrument chromaticPercussion = { 16, 180,  1,  450,  80, 150 };
+    static const Instrument organ =             {  4, 120, 10, 8000,   0,  60 };
+    static const Instrument brass =             {  4, 300, 25, 4000,   0,  60 };
+    static const Instrument reed =              {  8, 200, 20, 4000,   0,  60 };
+    static const Instrument pipe =              {  4,  60, 30, 4000,   0,  60 };
+    static const Instrument other =             {  4, 100,  5,  800, 400,  80 };
+    switch (program / 8) {
+    case 0: return piano;
+    case 1: return chromaticPercussion;
+    case 2: return organ;
+    case 7: return brass;
+    case 8: return reed;
+    case 9: return pipe;
+    default: return other;
+    }
+}
+
+static const int sineTableBits = 12;
+static const int sineTableSize = 1 << sineTableBits;
+
+// Amplitude 32767. Computed by a Taylor series in fixed point, instead of
+// the platform's sin().
+struct SineTable
+{
+    SineTable();
+    qint16 table[sineTableSize];
+};
+
+SineTable::SineTable()
+{
+    const int quarter = sineTableSize / 4;
+    const qint64 halfPi = Q_INT64_C(1686629713); // pi / 2 in Q30
+    for (int i = 0; i <= quarter; i++) {
+        const qint64 x = halfPi * i / quarter;
+        const qint64 x2 = (x * x) >> 30;
+        // x - x^3/3! + x^5/5! - ... in Horner form
+        qint64 sum = Q_INT64_C(1) << 30;
+        for (int n = 13; n > 1; n -= 2)
+            sum = (Q_INT64_C(1) << 30) - ((sum * x2 >> 30) / (n * (n - 1)));
+        const qint64 sine = (sum * x) >> 30;
+        const qint16 value = qint16(qMin(Q_INT64_C(32767), (sine * 32767 + (Q_INT64_C(1) << 29)) >> 30));
+        table[i] = value;
+        table[quarter * 2 - i] = value;
+        table[(quarter * 2 + i) % sineTableSize] = -value;
+        table[(quarter * 4 - i) % sineTableSize] = -value;
+    }
+}
+
+Q_GLOBAL_STATIC(SineTable, sineTable)
+
+// Phase increments of a 32 bit phase. The frequencies of the octave above
+// middle C in milli-Hz.
+inline static quint32 phaseIncrement(int key, int sampleRate)
+{
+    static const qint64 octaveFrequencies[12] = {
+        261626, 277183, 293665, 311127, 329628, 349228, 369994, 391995, 415305, 440000, 466164, 493883
+    };
+    const int octave = key / 12 - 5;
+    qint64 frequency = octaveFrequencies[key % 12];
+    frequency = octave >= 0 ? frequency << octave : frequency >> -octave;
+    frequency = qMin(frequency, qint64(sampleRate) * 500); // Nyquist
+    return quint32((frequency << 32) / (qint64(sampleRate) * 1000));
+}
+
+// Keeps the sum of all notes within an int
+static const int maximumNotes = 10000;
+
+struct Note
+{
+    qint64 start;
+    qint64 end; // -1 while held
+    int channel;
+    int key;
+    int amplitude; // Q15
+    int program;
+};
+
+static void renderNote(const Note &note, int sampleRate, QVector<int> *buffer)
+{
+    const qint16 *sine = sineTable()->table;
+    const Instrument &sound = instrument(note.program);
+    const quint32 carrierIncrement = phaseIncrement(note.key, sampleRate);
+    const quint32 modulatorIncrement = quint32(quint64(carrierIncrement) * sound.modulatorRatio / 4);
+    // Phase units per radian are 2^32 / (2 * pi), the modulator is Q15
+    const qint64 modulationDepth = (qint64(sound.modulationIndex) * 683565275 / 100) >> 15;
+    const int attackSamples = qMax(1, sound.attack * sampleRate / 1000);
+    const int decay = decayDivisor(sound.decayHalfLife, sampleRate);
+    const int modulationDecay = sound.modulationHalfLife > 0 ? decayDivisor(sound.modulationHalfLife, sampleRate) : 0;
+    const int release = decayDivisor(sound.releaseHalfLife, sampleRate);
+    const int unity = 1 << 24;
+    const int silence = unity >> 12;
+
+    quint32 carrierPhase = 0;
+    quint32 modulatorPhase = 0;
+    int envelope = 0;
+    int modulationEnvelope = unity;
+    for (qint64 sample = note.start; sample < buffer->count(); sample++) {
+        const qint64 age = sample - note.start;
+        if (note.end >= 0 && sample >= note.end)
+            envelope -= (envelope + release - 1) / release;
+        else if (age < attackSamples)
+            envelope = int(qint64(unity) * (age + 1) / attackSamples);
+        else
+            envelope -= (envelope + decay - 1) / decay;
+        if (age >= attackSamples && envelope < silence)
+            break;
+        if (modulationDecay)
+            modulationEnvelope -= (modulationEnvelope + modulationDecay - 1) / modulationDecay;
+        else
+            modulationEnvelope = envelope;
+
+        const int modulator = sine[modulatorPhase >> (32 - sineTableBits)];
+        const qint64 offset = (modulator * modulationDepth * modulationEnvelope) >> 24;
+        const int carrier = sine[quint32(carrierPhase + quint32(offset)) >> (32 - sineTableBits)];
+        (*buffer)[int(sample)] += int((qint64(carrier) * note.amplitude >> 15) * envelope >> 24);
+        carrierPhase += carrierIncrement;
+        modulatorPhase += modulatorIncrement;
+    }
+}
+
+PcmClip renderMidi(const QByteArray &data, int sampleRate)
+{
+    const uchar *bytes = reinterpret_cast<const uchar*>(data.constData());
+    const uchar *end = bytes + data.size();
+    if (data.size() < 14 || qstrncmp(data.constData(), "MThd", 4) != 0 || readBigEndian(bytes + 4, 4) < 6)
+        return PcmClip();
+    const int trackCount = readBigEndian(bytes + 10, 2);
+    const int division = readBigEndian(bytes + 12, 2);
+    if (division <= 0 || division & 0x8000) // SMPTE time is not supported
+        return PcmClip();
+
+    QList<MidiEvent> events;
+    QList<TempoChange> tempoChanges;
+    const uchar *chunk = bytes + 8 + readBigEndian(bytes + 4, 4);
+    for (int track = 0; track < trackCount && end - chunk >= 8; track++) {
+        const quint32 chunkSize = readBigEndian(chunk + 4, 4);
+        if (chunkSize > quint32(end - chunk - 8))
+            return PcmClip();
+        if (qstrncmp(reinterpret_cast<const char*>(chunk), "MTrk", 4) != 0) {
+            track--; // Unknown chunks are skipped
+        } else if (!parseTrack(chunk + 8, chunk + 8 + chunkSize, &events, &tempoChanges)) {
+            qDebug() << "****************** Invalid MIDI track" << track;
+            return PcmClip();
+        }
+        chunk += 8 + chunkSize;
+    }
+    // Stable, so that events of the same tick keep the order of the tracks
+    qStableSort(events.begin(), events.end(), eventLessThan);
+    qStableSort(tempoChanges.begin(), tempoChanges.end(), tempoChangeLessThan);
+
+    // Ticks to samples, via microseconds * division
+    int tempoIndex = 0;
+    qint64 tempoTick = 0;
+    qint64 tempo = 500000; // 120 bpm
+    qint64 tempoTime = 0;
+    QList<Note> notes;
+    int programs[16] = {0};
+    int volumes[16];
+    for (int i = 0; i < 16; i++)
+        volumes[i] = 100;
+    foreach (const MidiEvent &event, events) {
+        while (tempoIndex < tempoChanges.count() && tempoChanges.at(tempoIndex).tick <= event.tick) {
+            tempoTime += (tempoChanges.at(tempoIndex).tick - tempoTick) * tempo;
+            tempoTick = tempoChanges.at(tempoIndex).tick;
+            tempo = tempoChanges.at(tempoIndex).microsecondsPerQuarter;
+            tempoIndex++;
+        }
+        const qint64 time = tempoTime + (event.tick - tempoTick) * tempo;
+        const qint64 sample = ((time / division) * sampleRate + (time % division) * sampleRate / division) / 1000000;
+        const int channel = event.status & 0x0f;
+        switch (event.status & 0xf0) {
+        case 0x90:
+            if (event.data2 > 0) {
+                if (notes.count() == maximumNotes)
+                    break;
+                const Note note = { sample, -1, channel, event.data1,
+                                    event.data2 * volumes[channel] * 2, programs[channel] };
+                notes.append(note);
+                break;
+            }
+            // Velocity 0 is a note off
+            // Fall through
+        case 0x80:
+            for (int i = 0; i < notes.count(); i++) {
+                Note &note = notes[i];
+                if (note.end < 0 && note.channel == channel && note.key == event.data1) {
+                    note.end = sample;
+                    break;
+                }
+            }
+            break;
+        case 0xb0:
+            if (event.data1 == 7)
+                volumes[channel] = event.data2;
+            break;
+        case 0xc0:
+            programs[channel] = event.data1;
+            break;
+        default:
+            break;
+        }
+    }
+    if (notes.isEmpty())
+        return PcmClip();
+
+    // Long enough for the releases. Trailing silence is cut below.
+    qint64 length = 0;
+    for (int i = 0; i < notes.count(); i++) {
+        Note &note = notes[i];
+        if (note.end < 0)
+            note.end = note.start + sampleRate;
+        length = qMax(length, note.end + qint64(instrument(note.program).releaseHalfLife) * 12 * sampleRate / 1000);
+    }
+    QVector<int> buffer(int(qMin(length, qint64(sampleRate) * 60)));
+    foreach (const Note &note, notes)
+        renderNote(note, sampleRate, &buffer);
+
+    int peak = 0;
+    int last = 0;
+    for (int i = 0; i < buffer.count(); i++) {
+        const int magnitude = qAbs(buffer.at(i));
+        peak = qMax(peak, magnitude);
+        if (magnitude > 0)
+            last = i;
+    }
+    if (peak == 0)
+        return PcmClip();
+    const qint64 targetPeak = 23198; // -3 dBFS
+    PcmClip result(last + 1);
+    for (int i = 0; i <= last; i++)
+        result[i] = qint16(buffer.at(i) * targetPeak / peak);
+    return result;
+}
+
+PcmClip loadMidi(const QString &fileName, int sampleRate)
+{
+    QFile file(fileName);
+    if (!file.open(QIODevice::ReadOnly))
+        return PcmClip();
+    const PcmClip result = renderMidi(file.readAll(), sampleRate);
+    if (result.isEmpty())
+        qDebug() << "****************** Could not render" << fileName;
+    return result;
+}
@@ -0,0 +1,35 @@
+/*
+    Touch'n'learn - Fun and easy mobile lessons for kids
+    Copyright (C) 2010, 2011 by Alessandro Portale
+    http://touchandlearn.sourceforge.net
+
+    This file is part of Touch'n'learn
+
+    Touch'n'learn is free software; you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    Touch'n'learn is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with Touch'n'learn; if not, write to the Free Software
+    Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA 02110-1301 USA
+*/
+
+#ifndef MIDISYNTH_H
+#define MIDISYNTH_H
+
+#include "audiomixer.h"
+
+// Renders Standard MIDI Files (format 0 and 1) with a small two operator FM
+// synthesizer, into a clip which peaks at -3 dBFS. There is one sound per
+// General MIDI instrument family. Only integer arithmetic is used, so that
+// the output is the same on every platform. Returns an empty clip on errors.
+PcmClip renderMidi(const QByteArray &data, int sampleRate);
+PcmClip loadMidi(const QString &fileName, int sampleRate);
+
+#endif // MIDISYNTH_H
@@ -37,9 +37,23 @@ Item {
     property int backgroundBlackRectHeight: height - backgroundWhiteRectHeight - backgroundImage.height
     property int imageSourceSizeWidthHeight: (height < width ? height : width) * imageSizeFactor
 
+    property int prefetchedExercisesCount: 3
+
     function goForward() {
         listview.incrementCurrentIndex();
     }
+
+    // Renders the images of the upcoming exercises before they are flicked in
+    function prefetchExercises() {
+        if (typeof(imageProvider) !== "object" || imageSourceSizeWidthHeight < 1)
+            return;
+        for (var i = 1; i <= prefetchedExercisesCount; i++) {
+            var exercise = Database.exercise(listview.currentIndex + i, exerciseFunction, answersCount);
+            imageProvider.prefetch([exercise.ImageSource], imageSourceSizeWidthHeight, imageSourceSizeWidthHeight,
+                                   prefetchedExercisesCount - i);
+        }
+    }
+    onImageSourceSizeWidthHeightChanged: prefetchExercises()
     id: imageview
     Rectangle {
         property int hueOffset: Math.random() * 4000
@@ -82,6 +96,7 @@ Item {
         maximumFlickVelocity: width / 2
         highlightMoveDuration: 1000
         model: 100000
+        onCurrentIndexChanged: imageview.prefetchExercises()
 
         delegate: Item {
             id: delegate
@@ -94,6 +109,7 @@ Item {
                 anchors { left: parent.left; top: parent.top; leftMargin: _leftMargin; topMargin: _topMargin; }
                 source: Database.exercise(modelData, exerciseFunction, answersCount).ImageSource
                 sourceSize { width: imageSourceSizeWidthHeight; height: imageSourceSizeWidthHeight; }
+                asynchronous: true
                 smooth: true
             }
         }
@@ -83,6 +83,16 @@ Rectangle {
         }
     }
 
+    Timer {
+        interval: 1
+        running: true
+        onTriggered: {
+            // Lesson icons of all groups, in the size of the LessonOptions screen
+            if (typeof(imageProvider) === "object")
+                imageProvider.prefetchWhenIdle(Database.lessonIconImageSources(), menu.width, menu.width * 0.4);
+        }
+    }
+
     Flickable {
         property int _contentY: controlsHeight * 0.75
         contentY: _contentY // Only show a part of it. As a hint.
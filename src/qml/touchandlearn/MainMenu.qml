@@ -21,6 +21,7 @@
 */
 
 import Qt 4.7
+import TouchAndLearn 1.0
 import "database.js" as Database
 
 Rectangle {
@@ -32,6 +33,7 @@ Rectangle {
     function handleVolumeChange(volume)
     {
         Database.currentVolume = volume;
+        Database.persistence.writeVolume(volume);
         if (volumeDisplay.source == '')
             volumeDisplay.source = 'VolumeDisplay.qml';
         else
@@ -60,6 +62,10 @@ Rectangle {
         }
     }
 
+    ExerciseGenerator {
+        id: exerciseGenerator
+    }
+
     Loader {
         id: stage
         width: parent.width
@@ -106,14 +112,27 @@ Rectangle {
 
     function switchToScreen(screen)
     {
-        Database.lessonData = [];
+        if (typeof(imageProvider) === "object")
+            imageProvider.cancel();
+        Database.resetExercises();
         Database.currentScreen = screen + '.qml';
+        if (Database.tracer !== null)
+            Database.tracer.begin("screen", "switch " + Database.currentScreen);
         if (stage.source == '')
-            stage.source = Database.currentScreen;
+            loadCurrentScreen();
         else
             screenBlendOut.start();
     }
 
+    function loadCurrentScreen()
+    {
+        if (Database.tracer !== null)
+            Database.tracer.begin("screen", "load " + Database.currentScreen);
+        stage.source = Database.currentScreen;
+        if (Database.tracer !== null)
+            Database.tracer.end("screen", "load " + Database.currentScreen);
+    }
+
     SequentialAnimation {
         id: screenBlendOut
         PropertyAnimation {
@@ -124,7 +143,7 @@ Rectangle {
         }
         ScriptAction {
             script: {
-                stage.source = Database.currentScreen;
+                loadCurrentScreen();
             }
         }
     }
@@ -138,7 +157,11 @@ Rectangle {
             duration: 180
         }
         ScriptAction {
-            script: loadingText.text = '';
+            script: {
+                loadingText.text = '';
+                if (Database.tracer !== null)
+                    Database.tracer.end("screen", "switch " + Database.currentScreen);
+            }
         }
     }
 
@@ -163,6 +186,9 @@ Rectangle {
         interval: 1
         running: true
         onTriggered: {
+            if (typeof(tracer) === "object")
+                Database.tracer = tracer;
+            Database.exerciseGenerator = exerciseGenerator;
             Database.data.initCaches();
             rotateItemsIfLandscape();
             if (typeof(feedback) === "object") {
@@ -174,6 +200,10 @@ Rectangle {
     }
 
     Component.onCompleted: {
+        if (typeof(settingsStore) === "object") {
+            Database.persistence.store = settingsStore;
+            Database.persistence.importLegacyDatabase();
+        }
         Database.persistence.readCurrentLessonsOfGroups();
     }
 
@@ -26,6 +26,8 @@ var currentLessonGroup = null;
 var lessonData = [];
 var lessonDataLength = 100;
 var currentVolume = -1;
+var tracer = null; // Set by MainMenu.qml while tracing
+var exerciseGenerator = null; // Set by MainMenu.qml
 
 var data = {
     addIndicesToDict: function(dict)
@@ -240,53 +242,24 @@ var data = {
 }
 
 var exercises = {
-    previousExerciseHasSameAnswerOnIndex: function(answerObjectIndex, index, listModelItemsLength)
-    {
-        if (listModelItemsLength < 1)
-            return false;
-        return lessonData[listModelItemsLength - 1].Answers[index].Index === answerObjectIndex;
-    },
-
-    previousExercisesHaveSameCorrectAnswer: function(answerObjectIndex, uniqueAnswers, listModelItemsLength)
-    {
-        for (var i = Math.max(0, listModelItemsLength - uniqueAnswers); i < listModelItemsLength; i++)
-            if (lessonData[i].Index === answerObjectIndex)
-                return true;
-        return false;
-    },
+    // Answers picked by the ExerciseGenerator, per pool
+    pendingExercises: {},
 
-    currentAnswersContainObjectIndex: function(answerObjectIndex, j, answers)
+    createExercise: function(i, pool, data, answersPerChoiceCount, imageSourceFunction)
     {
-        for (var i = 0; i < j; i++)
-            if (answers[i].Index === answerObjectIndex)
-                return true;
-        return false;
-    },
-
-    createExercise: function(i, data, answersPerChoiceCount, imageSourceFunction)
-    {
-        var correctAnswerIndex = Math.floor(Math.random() * answersPerChoiceCount);
-        var currentDataIndex;
-        do {
-            currentDataIndex = Math.floor(Math.random() * data.length);
-        } while (this.previousExerciseHasSameAnswerOnIndex(currentDataIndex, correctAnswerIndex, i)
-                 || this.previousExercisesHaveSameCorrectAnswer(currentDataIndex, Math.round(data.length * 0.5), i));
-        var object = data[currentDataIndex];
-        var answers = new Array(answersPerChoiceCount);
-        answers[correctAnswerIndex] = object;
-        for (var j = 0; j < answersPerChoiceCount; j++) {
-            if (j !== correctAnswerIndex) {
-                var wrongAnswerDataIndex;
-                do {
-                    wrongAnswerDataIndex = Math.floor(Math.random() * data.length);
-                } while (wrongAnswerDataIndex === currentDataIndex
-                         || this.previousExerciseHasSameAnswerOnIndex(wrongAnswerDataIndex, j, i)
-                         || this.currentAnswersContainObjectIndex(wrongAnswerDataIndex, j, answers))
-                answers[j] = data[wrongAnswerDataIndex];
-            }
+        var pending = this.pendingExercises[pool];
+        if (pending === undefined || pending.length === 0) {
+            pending = exerciseGenerator.createExercises(pool, data.length, answersPerChoiceCount, lessonDataLength - i);
+            this.pendingExercises[pool] = pending;
         }
+        var pick = pending.shift();
+        var correctAnswerIndex = pick.correctAnswerIndex;
+        var answers = new Array(answersPerChoiceCount);
+        for (var j = 0; j < answersPerChoiceCount; j++)
+            answers[j] = data[pick.answers[j]];
         for (var a = 0; a < answers.length; a++)
             answers[a].ImageSource = imageSourceFunction(answers[a], i);
+        var object = answers[correctAnswerIndex];
         var listItem = {
             Index: object.Index,
             ImageSource: answers[correctAnswerIndex].ImageSource,
@@ -306,7 +279,7 @@ var exercises = {
     firstLetterExerciseFunction: function(i, answersCount)
     {
         var firstLetters = data.firstLetters();
-        this.createExercise(i, firstLetters, answersCount, this.firstLetterImageSourceFunction);
+        this.createExercise(i, "firstLetters", firstLetters, answersCount, this.firstLetterImageSourceFunction);
     },
 
     nameTermsImageSourceFunction: function(object, answerIndex)
@@ -317,20 +290,22 @@ var exercises = {
     nameTermsExerciseFunction: function(i, answersCount)
     {
         var objects = data.objects();
-        this.createExercise(i, objects, answersCount, this.nameTermsImageSourceFunction);
+        this.createExercise(i, "objects", objects, answersCount, this.nameTermsImageSourceFunction);
     },
 
     countExerciseFunction: function(i, answersCount, rangeFrom, rangeTo, numbersAsWords)
     {
         var images = ["fish", "apple", "balloon"];
+        var layoutsCount = 12; // Also in assetpackbaker
         function countExeciseImageFunction(object, answerIndex)
         {
+            // The exercise index seeds a reproducible, cacheable layout
             return "image://imageprovider/quantity/" + object.Id + "/"
-                  + images[answerIndex % images.length];
+                  + images[answerIndex % images.length] + "/" + (answerIndex % layoutsCount);
         };
         var numbers = numbersAsWords ? data.numbersAsWordsRange(rangeFrom, rangeTo)
                                      : data.numbersRange(rangeFrom, rangeTo);
-        this.createExercise(i, numbers, answersCount, countExeciseImageFunction);
+        this.createExercise(i, "numbers" + rangeFrom + "-" + rangeTo, numbers, answersCount, countExeciseImageFunction);
     },
 
     countEasyExerciseFunction: function(i, answersCount)
@@ -361,19 +336,19 @@ var exercises = {
     clockEasyExerciseFunction: function(i, answersCount)
     {
         var times = data.times(60);
-        this.createExercise(i, times, answersCount, this.clockImageSourceFunction);
+        this.createExercise(i, "times60", times, answersCount, this.clockImageSourceFunction);
     },
 
     clockMediumExerciseFunction: function(i, answersCount)
     {
         var times = data.times(30);
-        this.createExercise(i, times, answersCount, this.clockImageSourceFunction);
+        this.createExercise(i, "times30", times, answersCount, this.clockImageSourceFunction);
     },
 
     clockHardExerciseFunction: function(i, answersCount)
     {
         var times = data.times(5);
-        this.createExercise(i, times, answersCount, this.clockImageSourceFunction);
+        this.createExercise(i, "times5", times, answersCount, this.clockImageSourceFunction);
     },
 
     notesReadImageSourceFunction: function(object, answerIndex)
@@ -384,13 +359,13 @@ var exercises = {
     notesReadEasyExerciseFunction: function(i, answersCount)
     {
         var naturalNotes = data.naturalNotes();
-        this.createExercise(i, naturalNotes, answersCount, this.notesReadImageSourceFunction);
+        this.createExercise(i, "naturalNotes", naturalNotes, answersCount, this.notesReadImageSourceFunction);
     },
 
     notesReadHardExerciseFunction: function(i, answersCount)
     {
         var notes = data.notes();
-        this.createExercise(i, notes, answersCount, this.notesReadImageSourceFunction);
+        this.createExercise(i, "notes", notes, answersCount, this.notesReadImageSourceFunction);
     },
 
     colorImageSourceFunction: function(object, answerIndex)
@@ -401,7 +376,7 @@ var exercises = {
     colorExerciseFunction: function(i, answersCount)
     {
         var colors = data.colors();
-        this.createExercise(i, colors, answersCount, this.colorImageSourceFunction);
+        this.createExercise(i, "colors", colors, answersCount, this.colorImageSourceFunction);
     },
 
     mixedEasyExercisesFunction: function(i, answersCount)
@@ -444,11 +419,25 @@ var exercises = {
     }
 }
 
+function resetExercises()
+{
+    lessonData = [];
+    exercises.pendingExercises = {};
+    exerciseGenerator.reset();
+}
+
 function exercise(i, exerciseFunction, answersCount)
 {
     var index = i % lessonDataLength;
-    if (lessonData[index] === undefined)
-        exercises[exerciseFunction](index, answersCount);
+    // Created in index order, also when the images of upcoming exercises are
+    // prefetched. Each exercise avoids the answers of the previous one.
+    for (var created = lessonData.length; created <= index; created++) {
+        if (tracer !== null)
+            tracer.begin("exercise", exerciseFunction + " " + created);
+        exercises[exerciseFunction](created, answersCount);
+        if (tracer !== null)
+            tracer.end("exercise", exerciseFunction + " " + created);
+    }
     return lessonData[index];
 }
 
@@ -469,77 +458,75 @@ function dumpLessonData()
 }
 
 var persistence = {
-    database: function()
-    {
-        return openDatabaseSync("TouchAndLearnDB", "1.0", "TouchAndLearn settings", 10000);
-    },
+    store: null, // SettingsStore, set by MainMenu.qml
 
-    lessonOfGroupTableName: "LessonOfGroup",
-    createLessonOfGroupTable: function(transaction)
-    {
-        transaction.executeSql('CREATE TABLE IF NOT EXISTS ' + this.lessonOfGroupTableName + '(lessonGroup TEXT, lesson TEXT)');
+    lessonOfGroupKeyPrefix: "LessonOfGroup/",
+    volumeKeyName: "Volume",
+    legacyImportedKeyName: "LegacyDatabaseImported",
+
+    // Copies the settings of versions which used openDatabaseSync, once
+    importLegacyDatabase: function()
+    {
+        if (persistence.store.contains(persistence.legacyImportedKeyName))
+            return;
+        var database = openDatabaseSync("TouchAndLearnDB", "1.0", "TouchAndLearn settings", 10000);
+        database.readTransaction(function(transaction) {
+            try {
+                var rs = transaction.executeSql('SELECT * FROM LessonOfGroup');
+                for (var row = 0; row < rs.rows.length; row++)
+                    persistence.store.setValue(persistence.lessonOfGroupKeyPrefix + rs.rows.item(row).lessonGroup,
+                                               rs.rows.item(row).lesson);
+            } catch (error) {
+                // Table did not exist
+            }
+            try {
+                var rs = transaction.executeSql('SELECT * FROM Settings WHERE key = "Volume"');
+                if (rs.rows.length === 1)
+                    persistence.store.setValue(persistence.volumeKeyName, parseInt(rs.rows.item(0).value));
+            } catch (error) {
+                // Table did not exist
+            }
+        });
+        persistence.store.setValue(persistence.legacyImportedKeyName, true);
     },
 
     readCurrentLessonsOfGroups: function()
     {
         lessonMenu(); // initializing 'cachedLessonMenu'
-        persistence.database().transaction(function(transaction) {
-            persistence.createLessonOfGroupTable(transaction);
-            var rs = transaction.executeSql('SELECT * FROM ' + persistence.lessonOfGroupTableName);
-            for (var row = 0; row < rs.rows.length; row++) {
-                var resultRow = rs.rows.item(row);
-                var lessonGroupDb = rs.rows.item(row).lessonGroup;
-                var lessonGroup = cachedLessonMenuDict[lessonGroupDb];
-                if (lessonGroup === undefined)
-                    continue;
-                var lessonDb = rs.rows.item(row).lesson;
-                var lesson = lessonGroup.LessonsDict[lessonDb];
-                if (lesson === undefined)
-                    continue;
-                lessonGroup.CurrentLesson = lessonDb;
-            }
-        });
+        if (persistence.store === null)
+            return;
+        for (var lessonGroupId in cachedLessonMenuDict) {
+            var lessonGroup = cachedLessonMenuDict[lessonGroupId];
+            var lesson = persistence.store.value(persistence.lessonOfGroupKeyPrefix + lessonGroupId);
+            if (lesson !== undefined && lessonGroup.LessonsDict[lesson] !== undefined)
+                lessonGroup.CurrentLesson = lesson;
+        }
     },
 
-    writeCurrentLessonsOfGroups: function()
+    writeCurrentLessonOfGroup: function(lessonGroup)
     {
-        persistence.database().transaction(function(transaction) {
-            persistence.createLessonOfGroupTable(transaction);
-            for (var group in cachedLessonMenuDict) {
-                group = cachedLessonMenuDict[group];
-                var lessonGroupId = group.Id;
-                transaction.executeSql('DELETE FROM ' + persistence.lessonOfGroupTableName + ' WHERE lessonGroup = "' + lessonGroupId + '"');
-                transaction.executeSql('INSERT INTO ' + persistence.lessonOfGroupTableName + ' VALUES(?, ?)', [lessonGroupId, group.CurrentLesson]);
-            }
-        });
+        if (persistence.store !== null)
+            persistence.store.setValue(persistence.lessonOfGroupKeyPrefix + lessonGroup.Id, lessonGroup.CurrentLesson);
     },
 
-    settingsTableName: "Settings",
-    createSettingsTable: function(transaction)
+    writeCurrentLessonsOfGroups: function()
     {
-        transaction.executeSql('CREATE TABLE IF NOT EXISTS ' + persistence.settingsTableName + '(key TEXT, value TEXT)');
+        for (var group in cachedLessonMenuDict)
+            persistence.writeCurrentLessonOfGroup(cachedLessonMenuDict[group]);
     },
 
-    volumeKeyName: "Volume",
     readVolume: function()
     {
-        var result = 60; // 0-100
-        persistence.database().transaction(function(transaction) {
-            persistence.createSettingsTable(transaction);
-            var rs = transaction.executeSql('SELECT * FROM ' + persistence.settingsTableName + ' WHERE key = "' + persistence.volumeKeyName + '"');
-            if (rs.rows.length === 1)
-                result = parseInt(rs.rows.item(0).value);
-        });
-        return result;
+        var defaultVolume = 60; // 0-100
+        if (persistence.store === null)
+            return defaultVolume;
+        return persistence.store.value(persistence.volumeKeyName, defaultVolume);
     },
 
     writeVolume: function(volume)
     {
-        persistence.database().transaction(function(transaction) {
-            persistence.createSettingsTable(transaction);
-            transaction.executeSql('DELETE FROM ' + persistence.settingsTableName + ' WHERE key = "' + persistence.volumeKeyName + '"');
-            transaction.executeSql('INSERT INTO ' + persistence.settingsTableName + ' VALUES(?, ?)', [persistence.volumeKeyName, volume]);
-        });
+        if (persistence.store !== null)
+            persistence.store.setValue(persistence.volumeKeyName, volume);
     }
 };
 
@@ -598,6 +585,18 @@ function lessonMenu()
     return cachedLessonMenu;
 }
 
+function lessonIconImageSources()
+{
+    var result = [];
+    var groups = lessonMenu();
+    for (var groupIndex = 0; groupIndex < groups.length; groupIndex++) {
+        var lessons = groups[groupIndex].Lessons;
+        for (var lessonIndex = 0; lessonIndex < lessons.length; lessonIndex++)
+            result.push("image://imageprovider/lessonicon/" + lessons[lessonIndex].Id + "/" + lessonIndex);
+    }
+    return result;
+}
+
 function lessonsOfCurrentGroup()
 {
     if (currentLessonGroup === null)
@@ -609,6 +608,7 @@ function setCurrentLessonOfGroup(lessonGroup, lesson)
 {
     lessonGroup = cachedLessonMenuDict[lessonGroup];
     lessonGroup.CurrentLesson = lessonGroup.LessonsDict[lesson].Id;
+    persistence.writeCurrentLessonOfGroup(lessonGroup);
 }
 
 function currentLessonOfCurrentGroup()
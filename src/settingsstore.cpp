@@ -0,0 +1,175 @@
+/*
+    Touch'n'learn - Fun and easy mobile lessons for kids
+    Copyright (C) 2010, 2011 by Alessandro Portale
+    http://touchandlearn.sourceforge.net
+
+    This file is part of Touch'n'learn
+
+    Touch'n'learn is free software; you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    Touch'n'learn is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with Touch'n'learn; if not, write to the Free Software
+    Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA 02110-1301 USA
+*/
+
+#include "settingsstore.h"
+#include <QtCore/QDataStream>
+#include <QtCore/QDebug>
+#include <QtCore/QDir>
+#include <QtCore/QFile>
+#include <QtCore/QFileInfo>
+#include <QtCore/QRunnable>
+#if defined(Q_OS_UNIX)
+#include <unistd.h>
+#endif
+
+static const quint32 settingsFileMagic = 0x534c4e54; // "TNLS"
+static const quint32 settingsFileVersion = 1;
+const int writeDelay = 1500; // Milliseconds without changes
+
+class WriteSettingsTask : public QRunnable
+{
+public:
+    WriteSettingsTask(const QString &fileName, const QVariantMap &values)
+        : m_fileName(fileName)
+        , m_values(values)
+    { }
+
+    void run()
+    {
+        if (!SettingsStore::write(m_fileName, m_values))
+            qDebug() << "****************** Could not write settings" << m_fileName;
+    }
+
+private:
+    const QString m_fileName;
+    const QVariantMap m_values;
+};
+
+inline static QString temporaryFileName(const QString &fileName)
+{
+    return fileName + QLatin1String(".new");
+}
+
+// Returns false for incomplete or damaged files
+inline static bool readFile(const QString &fileName, QVariantMap *values)
+{
+    QFile file(fileName);
+    if (!file.open(QIODevice::ReadOnly))
+        return false;
+    QDataStream stream(&file);
+    stream.setVersion(QDataStream::Qt_4_7);
+    quint32 magic = 0;
+    quint32 version = 0;
+    QByteArray payload;
+    quint16 checksum = 0;
+    stream >> magic >> version >> payload >> checksum;
+    if (stream.status() != QDataStream::Ok || magic != settingsFileMagic || version != settingsFileVersion
+            || checksum != qChecksum(payload.constData(), payload.size()))
+        return false;
+    QDataStream payloadStream(payload);
+    payloadStream.setVersion(QDataStream::Qt_4_7);
+    payloadStream >> *values;
+    return payloadStream.status() == QDataStream::Ok;
+}
+
+SettingsStore::SettingsStore(const QString &fileName, QObject *parent)
+    : QObject(parent)
+    , m_fileName(fileName)
+    , m_values(read(fileName))
+    , m_dirty(false)
+{
+    m_writer.setMaxThreadCount(1); // Keeps the writes in order
+    m_writeTimer.setSingleShot(true);
+    m_writeTimer.setInterval(writeDelay);
+    connect(&m_writeTimer, SIGNAL(timeout()), SLOT(writeInBackground()));
+}
+
+SettingsStore::~SettingsStore()
+{
+    flush();
+}
+
+bool SettingsStore::contains(const QString &key) const
+{
+    return m_values.contains(key);
+}
+
+QVariant SettingsStore::value(const QString &key, const QVariant &defaultValue) const
+{
+    return m_values.value(key, defaultValue);
+}
+
+void SettingsStore::setValue(const QString &key, const QVariant &value)
+{
+    QVariantMap::iterator i = m_values.find(key);
+    if (i != m_values.end() && i.value() == value)
+        return;
+    m_values.insert(key, value);
+    m_dirty = true;
+    m_writeTimer.start();
+}
+
+void SettingsStore::flush()
+{
+    m_writeTimer.stop();
+    writeInBackground();
+    m_writer.waitForDone();
+}
+
+void SettingsStore::writeInBackground()
+{
+    if (!m_dirty)
+        return;
+    m_dirty = false;
+    m_writer.start(new WriteSettingsTask(m_fileName, m_values));
+}
+
+QVariantMap SettingsStore::read(const QString &fileName)
+{
+    QVariantMap result;
+    if (readFile(fileName, &result))
+        return result;
+    // A crash between removing the old and renaming the new file
+    result.clear();
+    if (!QFile::exists(fileName) && readFile(temporaryFileName(fileName), &result))
+        return result;
+    return QVariantMap();
+}
+
+bool SettingsStore::write(const QString &fileName, const QVariantMap &values)
+{
+    QByteArray payload;
+    QDataStream payloadStream(&payload, QIODevice::WriteOnly);
+    payloadStream.setVersion(QDataStream::Qt_4_7);
+    payloadStream << values;
+
+    QDir().mkpath(QFileInfo(fileName).absolutePath());
+    const QString newFileName = temporaryFileName(fileName);
+    QFile file(newFileName);
+    if (!file.open(QIODevice::WriteOnly | QIODevice::Truncate))
+        return false;
+    QDataStream stream(&file);
+    stream.setVersion(QDataStream::Qt_4_7);
+    stream << settingsFileMagic << settingsFileVersion << payload << qChecksum(payload.constData(), payload.size());
+    file.flush();
+#if defined(Q_OS_UNIX)
+    ::fsync(file.handle());
+#endif // Q_OS_UNIX
+    file.close();
+    if (file.error() != QFile::NoError) {
+        QFile::remove(newFileName);
+        return false;
+    }
+    // QFile::rename() does not replace existing files
+    QFile::remove(fileName);
+    return QFile::rename(newFileName, fileName);
+}
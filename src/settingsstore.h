@@ -0,0 +1,65 @@
+/*
+    Touch'n'learn - Fun and easy mobile lessons for kids
+    Copyright (C) 2010, 2011 by Alessandro Portale
+    http://touchandlearn.sourceforge.net
+
+    This file is part of Touch'n'learn
+
+    Touch'n'learn is free software; you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    Touch'n'learn is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with Touch'n'learn; if not, write to the Free Software
+    Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA 02110-1301 USA
+*/
+
+#ifndef SETTINGSSTORE_H
+#define SETTINGSSTORE_H
+
+#include <QtCore/QObject>
+#include <QtCore/QThreadPool>
+#include <QtCore/QTimer>
+#include <QtCore/QVariant>
+
+// Key/value store for settings and progress. Reads and writes only touch an
+// in-memory copy. Changes are written on a background thread, once no value
+// changed for a while, and when the store is destroyed. The file is replaced
+// via a complete temporary file, so that a crash leaves the old or the new
+// values, but never a mix.
+class SettingsStore : public QObject
+{
+    Q_OBJECT
+
+public:
+    explicit SettingsStore(const QString &fileName, QObject *parent = 0);
+    ~SettingsStore();
+
+    Q_INVOKABLE bool contains(const QString &key) const;
+    Q_INVOKABLE QVariant value(const QString &key, const QVariant &defaultValue = QVariant()) const;
+    Q_INVOKABLE void setValue(const QString &key, const QVariant &value);
+
+    // Returns when the values are written
+    void flush();
+
+    static QVariantMap read(const QString &fileName);
+    static bool write(const QString &fileName, const QVariantMap &values);
+
+private slots:
+    void writeInBackground();
+
+private:
+    const QString m_fileName;
+    QVariantMap m_values;
+    bool m_dirty;
+    QTimer m_writeTimer;
+    QThreadPool m_writer;
+};
+
+#endif // SETTINGSSTORE_H
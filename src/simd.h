@@ -0,0 +1,53 @@
+/*
+    Touch'n'learn - Fun and easy mobile lessons for kids
+    Copyright (C) 2010, 2011 by Alessandro Portale
+    http://touchandlearn.sourceforge.net
+
+    This file is part of Touch'n'learn
+
+    Touch'n'learn is free software; you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    Touch'n'learn is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with Touch'n'learn; if not, write to the Free Software
+    Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA 02110-1301 USA
+*/
+
+#ifndef SIMD_H
+#define SIMD_H
+
+// Instruction sets for the image kernels. SSE2 is used when the compiler
+// targets it anyway. AVX2 is compiled in for x86 GCC and Clang builds, and
+// functions using it must be marked with SIMD_AVX2_FUNCTION and only be
+// called if simdAvx2Supported().
+
+#if defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#define SIMD_SSE2
+#include <emmintrin.h>
+#endif
+
+#if (defined(__x86_64__) || defined(__i386__)) \
+    && ((defined(__GNUC__) && !defined(__clang__) && (__GNUC__ * 100 + __GNUC_MINOR__) >= 409) \
+        || (defined(__clang__) && (__clang_major__ * 100 + __clang_minor__) >= 308))
+#define SIMD_AVX2
+#include <immintrin.h>
+#define SIMD_AVX2_FUNCTION __attribute__((target("avx2")))
+#endif
+
+inline bool simdAvx2Supported()
+{
+#ifdef SIMD_AVX2
+    return __builtin_cpu_supports("avx2");
+#else
+    return false;
+#endif
+}
+
+#endif // SIMD_H
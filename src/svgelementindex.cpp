@@ -0,0 +1,206 @@
+/*
+    Touch'n'learn - Fun and easy mobile lessons for kids
+    Copyright (C) 2010, 2011 by Alessandro Portale
+    http://touchandlearn.sourceforge.net
+
+    This file is part of Touch'n'learn
+
+    Touch'n'learn is free software; you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    Touch'n'learn is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with Touch'n'learn; if not, write to the Free Software
+    Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA 02110-1301 USA
+*/
+
+#include "svgelementindex.h"
+#include <QtCore/QDataStream>
+#include <QtCore/QDebug>
+#include <QtCore/QDir>
+#include <QtCore/QFile>
+#include <QtCore/QFileInfo>
+#include <QtCore/QSet>
+#include <QtCore/QXmlStreamReader>
+#include <QtSvg/QSvgRenderer>
+
+static const quint32 indexFileMagic = 0x534c4e49; // "SLNI"
+static const quint32 indexFileVersion = 1;
+
+struct CompanionSuffix
+{
+    const char *suffix;
+    SvgElementIndex::Companion companion;
+};
+
+static const CompanionSuffix companionSuffixes[] = {
+    { "_rect", SvgElementIndex::CompanionRect },
+    { "_mask", SvgElementIndex::CompanionMask },
+    { "_highlight", SvgElementIndex::CompanionHighlight },
+    { "_head", SvgElementIndex::CompanionHead }
+};
+
+// Base name of "<baseName>_<number>", or an empty string
+inline static QString variationBaseName(const QString &name)
+{
+    int position = name.length() - 1;
+    while (position > 0 && name.at(position).isDigit())
+        position--;
+    if (position <= 0 || position == name.length() - 1 || name.at(position) != QLatin1Char('_'))
+        return QString();
+    return name.left(position);
+}
+
+void SvgElementIndex::build(const QByteArray &svgDocument, const QSvgRenderer *renderer, const QString &idPrefix)
+{
+    m_elements.clear();
+    m_variations.clear();
+
+    QXmlStreamReader reader(svgDocument);
+    const QString idAttribute = QLatin1String("id");
+    while (!reader.atEnd()) {
+        if (reader.readNext() != QXmlStreamReader::StartElement)
+            continue;
+        const QString id = reader.attributes().value(idAttribute).toString();
+        if (id.startsWith(idPrefix) && id.length() > idPrefix.length()) {
+            Element element;
+            element.bounds = renderer->boundsOnElement(id);
+            m_elements.insert(id.mid(idPrefix.length()), element);
+        }
+    }
+    if (reader.hasError())
+        qDebug() << "****************** Error while indexing SVG:" << reader.errorString();
+
+    QSet<QString> baseNames;
+    for (QHash<QString, Element>::iterator it = m_elements.begin(); it != m_elements.end(); ++it) {
+        for (size_t i = 0; i < sizeof companionSuffixes / sizeof companionSuffixes[0]; i++)
+            if (m_elements.contains(it.key() + QLatin1String(companionSuffixes[i].suffix)))
+                it.value().companions |= companionSuffixes[i].companion;
+        const QString baseName = variationBaseName(it.key());
+        if (!baseName.isEmpty())
+            baseNames.insert(baseName);
+    }
+
+    foreach (const QString &baseName, baseNames) {
+        AspectRatioBuckets buckets;
+        AspectRatioBucket bucket;
+        bucket.widthToHeightRatio = -1;
+        for (int i = 1; ; i++) {
+            const QString name = baseName + QLatin1Char('_') + QString::number(i);
+            const QHash<QString, Element>::const_iterator element = m_elements.constFind(name);
+            if (element == m_elements.constEnd())
+                break;
+            const QSizeF size = element.value().bounds.size();
+            const qreal widthToHeightRatio = size.width() / size.height();
+            if (!qFuzzyCompare(widthToHeightRatio, bucket.widthToHeightRatio)) {
+                if (bucket.widthToHeightRatio > 0) // Check, is it is the first element
+                    buckets.append(bucket);
+                bucket.widthToHeightRatio = widthToHeightRatio;
+                bucket.elementIds.clear();
+            }
+            bucket.elementIds.append(name);
+        }
+        if (!bucket.elementIds.isEmpty())
+            buckets.append(bucket);
+        if (!buckets.isEmpty()) {
+            qSort(buckets);
+            m_variations.insert(baseName, buckets);
+        }
+    }
+}
+
+int SvgElementIndex::variationsCount(const QString &baseName) const
+{
+    int result = 0;
+    foreach (const AspectRatioBucket &bucket, m_variations.value(baseName))
+        result += bucket.elementIds.count();
+    return result;
+}
+
+SvgElementIndex::IndexesBySourceHash SvgElementIndex::readFile(const QString &fileName)
+{
+    IndexesBySourceHash result;
+    QFile file(fileName);
+    if (!file.open(QIODevice::ReadOnly))
+        return result;
+    QDataStream stream(&file);
+    stream.setVersion(QDataStream::Qt_4_7);
+    quint32 magic;
+    quint32 version;
+    stream >> magic >> version;
+    if (magic != indexFileMagic || version != indexFileVersion)
+        return result;
+    stream >> result;
+    if (stream.status() != QDataStream::Ok) {
+        qDebug() << "****************** Corrupt SVG element index:" << fileName;
+        result.clear();
+    }
+    return result;
+}
+
+bool SvgElementIndex::writeFile(const QString &fileName, const IndexesBySourceHash &indexes)
+{
+    QDir().mkpath(QFileInfo(fileName).absolutePath());
+    QFile file(fileName);
+    if (!file.open(QIODevice::WriteOnly))
+        return false;
+    QDataStream stream(&file);
+    stream.setVersion(QDataStream::Qt_4_7);
+    stream << indexFileMagic << indexFileVersion << indexes;
+    return stream.status() == QDataStream::Ok;
+}
+
+QDataStream &operator<<(QDataStream &stream, const SvgElementIndex &index)
+{
+    stream << quint32(index.m_elements.count());
+    for (QHash<QString, SvgElementIndex::Element>::const_iterator it = index.m_elements.constBegin();
+         it != index.m_elements.constEnd(); ++it)
+        stream << it.key() << it.value().bounds << qint32(it.value().companions);
+    stream << quint32(index.m_variations.count());
+    for (QHash<QString, SvgElementIndex::AspectRatioBuckets>::const_iterator it = index.m_variations.constBegin();
+         it != index.m_variations.constEnd(); ++it) {
+        stream << it.key() << quint32(it.value().count());
+        foreach (const SvgElementIndex::AspectRatioBucket &bucket, it.value())
+            stream << bucket.elementIds << double(bucket.widthToHeightRatio);
+    }
+    return stream;
+}
+
+QDataStream &operator>>(QDataStream &stream, SvgElementIndex &index)
+{
+    index.m_elements.clear();
+    index.m_variations.clear();
+    quint32 elementsCount;
+    stream >> elementsCount;
+    for (quint32 i = 0; i < elementsCount && stream.status() == QDataStream::Ok; i++) {
+        QString name;
+        SvgElementIndex::Element element;
+        qint32 companions;
+        stream >> name >> element.bounds >> companions;
+        element.companions = companions;
+        index.m_elements.insert(name, element);
+    }
+    quint32 variationsCount;
+    stream >> variationsCount;
+    for (quint32 i = 0; i < variationsCount && stream.status() == QDataStream::Ok; i++) {
+        QString baseName;
+        quint32 bucketsCount;
+        stream >> baseName >> bucketsCount;
+        SvgElementIndex::AspectRatioBuckets buckets;
+        for (quint32 j = 0; j < bucketsCount && stream.status() == QDataStream::Ok; j++) {
+            SvgElementIndex::AspectRatioBucket bucket;
+            double widthToHeightRatio;
+            stream >> bucket.elementIds >> widthToHeightRatio;
+            bucket.widthToHeightRatio = widthToHeightRatio;
+            buckets.append(bucket);
+        }
+        index.m_variations.insert(baseName, buckets);
+    }
+    return stream;
+}
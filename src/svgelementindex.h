@@ -0,0 +1,100 @@
+/*
+    Touch'n'learn - Fun and easy mobile lessons for kids
+    Copyright (C) 2010, 2011 by Alessandro Portale
+    http://touchandlearn.sourceforge.net
+
+    This file is part of Touch'n'learn
+
+    Touch'n'learn is free software; you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    Touch'n'learn is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with Touch'n'learn; if not, write to the Free Software
+    Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA 02110-1301 USA
+*/
+
+#ifndef SVGELEMENTINDEX_H
+#define SVGELEMENTINDEX_H
+
+#include <QtCore/QHash>
+#include <QtCore/QRectF>
+#include <QtCore/QStringList>
+
+class QDataStream;
+class QSvgRenderer;
+
+// Bounds and relations of the elements in an SVG file. Built once, so that
+// rendering does not need to query the QSvgRenderer for elements.
+class SvgElementIndex
+{
+public:
+    enum Companion {
+        CompanionRect = 0x1, // "<name>_rect" defines the bounds of "<name>"
+        CompanionMask = 0x2,
+        CompanionHighlight = 0x4,
+        CompanionHead = 0x8
+    };
+
+    struct AspectRatioBucket
+    {
+        QStringList elementIds;
+        qreal widthToHeightRatio;
+        inline bool operator<(const AspectRatioBucket &other) const
+        {
+            return widthToHeightRatio < other.widthToHeightRatio;
+        }
+    };
+    typedef QList<AspectRatioBucket> AspectRatioBuckets;
+
+    // Indexes the elements whose id starts with idPrefix. Element names are
+    // the ids without that prefix.
+    void build(const QByteArray &svgDocument, const QSvgRenderer *renderer, const QString &idPrefix);
+    bool isEmpty() const { return m_elements.isEmpty(); }
+
+    QStringList elementNames() const { return m_elements.keys(); }
+    bool contains(const QString &name) const { return m_elements.contains(name); }
+    QRectF bounds(const QString &name) const { return m_elements.value(name).bounds; }
+    bool hasCompanion(const QString &name, Companion companion) const
+    {
+        return m_elements.value(name).companions & companion;
+    }
+    // Number of consecutive elements "<baseName>_1", "<baseName>_2", ...
+    int variationsCount(const QString &baseName) const;
+    // Those elements, grouped by consecutive runs of equal width to height
+    // ratio, and sorted by the ratio
+    AspectRatioBuckets aspectRatioBuckets(const QString &baseName) const
+    {
+        return m_variations.value(baseName);
+    }
+
+    // Indexes of several files, by a hash of their contents
+    typedef QHash<quint64, SvgElementIndex> IndexesBySourceHash;
+    static IndexesBySourceHash readFile(const QString &fileName);
+    static bool writeFile(const QString &fileName, const IndexesBySourceHash &indexes);
+
+    friend QDataStream &operator<<(QDataStream &stream, const SvgElementIndex &index);
+    friend QDataStream &operator>>(QDataStream &stream, SvgElementIndex &index);
+
+private:
+    struct Element
+    {
+        Element() : companions(0) {}
+        QRectF bounds;
+        int companions;
+    };
+
+    QHash<QString, Element> m_elements;
+    QHash<QString, AspectRatioBuckets> m_variations; // By base name
+};
+
+QDataStream &operator<<(QDataStream &stream, const SvgElementIndex &index);
+QDataStream &operator>>(QDataStream &stream, SvgElementIndex &index);
+
+#endif // SVGELEMENTINDEX_H
@@ -45,14 +45,21 @@ VERSION = 1.1
 
 !contains(DEFINES, NO_FEEDBACK) {
     load(mobilityconfig, true)
-    contains(MOBILITY_CONFIG, multimedia) {
+    contains(DEFINES, USING_PHONON) {
+        # Pre-encoded clips, see bin/generatemp3.sh
+        QT += phonon
+        mp3audio.source = mp3audio
+        DEPLOYMENTFOLDERS += mp3audio
+    } else:!contains(DEFINES, USING_PCM_MIXER):contains(MOBILITY_CONFIG, multimedia) {
         CONFIG += mobility
         MOBILITY += multimedia
         DEFINES += USING_QT_MOBILITY
     } else {
-        QT += phonon
-        mp3audio.source = mp3audio
-        DEPLOYMENTFOLDERS += mp3audio
+        # The .mid files are rendered at startup and mixed in software
+        DEFINES *= USING_PCM_MIXER
+        QT += multimedia
+        SOURCES += audiomixer.cpp audiosink.cpp audiooutputsink.cpp midisynth.cpp
+        HEADERS += audiomixer.h audiosink.h audiooutputsink.h midisynth.h
     }
     SOURCES += feedback.cpp
     HEADERS += feedback.h
@@ -67,12 +74,16 @@ macx:ICON = touchandlearn.icns
 
 SOURCES += \
     main.cpp \
-    imageprovider.cpp
+    exercisegenerator.cpp \
+    imageprefetcher.cpp \
+    settingsstore.cpp
 
 HEADERS += \
-    imageprovider.h
+    exercisegenerator.h \
+    imageprefetcher.h \
+    settingsstore.h
 
-QT += svg
+include(imageprovider.pri)
 
 # Please do not modify the following two lines. Required for deployment.
 include(qmlapplicationviewer/qmlapplicationviewer.pri)
@@ -0,0 +1,232 @@
+/*
+    Touch'n'learn - Fun and easy mobile lessons for kids
+    Copyright (C) 2010, 2011 by Alessandro Portale
+    http://touchandlearn.sourceforge.net
+
+    This file is part of Touch'n'learn
+
+    Touch'n'learn is free software; you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    Touch'n'learn is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with Touch'n'learn; if not, write to the Free Software
+    Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA 02110-1301 USA
+*/
+
+#include "tracer.h"
+#include "imageprovidermetrics.h"
+#include <QtCore/QCoreApplication>
+#include <QtCore/QDebug>
+#include <QtCore/QFile>
+#include <QtCore/QHash>
+#include <QtCore/QMutex>
+#include <QtCore/QSocketNotifier>
+#include <QtCore/QStringList>
+#include <QtCore/QTextStream>
+#include <QtCore/QThread>
+#include <QtCore/QVector>
+#if defined(Q_OS_UNIX)
+#include <signal.h>
+#include <unistd.h>
+#endif
+
+struct TraceEvent
+{
+    char phase; // 'X' complete, 'b' and 'e' async begin and end
+    QString category;
+    QString name;
+    qint64 timestamp;
+    qint64 duration;
+    int thread;
+};
+
+struct TraceBuffer
+{
+    TraceBuffer()
+        : next(0)
+        , wrapped(false)
+    {
+        events.resize(Tracer::EventCapacity);
+    }
+
+    QMutex mutex;
+    QVector<TraceEvent> events;
+    int next;
+    bool wrapped;
+    QHash<Qt::HANDLE, int> threadIndexes;
+    QStringList threadNames;
+};
+
+Q_GLOBAL_STATIC(TraceBuffer, traceBuffer)
+
+bool Tracer::m_enabled = !qgetenv("TOUCHANDLEARN_TRACE").isEmpty();
+
+static void addEvent(char phase, const QString &category, const QString &name, qint64 timestamp, qint64 duration)
+{
+    TraceBuffer *buffer = traceBuffer();
+    const Qt::HANDLE threadId = QThread::currentThreadId();
+    const bool mainThread = QCoreApplication::instance()
+            && QThread::currentThread() == QCoreApplication::instance()->thread();
+    QMutexLocker locker(&buffer->mutex);
+    int thread = buffer->threadIndexes.value(threadId, -1);
+    if (thread == -1) {
+        thread = buffer->threadNames.count();
+        buffer->threadIndexes.insert(threadId, thread);
+        buffer->threadNames.append(mainThread ? QString::fromLatin1("main")
+                                              : QString::fromLatin1("thread %1").arg(thread));
+    }
+    TraceEvent &event = buffer->events[buffer->next];
+    event.phase = phase;
+    event.category = category;
+    event.name = name;
+    event.timestamp = timestamp;
+    event.duration = duration;
+    event.thread = thread;
+    if (++buffer->next == Tracer::EventCapacity) {
+        buffer->next = 0;
+        buffer->wrapped = true;
+    }
+}
+
+inline static QString jsonString(const QString &string)
+{
+    QString result(QLatin1Char('"'));
+    foreach (const QChar &c, string) {
+        if (c == QLatin1Char('"') || c == QLatin1Char('\\'))
+            result.append(QLatin1Char('\\')).append(c);
+        else if (c.unicode() < 0x20)
+            result.append(QString::fromLatin1("\\u%1").arg(c.unicode(), 4, 16, QLatin1Char('0')));
+        else
+            result.append(c);
+    }
+    return result + QLatin1Char('"');
+}
+
+#if defined(Q_OS_UNIX)
+static int signalPipe[2] = {-1, -1};
+
+static void writeTraceSignalHandler(int)
+{
+    const char byte = 1;
+    if (::write(signalPipe[1], &byte, 1) != 1)
+        return;
+}
+#endif // Q_OS_UNIX
+
+Tracer::Tracer(QObject *parent)
+    : QObject(parent)
+    , m_signalNotifier(0)
+{
+#if defined(Q_OS_UNIX)
+    if (m_enabled && signalPipe[0] == -1 && ::pipe(signalPipe) == 0) {
+        m_signalNotifier = new QSocketNotifier(signalPipe[0], QSocketNotifier::Read, this);
+        connect(m_signalNotifier, SIGNAL(activated(int)), SLOT(handleSignal()));
+        struct sigaction action;
+        action.sa_handler = writeTraceSignalHandler;
+        sigemptyset(&action.sa_mask);
+        action.sa_flags = SA_RESTART;
+        sigaction(SIGUSR1, &action, 0);
+    }
+#endif // Q_OS_UNIX
+}
+
+Tracer::~Tracer()
+{
+    write();
+#if defined(Q_OS_UNIX)
+    if (m_signalNotifier) {
+        signal(SIGUSR1, SIG_DFL);
+        ::close(signalPipe[0]);
+        ::close(signalPipe[1]);
+        signalPipe[0] = signalPipe[1] = -1;
+    }
+#endif // Q_OS_UNIX
+}
+
+void Tracer::addCompleteEvent(const char *category, const QString &name, qint64 startTime, qint64 duration)
+{
+    if (m_enabled)
+        addEvent('X', QLatin1String(category), name, startTime, duration);
+}
+
+bool Tracer::write()
+{
+    if (!m_enabled)
+        return false;
+    const QString fileName = QString::fromLocal8Bit(qgetenv("TOUCHANDLEARN_TRACE"));
+    QFile file(fileName);
+    if (!file.open(QIODevice::WriteOnly | QIODevice::Truncate | QIODevice::Text)) {
+        qDebug() << "****************** Could not write trace" << fileName;
+        return false;
+    }
+    const qint64 pid = QCoreApplication::applicationPid();
+    QTextStream stream(&file);
+    stream.setCodec("UTF-8");
+    stream << "{\"traceEvents\":[\n";
+    TraceBuffer *buffer = traceBuffer();
+    QMutexLocker locker(&buffer->mutex);
+    for (int i = 0; i < buffer->threadNames.count(); i++)
+        stream << "{\"name\":\"thread_name\",\"ph\":\"M\",\"pid\":" << pid << ",\"tid\":" << i
+               << ",\"args\":{\"name\":" << jsonString(buffer->threadNames.at(i)) << "}},\n";
+    const int count = buffer->wrapped ? int(EventCapacity) : buffer->next;
+    const int first = buffer->wrapped ? buffer->next : 0;
+    for (int i = 0; i < count; i++) {
+        const TraceEvent &event = buffer->events.at((first + i) % EventCapacity);
+        stream << "{\"name\":" << jsonString(event.name) << ",\"cat\":" << jsonString(event.category)
+               << ",\"ph\":\"" << event.phase << "\",\"ts\":" << event.timestamp;
+        if (event.phase == 'X')
+            stream << ",\"dur\":" << event.duration;
+        else
+            stream << ",\"id\":" << jsonString(event.category + QLatin1Char('/') + event.name);
+        stream << ",\"pid\":" << pid << ",\"tid\":" << event.thread << "}" << (i < count - 1 ? ",\n" : "\n");
+    }
+    stream << "]}\n";
+    stream.flush();
+    file.close();
+    if (file.error() != QFile::NoError)
+        return false;
+    qDebug() << "Wrote" << count << "trace events to" << fileName;
+    return true;
+}
+
+void Tracer::begin(const QString &category, const QString &name)
+{
+    if (m_enabled)
+        addEvent('b', category, name, ImageProviderMetrics::currentMicroseconds(), 0);
+}
+
+void Tracer::end(const QString &category, const QString &name)
+{
+    if (m_enabled)
+        addEvent('e', category, name, ImageProviderMetrics::currentMicroseconds(), 0);
+}
+
+void Tracer::handleSignal()
+{
+#if defined(Q_OS_UNIX)
+    char byte;
+    if (::read(signalPipe[0], &byte, 1) != 1)
+        return;
+#endif // Q_OS_UNIX
+    write();
+}
+
+void TraceSpan::start(const char *category, const QString &name)
+{
+    m_category = category;
+    m_name = name;
+    m_startTime = ImageProviderMetrics::currentMicroseconds();
+}
+
+void TraceSpan::finish()
+{
+    Tracer::addCompleteEvent(m_category, m_name, m_startTime,
+                             ImageProviderMetrics::currentMicroseconds() - m_startTime);
+}
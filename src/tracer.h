@@ -0,0 +1,90 @@
+/*
+    Touch'n'learn - Fun and easy mobile lessons for kids
+    Copyright (C) 2010, 2011 by Alessandro Portale
+    http://touchandlearn.sourceforge.net
+
+    This file is part of Touch'n'learn
+
+    Touch'n'learn is free software; you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    Touch'n'learn is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with Touch'n'learn; if not, write to the Free Software
+    Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA 02110-1301 USA
+*/
+
+#ifndef TRACER_H
+#define TRACER_H
+
+#include <QtCore/QObject>
+#include <QtCore/QString>
+
+class QSocketNotifier;
+
+// Records timestamped spans into a ring buffer of the most recent events and
+// writes them as Chrome trace event JSON (chrome://tracing, Perfetto).
+// Tracing is enabled if the environment variable TOUCHANDLEARN_TRACE holds
+// the name of the output file. Otherwise, each trace point costs one branch.
+class Tracer : public QObject
+{
+    Q_OBJECT
+
+public:
+    // Writes the trace when destroyed and, on Unix, on SIGUSR1
+    explicit Tracer(QObject *parent = 0);
+    ~Tracer();
+
+    enum { EventCapacity = 1 << 16 };
+
+    static inline bool isEnabled() { return m_enabled; }
+    // Timestamps are ImageProviderMetrics::currentMicroseconds()
+    static void addCompleteEvent(const char *category, const QString &name, qint64 startTime, qint64 duration);
+    // Writes to the file named by TOUCHANDLEARN_TRACE. The buffer is kept.
+    static bool write();
+
+    // For QML. Spans with the same category and name must not overlap.
+    Q_INVOKABLE void begin(const QString &category, const QString &name);
+    Q_INVOKABLE void end(const QString &category, const QString &name);
+
+private slots:
+    void handleSignal();
+
+private:
+    static bool m_enabled;
+    QSocketNotifier *m_signalNotifier;
+};
+
+// Records a complete event from construction to destruction
+class TraceSpan
+{
+public:
+    inline TraceSpan(const char *category, const QString &name)
+        : m_category(0)
+    {
+        if (Tracer::isEnabled())
+            start(category, name);
+    }
+
+    inline ~TraceSpan()
+    {
+        if (m_category)
+            finish();
+    }
+
+private:
+    void start(const char *category, const QString &name);
+    void finish();
+
+    const char *m_category;
+    QString m_name;
+    qint64 m_startTime;
+};
+
+#endif // TRACER_H
@@ -0,0 +1,227 @@
+/*
+    Touch'n'learn - Fun and easy mobile lessons for kids
+    Copyright (C) 2010, 2011 by Alessandro Portale
+    http://touchandlearn.sourceforge.net
+
+    This file is part of Touch'n'learn
+
+    Touch'n'learn is free software; you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    Touch'n'learn is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with Touch'n'learn; if not, write to the Free Software
+    Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA 02110-1301 USA
+*/
+
+#include "vignette.h"
+#include "simd.h"
+#include <math.h>
+#include <string.h>
+#include <QtCore/QVarLengthArray>
+
+// Entries per table row. Padded, so that vectorized code can fill whole
+// vectors. The padding entries are never read.
+inline static int tableStride(int quarterWidth)
+{
+    return (quarterWidth + 1 + 7) & ~7;
+}
+
+// Squares of the scaled coordinates. Right triangle with a, b = 181.0193359837561662; c = 256.
+static void scaledSquares(int quarterSize, int *squares, int count)
+{
+    const qreal scaleFactor = quarterSize > 0 ? 181.0193359837561662 / quarterSize : 0;
+    for (int i = 0; i < count; i++) {
+        const int scaled = scaleFactor * qMin(i, quarterSize);
+        squares[i] = scaled * scaled;
+    }
+}
+
+static void indexTableRowScalar(uchar *row, int ySquare, const int *xSquares, int count)
+{
+    for (int x = 0; x < count; x++)
+        row[x] = uchar(int(sqrt(qreal(ySquare + xSquares[x]))));
+}
+
+// The sums of squares are below 2^24 and therefore exact as floats. Their
+// square roots are never closer than 1/512 to the next integer, which is
+// much more than the float rounding error. Truncating the float square
+// root thus yields the same index as the scalar code.
+#ifdef SIMD_SSE2
+static void indexTableRowSse2(uchar *row, int ySquare, const int *xSquares, int count)
+{
+    const __m128i ySquares = _mm_set1_epi32(ySquare);
+    const __m128i zero = _mm_setzero_si128();
+    for (int x = 0; x < count; x += 4) {
+        const __m128i sums = _mm_add_epi32(ySquares, _mm_loadu_si128(reinterpret_cast<const __m128i*>(xSquares + x)));
+        const __m128i indices = _mm_cvttps_epi32(_mm_sqrt_ps(_mm_cvtepi32_ps(sums)));
+        const int packedIndices = _mm_cvtsi128_si32(_mm_packus_epi16(_mm_packs_epi32(indices, zero), zero));
+        memcpy(row + x, &packedIndices, 4);
+    }
+}
+#endif // SIMD_SSE2
+
+#ifdef SIMD_AVX2
+SIMD_AVX2_FUNCTION
+static void indexTableRowAvx2(uchar *row, int ySquare, const int *xSquares, int count)
+{
+    const __m256i ySquares = _mm256_set1_epi32(ySquare);
+    const __m128i zero = _mm_setzero_si128();
+    for (int x = 0; x < count; x += 8) {
+        const __m256i sums = _mm256_add_epi32(ySquares, _mm256_loadu_si256(reinterpret_cast<const __m256i*>(xSquares + x)));
+        const __m256i indices = _mm256_cvttps_epi32(_mm256_sqrt_ps(_mm256_cvtepi32_ps(sums)));
+        const __m128i indices16 = _mm_packs_epi32(_mm256_castsi256_si128(indices), _mm256_extracti128_si256(indices, 1));
+        _mm_storel_epi64(reinterpret_cast<__m128i*>(row + x), _mm_packus_epi16(indices16, zero));
+    }
+}
+#endif // SIMD_AVX2
+
+bool vignetteImplementationSupported(VignetteImplementation implementation)
+{
+    switch (implementation) {
+    case VignetteImplementationScalar:
+        return true;
+    case VignetteImplementationSse2:
+#ifdef SIMD_SSE2
+        return true;
+#else
+        return false;
+#endif
+    case VignetteImplementationAvx2:
+        return simdAvx2Supported();
+    }
+    return false;
+}
+
+VignetteImplementation fastestVignetteImplementation()
+{
+    if (vignetteImplementationSupported(VignetteImplementationAvx2))
+        return VignetteImplementationAvx2;
+    if (vignetteImplementationSupported(VignetteImplementationSse2))
+        return VignetteImplementationSse2;
+    return VignetteImplementationScalar;
+}
+
+QByteArray vignetteIndexTable(const QSize &imageSize, VignetteImplementation implementation)
+{
+    const int quarterWidth = imageSize.width() / 2;
+    const int quarterHeight = imageSize.height() / 2;
+    const int stride = tableStride(quarterWidth);
+    QVarLengthArray<int, 1024> xSquares(stride);
+    scaledSquares(quarterWidth, xSquares.data(), stride);
+    QVarLengthArray<int, 1024> ySquares(quarterHeight + 1);
+    scaledSquares(quarterHeight, ySquares.data(), quarterHeight + 1);
+
+    QByteArray result(stride * (quarterHeight + 1), 0);
+    uchar *row = reinterpret_cast<uchar*>(result.data());
+    for (int y = 0; y <= quarterHeight; y++, row += stride) {
+        switch (implementation) {
+#ifdef SIMD_AVX2
+        case VignetteImplementationAvx2:
+            indexTableRowAvx2(row, ySquares[y], xSquares.constData(), stride);
+            break;
+#endif
+#ifdef SIMD_SSE2
+        case VignetteImplementationSse2:
+            indexTableRowSse2(row, ySquares[y], xSquares.constData(), stride);
+            break;
+#endif
+        default:
+            indexTableRowScalar(row, ySquares[y], xSquares.constData(), quarterWidth + 1);
+            break;
+        }
+    }
+    return result;
+}
+
+// Writes the row symmetrically to both sides of center. Like the original
+// implementation, the rightmost pixel of an even width image ends up in the
+// first pixel of the next line, which later rows overwrite.
+static int drawVignetteRowScalar(QRgb *center, const uchar *indices, const QRgb *gradient, int x, int quarterWidth)
+{
+    for (; x <= quarterWidth; x++) {
+        const QRgb color = gradient[indices[x]];
+        center[-x] = color;
+        center[x] = color;
+    }
+    return x;
+}
+
+#ifdef SIMD_SSE2
+static void drawVignetteRowSse2(QRgb *center, const uchar *indices, const QRgb *gradient, int quarterWidth)
+{
+    int x = 0;
+    for (; x + 3 <= quarterWidth; x += 4) {
+        const __m128i colors = _mm_setr_epi32(gradient[indices[x]], gradient[indices[x + 1]],
+                                              gradient[indices[x + 2]], gradient[indices[x + 3]]);
+        _mm_storeu_si128(reinterpret_cast<__m128i*>(center + x), colors);
+        _mm_storeu_si128(reinterpret_cast<__m128i*>(center - x - 3), _mm_shuffle_epi32(colors, _MM_SHUFFLE(0, 1, 2, 3)));
+    }
+    drawVignetteRowScalar(center, indices, gradient, x, quarterWidth);
+}
+#endif // SIMD_SSE2
+
+#ifdef SIMD_AVX2
+SIMD_AVX2_FUNCTION
+static void drawVignetteRowAvx2(QRgb *center, const uchar *indices, const QRgb *gradient, int quarterWidth)
+{
+    const __m256i reversed = _mm256_setr_epi32(7, 6, 5, 4, 3, 2, 1, 0);
+    int x = 0;
+    for (; x + 7 <= quarterWidth; x += 8) {
+        const __m256i colorIndices = _mm256_cvtepu8_epi32(_mm_loadl_epi64(reinterpret_cast<const __m128i*>(indices + x)));
+        const __m256i colors = _mm256_i32gather_epi32(reinterpret_cast<const int*>(gradient), colorIndices, 4);
+        _mm256_storeu_si256(reinterpret_cast<__m256i*>(center + x), colors);
+        _mm256_storeu_si256(reinterpret_cast<__m256i*>(center - x - 7), _mm256_permutevar8x32_epi32(colors, reversed));
+    }
+    drawVignetteRowScalar(center, indices, gradient, x, quarterWidth);
+}
+#endif // SIMD_AVX2
+
+void drawVignette(QImage *image, const QImage &gradient, const QByteArray &indexTable,
+                  VignetteImplementation implementation)
+{
+    Q_ASSERT(image->format() == QImage::Format_ARGB32);
+    Q_ASSERT(gradient.width() == 256);
+    const int imageWidth = image->width();
+    const int quarterWidth = imageWidth / 2;
+    const int quarterHeight = image->height() / 2;
+    const int stride = tableStride(quarterWidth);
+    Q_ASSERT(indexTable.size() == stride * (quarterHeight + 1));
+    const QRgb *gradientRgb = reinterpret_cast<const QRgb*>(gradient.constBits());
+    QRgb *imageRgb = reinterpret_cast<QRgb*>(image->bits());
+
+    const uchar *indices = reinterpret_cast<const uchar*>(indexTable.constData());
+    for (int y = 0; y <= quarterHeight; y++, indices += stride) {
+        QRgb *center = imageRgb + quarterWidth + imageWidth * (quarterHeight - y);
+        switch (implementation) {
+#ifdef SIMD_AVX2
+        case VignetteImplementationAvx2:
+            drawVignetteRowAvx2(center, indices, gradientRgb, quarterWidth);
+            break;
+#endif
+#ifdef SIMD_SSE2
+        case VignetteImplementationSse2:
+            drawVignetteRowSse2(center, indices, gradientRgb, quarterWidth);
+            break;
+#endif
+        default:
+            drawVignetteRowScalar(center, indices, gradientRgb, 0, quarterWidth);
+            break;
+        }
+    }
+
+    const int bytesPerLine = image->bytesPerLine();
+    QRgb *dst = imageRgb + imageWidth * image->height() - imageWidth;
+    QRgb *src = imageRgb;
+    for (int row = 0; row < quarterHeight; row++) {
+        memcpy(dst, src, bytesPerLine);
+        dst -= imageWidth;
+        src += imageWidth;
+    }
+}
@@ -0,0 +1,50 @@
+/*
+    Touch'n'learn - Fun and easy mobile lessons for kids
+    Copyright (C) 2010, 2011 by Alessandro Portale
+    http://touchandlearn.sourceforge.net
+
+    This file is part of Touch'n'learn
+
+    Touch'n'learn is free software; you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    Touch'n'learn is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with Touch'n'learn; if not, write to the Free Software
+    Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA 02110-1301 USA
+*/
+
+#ifndef VIGNETTE_H
+#define VIGNETTE_H
+
+#include <QtCore/QByteArray>
+#include <QtGui/QImage>
+
+// Radial vignette of the buttons and frames. A 256 pixels wide gradient is
+// drawn from the center to the corners of an image.
+
+enum VignetteImplementation {
+    VignetteImplementationScalar,
+    VignetteImplementationSse2,
+    VignetteImplementationAvx2
+};
+
+bool vignetteImplementationSupported(VignetteImplementation implementation);
+VignetteImplementation fastestVignetteImplementation();
+
+// Gradient color indices for the upper left quarter of an image of the
+// given size. The table does not depend on the gradient, and can be reused
+// for all images of that size.
+QByteArray vignetteIndexTable(const QSize &imageSize, VignetteImplementation implementation);
+
+// Draws into an image of Format_ARGB32. All implementations have the same output.
+void drawVignette(QImage *image, const QImage &gradient, const QByteArray &indexTable,
+                  VignetteImplementation implementation);
+
+#endif // VIGNETTE_H
@@ -0,0 +1,145 @@
+#include <QtCore/QString>
+#include <QtTest/QtTest>
+#include <QtCore/QCoreApplication>
+#include <QtCore/QDir>
+#include <QtGui/QImage>
+
+#include "assetpack.h"
+
+class AssetPackTest : public QObject
+{
+    Q_OBJECT
+
+public:
+    AssetPackTest();
+
+private Q_SLOTS:
+    void cleanup();
+    void roundTrip();
+    void otherSourceHash();
+    void truncatedFile();
+    void zeroedPadding();
+
+private:
+    static QImage testImage(int width, int height, QRgb color);
+    bool writeTestPack();
+
+    const QString m_fileName;
+};
+
+AssetPackTest::AssetPackTest()
+    : m_fileName(QDir::tempPath() + QLatin1String("/tst_assetpacktest.pack"))
+{
+}
+
+QImage AssetPackTest::testImage(int width, int height, QRgb color)
+{
+    QImage result(width, height, QImage::Format_ARGB32_Premultiplied);
+    result.fill(color);
+    for (int i = 0; i < qMin(width, height); i++)
+        result.setPixel(i, i, qRgba(i, 2 * i, 3 * i, 255));
+    return result;
+}
+
+bool AssetPackTest::writeTestPack()
+{
+    AssetPackWriter writer(m_fileName);
+    if (!writer.open())
+        return false;
+    writer.add(QLatin1String("button/0@360x106"), 1, testImage(360, 106, 0xff336699), QSize(720, 212));
+    writer.add(QLatin1String("object/robot@154x196"), 2, testImage(154, 196, 0x80402010), QSize(154, 196));
+    // Converted to 32 bits
+    writer.add(QLatin1String("title/spectrum@360x86"), 1,
+               testImage(360, 86, 0xffffffff).convertToFormat(QImage::Format_RGB16), QSize(360, 86));
+    // The first image with a key wins
+    writer.add(QLatin1String("button/0@360x106"), 1, testImage(360, 106, 0xff000000), QSize(1, 1));
+    return writer.contains(QLatin1String("object/robot@154x196")) && writer.close();
+}
+
+void AssetPackTest::cleanup()
+{
+    QFile::remove(m_fileName);
+}
+
+void AssetPackTest::roundTrip()
+{
+    QVERIFY(writeTestPack());
+    AssetPack pack;
+    pack.setFileName(m_fileName);
+    QSize originalSize;
+    QCOMPARE(pack.image(QLatin1String("button/0@360x106"), 1, &originalSize), testImage(360, 106, 0xff336699));
+    QCOMPARE(originalSize, QSize(720, 212));
+    QCOMPARE(pack.image(QLatin1String("object/robot@154x196"), 2, &originalSize), testImage(154, 196, 0x80402010));
+    QCOMPARE(originalSize, QSize(154, 196));
+    const QImage spectrum = pack.image(QLatin1String("title/spectrum@360x86"), 1, 0);
+    QCOMPARE(spectrum.depth(), 32);
+    QCOMPARE(spectrum, testImage(360, 86, 0xffffffff).convertToFormat(QImage::Format_RGB16)
+             .convertToFormat(QImage::Format_ARGB32_Premultiplied));
+    QVERIFY(pack.image(QLatin1String("button/1@360x106"), 1, 0).isNull());
+    pack.setFileName(QString());
+    QVERIFY(pack.image(QLatin1String("button/0@360x106"), 1, 0).isNull());
+}
+
+void AssetPackTest::otherSourceHash()
+{
+    // Rendered from another version of the SVG file
+    QVERIFY(writeTestPack());
+    AssetPack pack;
+    pack.setFileName(m_fileName);
+    QSize originalSize(-1, -1);
+    QVERIFY(pack.image(QLatin1String("button/0@360x106"), 2, &originalSize).isNull());
+    QCOMPARE(originalSize, QSize(-1, -1));
+    QVERIFY(pack.image(QLatin1String("object/robot@154x196"), 1, 0).isNull());
+    QVERIFY(!pack.image(QLatin1String("object/robot@154x196"), 2, 0).isNull());
+}
+
+void AssetPackTest::truncatedFile()
+{
+    QVERIFY(writeTestPack());
+    QFile file(m_fileName);
+    const qint64 size = file.size();
+    // Cut in the keys, which follow the index: the images with intact keys
+    // are still found
+    const QImage button = testImage(360, 106, 0xff336699);
+    QVERIFY(file.resize(size - 1));
+    {
+        AssetPack pack;
+        pack.setFileName(m_fileName);
+        const QImage packedButton = pack.image(QLatin1String("button/0@360x106"), 1, 0);
+        QVERIFY(packedButton.isNull() || packedButton == button);
+        QVERIFY(pack.image(QLatin1String("title/spectrum@360x86"), 1, 0).isNull()); // The last key
+    }
+    // Cut in the index or the images
+    const qint64 sizes[] = { size / 2, 16, 8, 0 };
+    for (size_t i = 0; i < sizeof sizes / sizeof sizes[0]; i++) {
+        QVERIFY(file.resize(sizes[i]));
+        AssetPack pack;
+        pack.setFileName(m_fileName);
+        QVERIFY(pack.image(QLatin1String("button/0@360x106"), 1, 0).isNull());
+        QVERIFY(pack.image(QLatin1String("object/robot@154x196"), 2, 0).isNull());
+        QVERIFY(pack.image(QLatin1String("title/spectrum@360x86"), 1, 0).isNull());
+    }
+}
+
+void AssetPackTest::zeroedPadding()
+{
+    // The index entries are 44 bytes, padded to 48 by the compiler
+    QVERIFY(writeTestPack());
+    QFile file(m_fileName);
+    QVERIFY(file.open(QIODevice::ReadOnly));
+    const QByteArray data = file.readAll();
+    const quint32 entryCount = *reinterpret_cast<const quint32*>(data.constData() + 8);
+    const quint32 indexOffset = *reinterpret_cast<const quint32*>(data.constData() + 12);
+    QCOMPARE(entryCount, 3u);
+    const int entrySize = (data.size() - int(indexOffset)
+                           - (16 + 20 + 21) * int(sizeof(QChar))) / int(entryCount);
+    if (entrySize == 44)
+        QSKIP("The entries are not padded on this platform", SkipAll);
+    QCOMPARE(entrySize, 48);
+    for (quint32 i = 0; i < entryCount; i++)
+        QCOMPARE(data.mid(indexOffset + i * entrySize + 44, 4), QByteArray(4, '\0'));
+}
+
+QTEST_APPLESS_MAIN(AssetPackTest)
+
+#include "tst_assetpacktest.moc"
@@ -0,0 +1,130 @@
+#include <QtCore/QString>
+#include <QtTest/QtTest>
+#include <QtCore/QCoreApplication>
+#include <QtCore/QDir>
+#include <qmath.h>
+
+#include "audiomixer.h"
+#include "audiosink.h"
+
+class AudioMixerTest : public QObject
+{
+    Q_OBJECT
+
+private Q_SLOTS:
+    void wavRoundTrip();
+    void resample();
+    void invalidWav();
+    void mixAndClip();
+    void overlappingSounds();
+    void voiceStealing();
+    void playToBuffer();
+
+private:
+    static PcmClip sine(int count, int amplitude);
+};
+
+PcmClip AudioMixerTest::sine(int count, int amplitude)
+{
+    PcmClip result(count);
+    for (int i = 0; i < count; i++)
+        result[i] = qint16(qRound(amplitude * qSin(i * 0.05)));
+    return result;
+}
+
+void AudioMixerTest::wavRoundTrip()
+{
+    const PcmClip clip = sine(2000, 12000);
+    const QString fileName = QDir::tempPath() + QLatin1String("/tst_audiomixertest.wav");
+    AudioMixer mixer;
+    WavFileAudioSink sink(&mixer, fileName);
+    QVERIFY(sink.start());
+    mixer.play(&clip, 100);
+    sink.render(2500);
+    sink.stop();
+    const PcmClip decoded = loadWav(fileName, AudioMixer::SampleRate);
+    QFile::remove(fileName);
+    QCOMPARE(decoded.count(), 2500);
+    for (int i = 0; i < clip.count(); i++)
+        QCOMPARE(decoded.at(i), clip.at(i));
+    QCOMPARE(decoded.at(2100), qint16(0));
+}
+
+void AudioMixerTest::resample()
+{
+    // 22050 Hz stereo, 8 bit
+    QByteArray wav("RIFF\0\0\0\0WAVEfmt \x10\0\0\0\x01\0\x02\0\x22\x56\0\0\x88\x58\x01\0\x02\0\x08\0data\x08\0\0\0", 44);
+    wav.append("\x80\x80\xc0\xc0\x80\x80\x40\x40", 8);
+    const PcmClip clip = decodeWav(wav, 44100);
+    QCOMPARE(clip.count(), 8);
+    QCOMPARE(clip.at(0), qint16(0));
+    QCOMPARE(clip.at(1), qint16(0x2000));
+    QCOMPARE(clip.at(2), qint16(0x4000));
+    QCOMPARE(clip.at(4), qint16(0));
+    QCOMPARE(clip.at(6), qint16(-0x4000));
+}
+
+void AudioMixerTest::invalidWav()
+{
+    QVERIFY(decodeWav(QByteArray(), 44100).isEmpty());
+    QVERIFY(decodeWav(QByteArray("RIFF\0\0\0\0WAVE", 12), 44100).isEmpty());
+    // Chunk size beyond the end of the data
+    QVERIFY(decodeWav(QByteArray("RIFF\0\0\0\0WAVEfmt \xff\xff\xff\xff", 20), 44100).isEmpty());
+}
+
+void AudioMixerTest::mixAndClip()
+{
+    const PcmClip loud(100, 30000);
+    AudioMixer mixer;
+    mixer.play(&loud, 50);
+    qint16 samples[100];
+    mixer.mix(samples, 100);
+    QCOMPARE(samples[0], qint16(30000 * 128 / 256));
+    mixer.play(&loud, 100);
+    mixer.play(&loud, 100);
+    mixer.mix(samples, 100);
+    QCOMPARE(samples[0], qint16(32767));
+    QVERIFY(!mixer.isPlaying());
+}
+
+void AudioMixerTest::overlappingSounds()
+{
+    // A second play() does not cut off the first sound
+    const PcmClip clip(1000, 1000);
+    AudioMixer mixer;
+    mixer.play(&clip, 100);
+    qint16 samples[600];
+    mixer.mix(samples, 600);
+    mixer.play(&clip, 100);
+    mixer.mix(samples, 600);
+    QCOMPARE(samples[0], qint16(2000));
+    QCOMPARE(samples[399], qint16(2000));
+    QCOMPARE(samples[400], qint16(1000));
+}
+
+void AudioMixerTest::voiceStealing()
+{
+    const PcmClip clip(1000, 100);
+    AudioMixer mixer;
+    qint16 samples[10];
+    for (int i = 0; i < AudioMixer::VoiceCount + 3; i++) {
+        mixer.play(&clip, 100);
+        mixer.mix(samples, 10);
+    }
+    QCOMPARE(samples[0], qint16(100 * AudioMixer::VoiceCount));
+}
+
+void AudioMixerTest::playToBuffer()
+{
+    const PcmClip clip = sine(AudioMixer::SampleRate / 2, 8000);
+    AudioMixer mixer;
+    NullAudioSink sink(&mixer);
+    QBENCHMARK {
+        mixer.play(&clip, 80);
+        sink.render(256);
+    }
+}
+
+QTEST_MAIN(AudioMixerTest)
+
+#include "tst_audiomixertest.moc"
@@ -0,0 +1,92 @@
+#include <QtCore/QString>
+#include <QtTest/QtTest>
+#include <QtCore/QCoreApplication>
+
+#include "exercisegenerator.h"
+
+class ExerciseGeneratorTest : public QObject
+{
+    Q_OBJECT
+
+private Q_SLOTS:
+    void guarantees_data();
+    void guarantees();
+    void smallPool();
+    void batch_data();
+    void batch();
+};
+
+void ExerciseGeneratorTest::guarantees_data()
+{
+    QTest::addColumn<int>("poolSize");
+    QTest::addColumn<int>("answersCount");
+    QTest::newRow("numbers 1 to 5") << 5 << 2;
+    QTest::newRow("natural notes") << 7 << 3;
+    QTest::newRow("colors") << 11 << 4;
+    QTest::newRow("times 5") << 144 << 3;
+}
+
+void ExerciseGeneratorTest::guarantees()
+{
+    QFETCH(int, poolSize);
+    QFETCH(int, answersCount);
+    ExerciseGenerator generator;
+    generator.setSeed(1);
+    const int recentCorrectAnswersCount = qRound(poolSize * 0.5);
+    QList<int> correctAnswers;
+    QVariantList previousAnswers;
+    // Two batches, the second continues the history of the first
+    for (int batch = 0; batch < 2; batch++) {
+        const QVariantList exercises = generator.createExercises(QLatin1String("pool"), poolSize, answersCount, 100);
+        QCOMPARE(exercises.count(), 100);
+        foreach (const QVariant &exercise, exercises) {
+            const QVariantMap map = exercise.toMap();
+            const int correctAnswerIndex = map.value(QLatin1String("correctAnswerIndex")).toInt();
+            const QVariantList answers = map.value(QLatin1String("answers")).toList();
+            QCOMPARE(answers.count(), answersCount);
+            QVERIFY(correctAnswerIndex >= 0 && correctAnswerIndex < answersCount);
+            QSet<int> distinctAnswers;
+            for (int i = 0; i < answersCount; i++) {
+                const int answer = answers.at(i).toInt();
+                QVERIFY(answer >= 0 && answer < poolSize);
+                distinctAnswers.insert(answer);
+                if (!previousAnswers.isEmpty())
+                    QVERIFY(answer != previousAnswers.at(i).toInt());
+            }
+            QCOMPARE(distinctAnswers.count(), answersCount);
+            const int correctAnswer = answers.at(correctAnswerIndex).toInt();
+            QVERIFY(!correctAnswers.mid(qMax(0, correctAnswers.count() - recentCorrectAnswersCount)).contains(correctAnswer));
+            correctAnswers.append(correctAnswer);
+            previousAnswers = answers;
+        }
+    }
+}
+
+void ExerciseGeneratorTest::smallPool()
+{
+    // The rejection sampling of database.js never returned for these
+    ExerciseGenerator generator;
+    QCOMPARE(generator.createExercises(QLatin1String("two"), 2, 2, 50).count(), 50);
+    QCOMPARE(generator.createExercises(QLatin1String("one"), 1, 1, 50).count(), 50);
+    QVERIFY(generator.createExercises(QLatin1String("too small"), 2, 3, 50).isEmpty());
+}
+
+void ExerciseGeneratorTest::batch_data()
+{
+    guarantees_data();
+}
+
+void ExerciseGeneratorTest::batch()
+{
+    QFETCH(int, poolSize);
+    QFETCH(int, answersCount);
+    ExerciseGenerator generator;
+    QBENCHMARK {
+        generator.reset();
+        generator.createExercises(QLatin1String("pool"), poolSize, answersCount, 100);
+    }
+}
+
+QTEST_MAIN(ExerciseGeneratorTest)
+
+#include "tst_exercisegeneratortest.moc"
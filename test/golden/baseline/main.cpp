@@ -0,0 +1,55 @@
+/*
+    Touch'n'learn - Fun and easy mobile lessons for kids
+    Copyright (C) 2010, 2011 by Alessandro Portale
+    http://touchandlearn.sourceforge.net
+
+    This file is part of Touch'n'learn
+
+    Touch'n'learn is free software; you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    Touch'n'learn is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with Touch'n'learn; if not, write to the Free Software
+    Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA 02110-1301 USA
+*/
+
+// Records the golden references with the renderer as it was before the
+// rendering optimizations. imageprovider.cpp is a copy of that renderer,
+// see the comments starting with "Golden references" for the deviations.
+
+#include <QtCore/QDebug>
+#include <QtCore/QDir>
+#include <QtCore/QFileInfo>
+#include <QtGui/QApplication>
+#include <QtGui/QImage>
+#include <QtGui/QPixmap>
+
+#include "imageprovider.h"
+#include "../goldencorpus.h"
+
+int main(int argc, char *argv[])
+{
+    QApplication app(argc, argv);
+    ImageProvider::setDataPath(QLatin1String(GOLDEN_SOURCE_DIR "/../../src/data/graphics"));
+    ImageProvider::init();
+    ImageProvider imageProvider;
+    int result = 0;
+    foreach (const GoldenCorpus::value_type &image, goldenCorpus()) {
+        const QString fileName = goldenReferenceFileName(image.first, image.second);
+        const QImage rendered = imageProvider.requestPixmap(image.first, 0, image.second).toImage()
+                .convertToFormat(QImage::Format_ARGB32);
+        QDir().mkpath(QFileInfo(fileName).absolutePath());
+        if (rendered.isNull() || !rendered.save(fileName)) {
+            qDebug() << "Could not record" << fileName;
+            result = 1;
+        }
+    }
+    return result;
+}
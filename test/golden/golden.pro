@@ -0,0 +1,46 @@
+# Touch'n'learn - Fun and easy mobile lessons for kids
+# Copyright (C) 2010, 2011 by Alessandro Portale
+# http://touchandlearn.sourceforge.net
+#
+# This file is part of Touch'n'learn
+#
+# Touch'n'learn is free software; you can redistribute it and/or modify
+# it under the terms of the GNU General Public License as published by
+# the Free Software Foundation, either version 3 of the License, or
+# (at your option) any later version.
+#
+# Touch'n'learn is distributed in the hope that it will be useful,
+# but WITHOUT ANY WARRANTY; without even the implied warranty of
+# MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+# GNU General Public License for more details.
+#
+# You should have received a copy of the GNU General Public License
+# along with Touch'n'learn; if not, write to the Free Software
+# Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA 02110-1301 USA
+
+# Compares rendered images with the reference PNGs in references/, and
+# measures the rendering of each. Each image is rendered twice, replaying the
+# display lists and with QSvgRenderer, and compared with the same reference.
+# The references are recorded with the renderer from before the rendering
+# optimizations, by baseline/, on the Qt version under test. A missing
+# reference fails. Run with -record to overwrite the references with the
+# current renderer, after an intended change of the graphics. Failing images and their differences are written to
+# the working directory as <row>_actual.png and <row>_diff.png, with a _svg
+# suffix for QSvgRenderer. Without a display, e.g. on CI, the test runs as a
+# non-GUI application and compares QImages instead of QPixmaps.
+
+DEFINES += \
+    QT_USE_FAST_CONCATENATION \
+    QT_USE_FAST_OPERATOR_PLUS \
+    GOLDEN_SOURCE_DIR=\\\"$$PWD\\\"
+
+SOURCES += tst_goldentest.cpp
+
+HEADERS += goldencorpus.h
+
+include(../../src/imageprovider.pri)
+
+QT += testlib
+
+CONFIG += console
+CONFIG -= app_bundle
@@ -0,0 +1,64 @@
+#ifndef GOLDENCORPUS_H
+#define GOLDENCORPUS_H
+
+#include <QtCore/QList>
+#include <QtCore/QPair>
+#include <QtCore/QRegExp>
+#include <QtCore/QSize>
+#include <QtCore/QString>
+
+// The images which are compared with the references, shared by the test and
+// the recorder of the references in baseline/
+typedef QList<QPair<QString, QSize> > GoldenCorpus;
+
+inline static GoldenCorpus goldenCorpus()
+{
+    // Sizes on a 360 x 640 screen
+    const struct {
+        const char *id;
+        QSize size;
+    } corpus[] = {
+        { "background/background_01", QSize(360, 640) },
+        { "title/textmask", QSize(360, 640) },
+        { "title/spectrum", QSize(360, 86) },
+        { "specialbutton/backbutton", QSize(50, 50) },
+        { "specialbutton/volumebar_60", QSize(72, 360) },
+        { "button/0", QSize(360, 106) },
+        { "button/1", QSize(180, 106) },
+        { "button/2", QSize(120, 106) },
+        { "frame/0", QSize(360, 322) },
+        { "object/robot", QSize(196, 196) },
+        { "object/elephant", QSize(196, 196) },
+        { "clock/9/45/0", QSize(196, 196) },
+        { "clock/1/20/2", QSize(196, 196) },
+        { "notes/A sharp", QSize(196, 196) },
+        { "notes/C", QSize(196, 196) },
+        { "quantity/20/fish/1", QSize(196, 196) },
+        { "quantity/3/apple/4", QSize(196, 196) },
+        { "lessonicon/CountEasy/1", QSize(180, 207) },
+        { "lessonicon/Clock/0", QSize(180, 207) },
+        { "color/#FF3030/0", QSize(196, 196) },
+        { "color/#3030FF/3", QSize(196, 196) }
+    };
+    // The sizes scaled to other screens
+    const int screenWidths[] = { 240, 360, 480 };
+    GoldenCorpus result;
+    for (size_t i = 0; i < sizeof screenWidths / sizeof screenWidths[0]; i++)
+        for (size_t j = 0; j < sizeof corpus / sizeof corpus[0]; j++)
+            result.append(qMakePair(QString::fromLatin1(corpus[j].id), corpus[j].size * screenWidths[i] / 360));
+    return result;
+}
+
+inline static QString goldenImageName(const QString &id, const QSize &size)
+{
+    return id + QLatin1Char(' ') + QString::number(size.width()) + QLatin1Char('x') + QString::number(size.height());
+}
+
+inline static QString goldenReferenceFileName(const QString &id, const QSize &size)
+{
+    QString fileName = goldenImageName(id, size);
+    fileName.replace(QRegExp(QLatin1String("[^A-Za-z0-9_]")), QLatin1String("_"));
+    return QLatin1String(GOLDEN_SOURCE_DIR "/references/") + fileName + QLatin1String(".png");
+}
+
+#endif // GOLDENCORPUS_H
@@ -0,0 +1,174 @@
+#include <QtCore/QString>
+#include <QtTest/QtTest>
+#include <QtCore/QCoreApplication>
+
+#include "goldencorpus.h"
+#include "imageprovider.h"
+#include "imagerequest.h"
+
+static bool recordReferences = false;
+
+// Maximum difference of a color channel, and the share of pixels which may
+// exceed it. Families that are drawn from vignettes and tinted masks must
+// stay exact, the others may antialias slightly differently.
+struct Tolerance
+{
+    int channel;
+    qreal differingPixels;
+};
+
+// Indexed by ImageFamily
+static const Tolerance familyTolerances[ImageFamilyCount] = {
+    { 2,  0.002 },  // Background
+    { 2,  0.002 },  // Title
+    { 2,  0.002 },  // SpecialButton
+    { 0,  0 },      // Button
+    { 0,  0 },      // Frame
+    { 16, 0.005 },  // Object
+    { 16, 0.005 },  // Clock
+    { 16, 0.005 },  // Notes
+    { 16, 0.005 },  // Quantity
+    { 16, 0.005 },  // LessonIcon
+    { 1,  0.002 }   // Color
+};
+
+class GoldenTest : public QObject
+{
+    Q_OBJECT
+
+public:
+    GoldenTest();
+
+private Q_SLOTS:
+    void renderedImages();
+    void renderedImages_data();
+
+private:
+    QImage renderedImage(const QString &id, const QSize &requestedSize);
+
+    ImageProvider m_imageProvider;
+};
+
+GoldenTest::GoldenTest()
+    : m_imageProvider(QDeclarativeImageProvider::Image)
+{
+    ImageProvider::setDataPath(QLatin1String(GOLDEN_SOURCE_DIR "/../../src/data/graphics"));
+    ImageProvider::loadAllAssets();
+    ImageProvider::setCacheByteBudget(0);
+}
+
+// Like in the application, via a QPixmap if there is a display
+QImage GoldenTest::renderedImage(const QString &id, const QSize &requestedSize)
+{
+    ImageProvider::clearCache();
+    if (QApplication::type() == QApplication::Tty)
+        return m_imageProvider.requestImage(id, 0, requestedSize);
+    return m_imageProvider.requestPixmap(id, 0, requestedSize).toImage();
+}
+
+// Red where a pixel exceeds the tolerance, gray for smaller differences
+inline static QImage differenceImage(const QImage &expected, const QImage &actual, int channelTolerance,
+                                     int *differingPixels)
+{
+    QImage result(expected.size(), QImage::Format_RGB32);
+    *differingPixels = 0;
+    for (int y = 0; y < expected.height(); y++) {
+        const QRgb *expectedLine = reinterpret_cast<const QRgb*>(expected.constScanLine(y));
+        const QRgb *actualLine = reinterpret_cast<const QRgb*>(actual.constScanLine(y));
+        QRgb *resultLine = reinterpret_cast<QRgb*>(result.scanLine(y));
+        for (int x = 0; x < expected.width(); x++) {
+            const QRgb e = expectedLine[x];
+            const QRgb a = actualLine[x];
+            const int difference = qMax(qMax(qAbs(qRed(e) - qRed(a)), qAbs(qGreen(e) - qGreen(a))),
+                                        qMax(qAbs(qBlue(e) - qBlue(a)), qAbs(qAlpha(e) - qAlpha(a))));
+            if (difference > channelTolerance) {
+                (*differingPixels)++;
+                resultLine[x] = qRgb(255, 0, 0);
+            } else {
+                const int gray = qMin(255, difference * 16);
+                resultLine[x] = qRgb(gray, gray, gray);
+            }
+        }
+    }
+    return result;
+}
+
+void GoldenTest::renderedImages()
+{
+    QFETCH(QString, id);
+    QFETCH(QSize, requestedSize);
+    QFETCH(bool, displayLists);
+    const QString referenceFile = goldenReferenceFileName(id, requestedSize);
+    ImageProvider::setDisplayListsEnabled(displayLists);
+    QImage actual;
+    QBENCHMARK_ONCE {
+        actual = renderedImage(id, requestedSize);
+    }
+    ImageProvider::setDisplayListsEnabled(true);
+    QVERIFY(!actual.isNull());
+    actual = actual.convertToFormat(QImage::Format_ARGB32);
+
+    if (recordReferences) {
+        if (!displayLists)
+            return;
+        QDir().mkpath(QFileInfo(referenceFile).absolutePath());
+        QVERIFY(actual.save(referenceFile));
+        return;
+    }
+    QImage expected(referenceFile);
+    if (expected.isNull())
+        QFAIL("No reference image, run with -record");
+    expected = expected.convertToFormat(QImage::Format_ARGB32);
+    QCOMPARE(actual.size(), expected.size());
+
+    ImageRequest request;
+    QVERIFY(request.parse(id));
+    const Tolerance &tolerance = familyTolerances[request.family()];
+    int differingPixels;
+    const QImage difference = differenceImage(expected, actual, tolerance.channel, &differingPixels);
+    if (differingPixels > tolerance.differingPixels * expected.width() * expected.height()) {
+        QString failureBaseName = QFileInfo(referenceFile).completeBaseName();
+        if (!displayLists)
+            failureBaseName += QLatin1String("_svg");
+        actual.save(failureBaseName + QLatin1String("_actual.png"));
+        difference.save(failureBaseName + QLatin1String("_diff.png"));
+        QFAIL(qPrintable(QString::fromLatin1("%1 pixels differ, see %2_diff.png")
+                         .arg(differingPixels).arg(failureBaseName)));
+    }
+}
+
+void GoldenTest::renderedImages_data()
+{
+    QTest::addColumn<QString>("id");
+    QTest::addColumn<QSize>("requestedSize");
+    QTest::addColumn<bool>("displayLists");
+    // Both paths against the same reference: replaying the display lists,
+    // and rendering with QSvgRenderer
+    foreach (const GoldenCorpus::value_type &image, goldenCorpus()) {
+        const QByteArray rowName = goldenImageName(image.first, image.second).toLatin1();
+        const QByteArray svgRowName = rowName + " svg";
+        QTest::newRow(rowName) << image.first << image.second << true;
+        QTest::newRow(svgRowName) << image.first << image.second << false;
+    }
+}
+
+int main(int argc, char *argv[])
+{
+    QStringList arguments;
+    for (int i = 0; i < argc; i++) {
+        if (qstrcmp(argv[i], "-record") == 0)
+            recordReferences = true;
+        else
+            arguments.append(QString::fromLocal8Bit(argv[i]));
+    }
+#ifdef Q_WS_X11
+    const bool guiEnabled = !qgetenv("DISPLAY").isEmpty();
+#else
+    const bool guiEnabled = true;
+#endif
+    QApplication app(argc, argv, guiEnabled);
+    GoldenTest test;
+    return QTest::qExec(&test, arguments);
+}
+
+#include "tst_goldentest.moc"
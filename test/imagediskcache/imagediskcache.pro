@@ -0,0 +1,39 @@
+# Touch'n'learn - Fun and easy mobile lessons for kids
+# Copyright (C) 2010, 2011 by Alessandro Portale
+# http://touchandlearn.sourceforge.net
+#
+# This file is part of Touch'n'learn
+#
+# Touch'n'learn is free software; you can redistribute it and/or modify
+# it under the terms of the GNU General Public License as published by
+# the Free Software Foundation, either version 3 of the License, or
+# (at your option) any later version.
+#
+# Touch'n'learn is distributed in the hope that it will be useful,
+# but WITHOUT ANY WARRANTY; without even the implied warranty of
+# MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+# GNU General Public License for more details.
+#
+# You should have received a copy of the GNU General Public License
+# along with Touch'n'learn; if not, write to the Free Software
+# Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA 02110-1301 USA
+
+# Checks the persistent image cache: round trips through the cache file,
+# invalidation by the source hash, the byte bounds and the release of
+# previous mappings
+
+TARGET = tst_imagediskcachetest
+
+SOURCES += \
+    tst_imagediskcachetest.cpp \
+    ../../src/imagediskcache.cpp
+
+HEADERS += \
+    ../../src/imagediskcache.h
+
+INCLUDEPATH += ../../src
+
+QT += testlib
+
+CONFIG += console
+CONFIG -= app_bundle
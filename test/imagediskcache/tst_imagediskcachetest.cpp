@@ -0,0 +1,168 @@
+#include <QtCore/QString>
+#include <QtTest/QtTest>
+#include <QtCore/QCoreApplication>
+#include <QtCore/QDir>
+#include <QtGui/QImage>
+
+#include "imagediskcache.h"
+
+class ImageDiskCacheTest : public QObject
+{
+    Q_OBJECT
+
+private Q_SLOTS:
+    void init();
+    void cleanup();
+    void roundTrip();
+    void sourceHashChanged();
+    void byteBound();
+    void retiredMappings();
+
+private:
+    static QImage testImage(int width, int height, QRgb color);
+    static QSet<quint64> hashes(quint64 hash);
+
+    QString m_fileName;
+};
+
+QImage ImageDiskCacheTest::testImage(int width, int height, QRgb color)
+{
+    QImage result(width, height, QImage::Format_ARGB32_Premultiplied);
+    result.fill(color);
+    result.setPixel(0, 0, qRgba(1, 2, 3, 255));
+    return result;
+}
+
+QSet<quint64> ImageDiskCacheTest::hashes(quint64 hash)
+{
+    QSet<quint64> result;
+    result.insert(hash);
+    return result;
+}
+
+void ImageDiskCacheTest::init()
+{
+    m_fileName = QDir::tempPath() + QLatin1String("/tst_imagediskcachetest.cache");
+    QFile::remove(m_fileName);
+    QFile::remove(m_fileName + QLatin1String(".new"));
+}
+
+void ImageDiskCacheTest::cleanup()
+{
+    QFile::remove(m_fileName);
+    QFile::remove(m_fileName + QLatin1String(".new"));
+}
+
+void ImageDiskCacheTest::roundTrip()
+{
+    const QImage button = testImage(33, 17, 0xff336699);
+    const QImage frame = testImage(40, 40, 0x80402010);
+    {
+        ImageDiskCache cache;
+        cache.setFileName(m_fileName);
+        cache.insert(QLatin1String("button/0@33x17"), 1, button, QSize(330, 170));
+        cache.insert(QLatin1String("frame/0@40x40"), 1, frame, QSize(400, 400));
+        QVERIFY(cache.save(hashes(1)));
+        // Now from the mapping
+        QCOMPARE(cache.image(QLatin1String("button/0@33x17"), 1, 0), button);
+    }
+    ImageDiskCache cache;
+    cache.setFileName(m_fileName);
+    QSize originalSize;
+    const QImage storedButton = cache.image(QLatin1String("button/0@33x17"), 1, &originalSize);
+    QCOMPARE(storedButton, button);
+    QCOMPARE(storedButton.format(), button.format());
+    QCOMPARE(originalSize, QSize(330, 170));
+    QCOMPARE(cache.image(QLatin1String("frame/0@40x40"), 1, &originalSize), frame);
+    QCOMPARE(originalSize, QSize(400, 400));
+    QVERIFY(cache.image(QLatin1String("frame/1@40x40"), 1, 0).isNull());
+    // Unchanged images are not written again
+    const QDateTime modified = QFileInfo(m_fileName).lastModified();
+    QVERIFY(cache.save(hashes(1)));
+    QCOMPARE(QFileInfo(m_fileName).lastModified(), modified);
+}
+
+void ImageDiskCacheTest::sourceHashChanged()
+{
+    const QImage image = testImage(20, 20, 0xffff0000);
+    {
+        ImageDiskCache cache;
+        cache.setFileName(m_fileName);
+        cache.insert(QLatin1String("object/robot@20x20"), 1, image, QSize(20, 20));
+        QVERIFY(cache.image(QLatin1String("object/robot@20x20"), 2, 0).isNull());
+        QVERIFY(cache.save(hashes(1)));
+        QVERIFY(cache.image(QLatin1String("object/robot@20x20"), 2, 0).isNull());
+    }
+    {
+        // The SVG file changed: the stale image is not written again
+        ImageDiskCache cache;
+        cache.setFileName(m_fileName);
+        QCOMPARE(cache.image(QLatin1String("object/robot@20x20"), 1, 0), image);
+        cache.insert(QLatin1String("object/robot@20x20"), 2, testImage(20, 20, 0xff00ff00), QSize(20, 20));
+        QVERIFY(cache.save(hashes(2)));
+    }
+    ImageDiskCache cache;
+    cache.setFileName(m_fileName);
+    QVERIFY(cache.image(QLatin1String("object/robot@20x20"), 1, 0).isNull());
+    QCOMPARE(cache.image(QLatin1String("object/robot@20x20"), 2, 0), testImage(20, 20, 0xff00ff00));
+}
+
+void ImageDiskCacheTest::byteBound()
+{
+    const QImage image = testImage(32, 32, 0xff0000ff); // 4 KB
+    {
+        ImageDiskCache cache;
+        cache.setFileName(m_fileName);
+        cache.setMaxBytes(image.byteCount() * 3);
+        for (int i = 0; i < 5; i++)
+            cache.insert(QString::fromLatin1("color/%1@32x32").arg(i), 1, image, QSize(32, 32));
+        int inMemory = 0;
+        for (int i = 0; i < 5; i++)
+            if (!cache.image(QString::fromLatin1("color/%1@32x32").arg(i), 1, 0).isNull())
+                inMemory++;
+        QCOMPARE(inMemory, 3);
+        QVERIFY(cache.save(hashes(1)));
+        // Space for new images again, the file keeps the bound
+        for (int i = 5; i < 7; i++)
+            cache.insert(QString::fromLatin1("color/%1@32x32").arg(i), 1, image, QSize(32, 32));
+        QVERIFY(cache.save(hashes(1)));
+    }
+    ImageDiskCache cache;
+    cache.setFileName(m_fileName);
+    int stored = 0;
+    for (int i = 0; i < 7; i++)
+        if (!cache.image(QString::fromLatin1("color/%1@32x32").arg(i), 1, 0).isNull())
+            stored++;
+    QCOMPARE(stored, 3);
+    QVERIFY(QFileInfo(m_fileName).size() < 4 * image.byteCount());
+}
+
+void ImageDiskCacheTest::retiredMappings()
+{
+    ImageDiskCache cache;
+    cache.setFileName(m_fileName);
+    cache.insert(QLatin1String("notes/C@10x10"), 1, testImage(10, 10, 0xff000000), QSize(10, 10));
+    QVERIFY(cache.save(hashes(1)));
+    QCOMPARE(cache.mappedFileCount(), 1);
+    QImage mapped = cache.image(QLatin1String("notes/C@10x10"), 1, 0);
+    QVERIFY(!mapped.isNull());
+
+    // The returned image keeps the previous file mapped
+    cache.insert(QLatin1String("notes/D@10x10"), 1, testImage(10, 10, 0xff111111), QSize(10, 10));
+    QVERIFY(cache.save(hashes(1)));
+    QCOMPARE(cache.mappedFileCount(), 2);
+    QCOMPARE(mapped, testImage(10, 10, 0xff000000));
+
+    // Released with the next save, and the mappings do not accumulate
+    mapped = QImage();
+    for (int i = 0; i < 5; i++) {
+        cache.insert(QString::fromLatin1("notes/E@%1x10").arg(i + 1), 1, testImage(i + 1, 10, 0xff222222), QSize(10, 10));
+        QVERIFY(cache.save(hashes(1)));
+        QCOMPARE(cache.mappedFileCount(), 1);
+    }
+    QCOMPARE(cache.image(QLatin1String("notes/C@10x10"), 1, 0), testImage(10, 10, 0xff000000));
+}
+
+QTEST_APPLESS_MAIN(ImageDiskCacheTest)
+
+#include "tst_imagediskcachetest.moc"
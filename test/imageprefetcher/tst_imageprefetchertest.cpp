@@ -0,0 +1,92 @@
+#include <QtCore/QString>
+#include <QtTest/QtTest>
+#include <QtCore/QCoreApplication>
+
+#include "imageprefetcher.h"
+#include "imageprovider.h"
+
+class ImagePrefetcherTest : public QObject
+{
+    Q_OBJECT
+
+public:
+    ImagePrefetcherTest();
+
+private Q_SLOTS:
+    void prefetchIntoCache();
+    void cancelDropsStaleImages();
+
+private:
+    static QVariantList quantityIds(int firstSeed, int count);
+    static bool waitForMisses(int misses);
+};
+
+ImagePrefetcherTest::ImagePrefetcherTest()
+{
+    ImageProvider::setDataPath(QLatin1String(GRAPHICS_SOURCE_DIR));
+    ImageProvider::loadAllAssets();
+    ImageProvider::setCacheByteBudget(64 * 1024 * 1024);
+}
+
+// Seeded quantities are cached, and each seed has its own cache key
+QVariantList ImagePrefetcherTest::quantityIds(int firstSeed, int count)
+{
+    QVariantList result;
+    for (int i = 0; i < count; i++)
+        result.append(QString::fromLatin1("image://imageprovider/quantity/20/fish/%1").arg(firstSeed + i));
+    return result;
+}
+
+// Each prefetched image that gets rendered is a cache miss
+bool ImagePrefetcherTest::waitForMisses(int misses)
+{
+    for (int i = 0; i < 600 && ImageProvider::cacheMisses() < misses; i++)
+        QTest::qWait(50);
+    return ImageProvider::cacheMisses() >= misses;
+}
+
+void ImagePrefetcherTest::prefetchIntoCache()
+{
+    ImageProvider::clearCache();
+    ImagePrefetcher prefetcher;
+    const int misses = ImageProvider::cacheMisses();
+    prefetcher.prefetch(quantityIds(0, 8), 196, 196);
+    QVERIFY(waitForMisses(misses + 8));
+
+    ImageProvider imageProvider(QDeclarativeImageProvider::Image);
+    const int hits = ImageProvider::cacheHits();
+    for (int i = 0; i < 8; i++)
+        QVERIFY(!imageProvider.requestImage(QString::fromLatin1("quantity/20/fish/%1").arg(i), 0, QSize(196, 196)).isNull());
+    QCOMPARE(ImageProvider::cacheHits(), hits + 8);
+    QCOMPARE(ImageProvider::cacheMisses(), misses + 8);
+}
+
+void ImagePrefetcherTest::cancelDropsStaleImages()
+{
+    // The images of the previous screen are queued behind the few which are
+    // being rendered. cancel() drops those, and keeps the newer ones.
+    const int staleCount = 400;
+    const int currentCount = 8;
+    ImageProvider::clearCache();
+    ImagePrefetcher prefetcher;
+    const int misses = ImageProvider::cacheMisses();
+    prefetcher.prefetch(quantityIds(1000, staleCount), 196, 196);
+    prefetcher.cancel();
+    prefetcher.prefetch(quantityIds(2000, currentCount), 196, 196);
+    // Same priority, the current images are rendered after the stale ones were dropped
+    QVERIFY(waitForMisses(misses + currentCount));
+    QTest::qWait(200);
+    const int renderedStale = ImageProvider::cacheMisses() - misses - currentCount;
+    QVERIFY2(renderedStale <= QThread::idealThreadCount() * 2,
+             qPrintable(QString::fromLatin1("%1 stale images were rendered").arg(renderedStale)));
+
+    ImageProvider imageProvider(QDeclarativeImageProvider::Image);
+    const int hits = ImageProvider::cacheHits();
+    for (int i = 0; i < currentCount; i++)
+        imageProvider.requestImage(QString::fromLatin1("quantity/20/fish/%1").arg(2000 + i), 0, QSize(196, 196));
+    QCOMPARE(ImageProvider::cacheHits(), hits + currentCount);
+}
+
+QTEST_MAIN(ImagePrefetcherTest)
+
+#include "tst_imageprefetchertest.moc"
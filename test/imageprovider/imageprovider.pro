@@ -26,16 +26,9 @@ DEFINES += \
     QT_USE_FAST_CONCATENATION \
     QT_USE_FAST_OPERATOR_PLUS
 
-SOURCES += test.cpp \
-    ../../src/imageprovider.cpp
+SOURCES += test.cpp
 
-HEADERS += \
-    ../../src/imageprovider.h
-
-INCLUDEPATH += \
-    ../../src
-
-QT += svg
+include(../../src/imageprovider.pri)
 
 # Please do not modify the following two lines. Required for deployment.
 include(../../src/qmlapplicationviewer/qmlapplicationviewer.pri)
@@ -23,6 +23,7 @@
 #include <QtGui>
 
 #include "imageprovider.h"
+#include "imageprovidermetrics.h"
 
 class ImagePainter: public QWidget
 {
@@ -44,6 +45,17 @@ public:
         qDebug() << "id:" << m_id << " requested:" << requestedSize << " returned:" << returnedSize;
     }
 
+    // M prints the metrics of the requests so far, R resets them
+    void keyPressEvent(QKeyEvent *event)
+    {
+        if (event->key() == Qt::Key_M)
+            qDebug() << qPrintable(m_metrics.report());
+        else if (event->key() == Qt::Key_R)
+            m_metrics.reset();
+        else
+            QWidget::keyPressEvent(event);
+    }
+
     QString id() const
     {
         return m_id;
@@ -59,6 +71,7 @@ public slots:
 private:
     QString m_id;
     ImageProvider m_imageProvider;
+    ImageProviderMetrics m_metrics;
 };
 
 int main(int argc, char *argv[])
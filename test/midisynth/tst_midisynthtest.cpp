@@ -0,0 +1,126 @@
+#include <QtCore/QString>
+#include <QtTest/QtTest>
+#include <QtCore/QCoreApplication>
+#include <QtCore/QFile>
+
+#include "midisynth.h"
+
+class MidiSynthTest : public QObject
+{
+    Q_OBJECT
+
+private Q_SLOTS:
+    void referenceRender_data();
+    void referenceRender();
+    void invalidMidi();
+    void noteOff();
+    void renderSpeed();
+
+private:
+    static QByteArray readMidi(const QString &baseName);
+    static QByteArray singleNote(int key, bool noteOff);
+    static quint32 fnv1a(const PcmClip &clip);
+};
+
+QByteArray MidiSynthTest::readMidi(const QString &baseName)
+{
+    QFile file(QLatin1String(MIDI_SOURCE_DIR "/") + baseName + QLatin1String(".mid"));
+    if (!file.open(QIODevice::ReadOnly))
+        return QByteArray();
+    return file.readAll();
+}
+
+// Format 0, 96 ticks per quarter, one piano note of one quarter (0.5 s)
+QByteArray MidiSynthTest::singleNote(int key, bool noteOff)
+{
+    QByteArray result("MThd\0\0\0\x06\0\0\0\x01\0\x60MTrk\0\0\0\x0c", 22);
+    result.append("\x00\x90", 2).append(char(key)).append('\x64');
+    result.append("\x60\x80", 2).append(char(key)).append(noteOff ? '\x40' : '\x00');
+    if (!noteOff)
+        result[27] = '\x90'; // Velocity 0 instead
+    result.append("\x00\xff\x2f\x00", 4);
+    return result;
+}
+
+// Of the samples as little endian bytes
+quint32 MidiSynthTest::fnv1a(const PcmClip &clip)
+{
+    quint32 result = 2166136261u;
+    foreach (const qint16 sample, clip) {
+        result = (result ^ (quint16(sample) & 0xff)) * 16777619u;
+        result = (result ^ (quint16(sample) >> 8)) * 16777619u;
+    }
+    return result;
+}
+
+void MidiSynthTest::referenceRender_data()
+{
+    QTest::addColumn<QString>("baseName");
+    QTest::addColumn<int>("sampleCount");
+    QTest::addColumn<uint>("hash");
+
+    QTest::newRow("correctanswer_01") << "correctanswer_01" << 107671 << 0xe0027c83u;
+    QTest::newRow("correctanswer_02") << "correctanswer_02" << 103982 << 0x00cfbf54u;
+    QTest::newRow("correctanswer_03") << "correctanswer_03" << 103982 << 0x5abbc795u;
+    QTest::newRow("correctanswer_04") << "correctanswer_04" << 107671 << 0x466dd34eu;
+    QTest::newRow("correctanswer_05") << "correctanswer_05" << 107671 << 0x2949f141u;
+    QTest::newRow("incorrectanswer_01") << "incorrectanswer_01" << 55419 << 0x789a502fu;
+    QTest::newRow("incorrectanswer_02") << "incorrectanswer_02" << 56507 << 0xaef7e59cu;
+    QTest::newRow("incorrectanswer_03") << "incorrectanswer_03" << 56546 << 0xd68c6e6au;
+    QTest::newRow("incorrectanswer_04") << "incorrectanswer_04" << 55383 << 0x86153d90u;
+}
+
+void MidiSynthTest::referenceRender()
+{
+    QFETCH(QString, baseName);
+    QFETCH(int, sampleCount);
+    QFETCH(uint, hash);
+
+    const QByteArray midi = readMidi(baseName);
+    QVERIFY(!midi.isEmpty());
+    const PcmClip clip = renderMidi(midi, AudioMixer::SampleRate);
+    QCOMPARE(clip.count(), sampleCount);
+    int peak = 0;
+    foreach (const qint16 sample, clip)
+        peak = qMax(peak, qAbs(int(sample)));
+    QCOMPARE(peak, 23198);
+    QCOMPARE(uint(fnv1a(clip)), hash);
+}
+
+void MidiSynthTest::invalidMidi()
+{
+    QVERIFY(renderMidi(QByteArray(), AudioMixer::SampleRate).isEmpty());
+    QVERIFY(renderMidi(QByteArray("RIFF\0\0\0\0WAVE", 12), AudioMixer::SampleRate).isEmpty());
+    // Track size beyond the end of the data
+    QByteArray truncated = singleNote(60, true);
+    truncated.chop(4);
+    QVERIFY(renderMidi(truncated, AudioMixer::SampleRate).isEmpty());
+    // Running status without a previous status byte
+    QVERIFY(renderMidi(QByteArray("MThd\0\0\0\x06\0\0\0\x01\0\x60MTrk\0\0\0\x03\0\x3c\x64", 25),
+                       AudioMixer::SampleRate).isEmpty());
+    QVERIFY(loadMidi(QLatin1String("nonexistent.mid"), AudioMixer::SampleRate).isEmpty());
+}
+
+void MidiSynthTest::noteOff()
+{
+    // Note off and note on with velocity 0 end the note alike
+    const PcmClip clip = renderMidi(singleNote(60, true), AudioMixer::SampleRate);
+    QVERIFY(!clip.isEmpty());
+    QVERIFY(clip == renderMidi(singleNote(60, false), AudioMixer::SampleRate));
+    QVERIFY(clip.count() > AudioMixer::SampleRate / 2);
+    QVERIFY(clip.count() < AudioMixer::SampleRate * 3);
+    // The highest key is clamped below the Nyquist frequency
+    QVERIFY(!renderMidi(singleNote(127, true), AudioMixer::SampleRate).isEmpty());
+}
+
+void MidiSynthTest::renderSpeed()
+{
+    const QByteArray midi = readMidi(QLatin1String("correctanswer_01"));
+    QBENCHMARK {
+        renderMidi(midi, AudioMixer::SampleRate);
+    }
+}
+
+QTEST_MAIN(MidiSynthTest)
+
+#include "tst_midisynthtest.moc"
@@ -0,0 +1,252 @@
+#include <QtCore/QElapsedTimer>
+#include <QtCore/QFile>
+#include <QtCore/QStringList>
+#include <QtCore/QTextStream>
+#include <QtGui/QApplication>
+#include <new>
+#include <stdlib.h>
+#if defined(Q_OS_UNIX)
+#include <sys/resource.h>
+#include <time.h>
+#endif
+
+#include "imageprovider.h"
+#include "imagerequest.h"
+
+// Counts all allocations of the process. With glibc, malloc() itself gets
+// replaced, which also catches Qt's qMalloc(). Elsewhere, only operator new.
+static QBasicAtomicInt allocationCount = Q_BASIC_ATOMIC_INITIALIZER(0);
+
+#if defined(__GLIBC__)
+static const char allocationCounter[] = "malloc";
+extern "C" {
+void *__libc_malloc(size_t size);
+void *__libc_calloc(size_t count, size_t size);
+void *__libc_realloc(void *pointer, size_t size);
+
+void *malloc(size_t size)
+{
+    allocationCount.ref();
+    return __libc_malloc(size);
+}
+
+void *calloc(size_t count, size_t size)
+{
+    allocationCount.ref();
+    return __libc_calloc(count, size);
+}
+
+void *realloc(void *pointer, size_t size)
+{
+    allocationCount.ref();
+    return __libc_realloc(pointer, size);
+}
+}
+#else // __GLIBC__
+static const char allocationCounter[] = "operator new";
+
+void *operator new(size_t size)
+{
+    allocationCount.ref();
+    void *result = malloc(size);
+    if (!result)
+        throw std::bad_alloc();
+    return result;
+}
+
+void *operator new[](size_t size)
+{
+    return operator new(size);
+}
+
+void operator delete(void *pointer) throw()
+{
+    free(pointer);
+}
+
+void operator delete[](void *pointer) throw()
+{
+    free(pointer);
+}
+#endif // __GLIBC__
+
+// Peak resident set size in KB since the last call, or since the start of
+// the process where the peak cannot be reset. -1 if unknown.
+static qint64 peakRss()
+{
+    qint64 result = -1;
+#if defined(Q_OS_LINUX)
+    QFile status(QLatin1String("/proc/self/status"));
+    if (status.open(QIODevice::ReadOnly)) {
+        foreach (const QByteArray &line, status.readAll().split('\n'))
+            if (line.startsWith("VmHWM:"))
+                result = line.mid(6).trimmed().split(' ').first().toLongLong();
+    }
+    QFile clearRefs(QLatin1String("/proc/self/clear_refs"));
+    if (clearRefs.open(QIODevice::WriteOnly))
+        clearRefs.write("5"); // Resets the peak
+#elif defined(Q_OS_UNIX)
+    struct rusage usage;
+    if (getrusage(RUSAGE_SELF, &usage) == 0)
+#if defined(Q_OS_MAC)
+        result = usage.ru_maxrss / 1024; // Bytes
+#else
+        result = usage.ru_maxrss;
+#endif
+#endif
+    return result;
+}
+
+// QElapsedTimer::nsecsElapsed() needs Qt 4.8
+static qint64 nanoseconds()
+{
+#if defined(Q_OS_UNIX) && defined(CLOCK_MONOTONIC)
+    struct timespec time;
+    clock_gettime(CLOCK_MONOTONIC, &time);
+    return qint64(time.tv_sec) * 1000000000 + time.tv_nsec;
+#else
+    static QElapsedTimer timer;
+    if (!timer.isValid())
+        timer.start();
+    return timer.elapsed() * 1000000;
+#endif
+}
+
+struct Measurement
+{
+    qint64 nanoseconds;
+    qint64 peakRssKb;
+    int allocations;
+};
+
+static Measurement measuredRequest(ImageProvider *imageProvider, const QString &id, const QSize &requestedSize,
+                                   int iterations)
+{
+    peakRss();
+    const int allocationsBefore = allocationCount;
+    qint64 totalNanoseconds = 0;
+    for (int i = 0; i < iterations; i++) {
+        ImageProvider::clearCache();
+        qsrand(1);
+        const qint64 start = nanoseconds();
+        imageProvider->requestImage(id, 0, requestedSize);
+        totalNanoseconds += nanoseconds() - start;
+    }
+    Measurement result;
+    result.allocations = (int(allocationCount) - allocationsBefore) / iterations;
+    result.peakRssKb = peakRss();
+    result.nanoseconds = totalNanoseconds / iterations;
+    return result;
+}
+
+inline static QString jsonString(const QString &string)
+{
+    QString result = string;
+    result.replace(QLatin1Char('\\'), QLatin1String("\\\\"));
+    result.replace(QLatin1Char('"'), QLatin1String("\\\""));
+    return QLatin1Char('"') + result + QLatin1Char('"');
+}
+
+// Sizes on a 360 x 640 screen
+static const struct {
+    const char *id;
+    QSize size;
+} corpus[] = {
+    { "background/background_01", QSize(360, 640) },
+    { "title/textmask", QSize(360, 640) },
+    { "title/spectrum", QSize(360, 86) },
+    { "specialbutton/backbutton", QSize(50, 50) },
+    { "specialbutton/volumebar_60", QSize(72, 360) },
+    { "button/1", QSize(360, 106) },
+    { "button/2", QSize(120, 106) },
+    { "frame/0", QSize(360, 322) },
+    { "object/robot", QSize(196, 196) },
+    { "object/hedgehog", QSize(196, 196) },
+    { "clock/9/45/0", QSize(196, 196) },
+    { "notes/A sharp", QSize(196, 196) },
+    { "notes/C,E,G", QSize(196, 196) },
+    { "quantity/20/fish/1", QSize(196, 196) },
+    { "quantity/5/balloon/2", QSize(196, 196) },
+    { "lessonicon/CountEasy/1", QSize(180, 207) },
+    { "lessonicon/Clock/0", QSize(180, 207) },
+    { "color/#FF3030/0", QSize(196, 196) }
+};
+
+static const QSize screenProfiles[] = {
+    QSize(240, 320),
+    QSize(360, 640),
+    QSize(480, 854)
+};
+
+int main(int argc, char *argv[])
+{
+    QApplication app(argc, argv, false);
+    const QStringList arguments = app.arguments();
+    QString outputFileName = QLatin1String("rendermatrix.json");
+    QString revision;
+    int warmIterations = 10;
+    for (int i = 1; i < arguments.count(); i++) {
+        if (arguments.at(i) == QLatin1String("-o") && i + 1 < arguments.count()) {
+            outputFileName = arguments.at(++i);
+        } else if (arguments.at(i) == QLatin1String("-revision") && i + 1 < arguments.count()) {
+            revision = arguments.at(++i);
+        } else if (arguments.at(i) == QLatin1String("-iterations") && i + 1 < arguments.count()) {
+            warmIterations = qMax(1, arguments.at(++i).toInt());
+        } else {
+            QTextStream(stdout) << "Usage: rendermatrix [-o <json file>] [-revision <id>] [-iterations <warm runs>]"
+                                << endl;
+            return 1;
+        }
+    }
+
+    QFile outputFile(outputFileName);
+    if (!outputFile.open(QIODevice::WriteOnly | QIODevice::Truncate | QIODevice::Text)) {
+        QTextStream(stdout) << "Could not write " << outputFileName << endl;
+        return 1;
+    }
+    ImageProvider::setDataPath(QLatin1String(RENDERMATRIX_SOURCE_DIR "/../../src/data/graphics"));
+    ImageProvider::setCacheByteBudget(0);
+    ImageProvider imageProvider(QDeclarativeImageProvider::Image);
+
+    QTextStream out(&outputFile);
+    out << "{\n"
+        << "  \"revision\": " << jsonString(revision) << ",\n"
+        << "  \"qtVersion\": " << jsonString(QLatin1String(qVersion())) << ",\n"
+        << "  \"allocationCounter\": " << jsonString(QLatin1String(allocationCounter)) << ",\n"
+        << "  \"warmIterations\": " << warmIterations << ",\n"
+        << "  \"results\": [";
+    bool first = true;
+    for (size_t i = 0; i < sizeof screenProfiles / sizeof screenProfiles[0]; i++) {
+        const QSize &screen = screenProfiles[i];
+        const QString profile = QString::number(screen.width()) + QLatin1Char('x') + QString::number(screen.height());
+        for (size_t j = 0; j < sizeof corpus / sizeof corpus[0]; j++) {
+            const QString id = QLatin1String(corpus[j].id);
+            const QSize requestedSize = corpus[j].size * screen.width() / 360;
+            ImageRequest request;
+            request.parse(id);
+            for (int warm = 0; warm <= 1; warm++) {
+                // Cold: parsing the SVG and indexing its elements is part of the request
+                if (warm)
+                    ImageProvider::loadAllAssets();
+                else
+                    ImageProvider::unloadAssets();
+                const Measurement measurement =
+                        measuredRequest(&imageProvider, id, requestedSize, warm ? warmIterations : 1);
+                out << (first ? "\n" : ",\n")
+                    << "    { \"family\": " << jsonString(ImageRequest::familyName(request.family()))
+                    << ", \"id\": " << jsonString(id)
+                    << ", \"profile\": " << jsonString(profile)
+                    << ", \"width\": " << requestedSize.width()
+                    << ", \"height\": " << requestedSize.height()
+                    << ", \"run\": " << (warm ? "\"warm\"" : "\"cold\"")
+                    << ", \"wallTimeNs\": " << measurement.nanoseconds
+                    << ", \"peakRssKb\": " << measurement.peakRssKb
+                    << ", \"allocations\": " << measurement.allocations << " }";
+                first = false;
+            }
+        }
+        QTextStream(stdout) << profile << " done" << endl;
+    }
+    out << "\n  ]\n}\n";
+    return 0;
+}
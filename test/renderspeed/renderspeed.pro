@@ -26,16 +26,11 @@ DEFINES += \
     QT_USE_FAST_CONCATENATION \
     QT_USE_FAST_OPERATOR_PLUS
 
-SOURCES += tst_renderspeedtest.cpp \
-    ../../src/imageprovider.cpp
+SOURCES += tst_renderspeedtest.cpp
 
-HEADERS += \
-    ../../src/imageprovider.h
+include(../../src/imageprovider.pri)
 
-INCLUDEPATH += \
-    ../../src
-
-QT += testlib svg
+QT += testlib
 
 CONFIG += console
 CONFIG -= app_bundle
@@ -1,8 +1,58 @@
 #include <QtCore/QString>
 #include <QtTest/QtTest>
 #include <QtCore/QCoreApplication>
+#include <QtCore/QSemaphore>
+#include <QtCore/QThreadPool>
+#include <QtGui/QPainter>
+#include <QtSvg/QSvgRenderer>
+#include <limits.h>
+#include <math.h>
 
+#include "colortint.h"
 #include "imageprovider.h"
+#include "imageprovidermetrics.h"
+#include "imagerequest.h"
+#include "svgelementindex.h"
+#include "vignette.h"
+
+class RenderTask : public QRunnable
+{
+public:
+    RenderTask(ImageProvider *imageProvider, const QString &id, const QSize &requestedSize)
+        : m_imageProvider(imageProvider)
+        , m_id(id)
+        , m_requestedSize(requestedSize)
+    { }
+
+    void run()
+    {
+        m_imageProvider->requestImage(m_id, 0, m_requestedSize);
+    }
+
+private:
+    ImageProvider *m_imageProvider;
+    const QString m_id;
+    const QSize m_requestedSize;
+};
+
+class SignalingRenderTask : public RenderTask
+{
+public:
+    SignalingRenderTask(ImageProvider *imageProvider, const QString &id, const QSize &requestedSize,
+                        QSemaphore *done)
+        : RenderTask(imageProvider, id, requestedSize)
+        , m_done(done)
+    { }
+
+    void run()
+    {
+        RenderTask::run();
+        m_done->release();
+    }
+
+private:
+    QSemaphore *m_done;
+};
 
 class RenderspeedTest : public QObject
 {
@@ -13,8 +63,37 @@ public:
 
 private Q_SLOTS:
     void vignetteEffect();
+    void vignetteKernel();
+    void vignetteKernel_data();
+    void designElementsMixed();
+    void colorBlotTint();
+    void colorTintKernel();
+    void colorTintKernel_data();
     void exerciseImages();
     void exerciseImages_data();
+    void exerciseImagesCached();
+    void exerciseImagesCached_data();
+    void seededQuantityLayout();
+    void requestParsing();
+    void requestParsing_data();
+    void requestIntArguments();
+    void requestIntArguments_data();
+    void cachedRequestDispatch();
+    void cachedRequestDispatch_data();
+    void requestMetrics();
+    void displayListAccuracy();
+    void displayListAccuracy_data();
+    void displayListRendering();
+    void displayListRendering_data();
+    void svgElementIndex();
+    void svgElementIndex_data();
+    void assetPackLookup();
+    void assetPackLookup_data();
+    void threadedRendering();
+    void threadedRendering_data();
+    void startupMenuFrame();
+    void startupMenuFrame_data();
+    void coldStartLessonIcons();
 
 private:
     ImageProvider m_imageProvider;
@@ -22,7 +101,9 @@ private:
 
 RenderspeedTest::RenderspeedTest()
 {
-    ImageProvider::init();
+    ImageProvider::loadAllAssets();
+    // Measure the actual rendering unless a test explicitly enables the cache
+    ImageProvider::setCacheByteBudget(0);
 }
 
 void RenderspeedTest::vignetteEffect()
@@ -39,6 +120,227 @@ void RenderspeedTest::vignetteEffect()
     }
 }
 
+// The per pixel loop which drew the vignette before the index tables. Kept
+// as reference for all implementations.
+static void drawOriginalVignette(QImage &image, const QImage &gradient)
+{
+    const int imageWidth = image.width();
+    const QRgb *gradientRgb = reinterpret_cast<const QRgb*>(gradient.constBits());
+    QRgb *imageRgb = reinterpret_cast<QRgb*>(image.bits());
+    const int quarterWidth = imageWidth / 2;
+    const int quarterHeight = image.height() / 2;
+    // Right triangle with a, b = 181.0193359837561662; c = 256.
+    const qreal xScaleFactor = 181.0193359837561662 / quarterWidth;
+    const qreal yScaleFactor = 181.0193359837561662 / quarterHeight;
+
+    for (int y = 0; y <= quarterHeight; y++) {
+        const int scaledY = yScaleFactor * y;
+        const int scaledYSquare = scaledY * scaledY;
+        const int offsetYPlusQuarterWidth = quarterWidth + imageWidth * (quarterHeight - y);
+        for (int x = 0; x <= quarterWidth; x++) {
+            const int scaledX = xScaleFactor * x;
+            const int gradientColorIndex = int(sqrt(qreal(scaledYSquare + scaledX * scaledX)));
+            const QRgb gradientColor = gradientRgb[gradientColorIndex];
+            imageRgb[offsetYPlusQuarterWidth - x] = gradientColor;
+            imageRgb[offsetYPlusQuarterWidth + x] = gradientColor;
+        }
+    }
+    const int bytesPerLine = image.bytesPerLine();
+    QRgb *dst = imageRgb + imageWidth * image.height() - imageWidth;
+    QRgb *src = imageRgb;
+    for (int row = 0; row < quarterHeight; row++) {
+        memcpy(dst, src, bytesPerLine);
+        dst -= imageWidth;
+        src += imageWidth;
+    }
+}
+
+// The vignette alone, per implementation
+void RenderspeedTest::vignetteKernel()
+{
+    QFETCH(QSize, screenSize);
+    QFETCH(int, implementation);
+    const VignetteImplementation vignetteImplementation = VignetteImplementation(implementation);
+    if (!vignetteImplementationSupported(vignetteImplementation))
+        QSKIP("Not supported by this build or CPU", SkipSingle);
+
+    // Frame and button sizes like in the exercise screens
+    const QSize frameSize(screenSize.width(), screenSize.height() * 322 / 640);
+    const QSize buttonSize(screenSize.width(), screenSize.height() * 106 / 640);
+    QImage gradient(256, 1, QImage::Format_ARGB32);
+    for (int i = 0; i < gradient.width(); i++)
+        gradient.setPixel(i, 0, qRgba(255 - i, i / 2, i, 255 - i / 4));
+    QImage frame(frameSize, QImage::Format_ARGB32);
+    QImage button(buttonSize, QImage::Format_ARGB32);
+
+    // The scalar and the tested implementation must produce the same pixels
+    // as the original loop
+    QImage expectedFrame(frameSize, QImage::Format_ARGB32);
+    drawOriginalVignette(expectedFrame, gradient);
+    QImage expectedButton(buttonSize, QImage::Format_ARGB32);
+    drawOriginalVignette(expectedButton, gradient);
+    drawVignette(&frame, gradient, vignetteIndexTable(frameSize, VignetteImplementationScalar),
+                 VignetteImplementationScalar);
+    drawVignette(&button, gradient, vignetteIndexTable(buttonSize, VignetteImplementationScalar),
+                 VignetteImplementationScalar);
+    QCOMPARE(frame, expectedFrame);
+    QCOMPARE(button, expectedButton);
+    drawVignette(&frame, gradient, vignetteIndexTable(frameSize, vignetteImplementation), vignetteImplementation);
+    drawVignette(&button, gradient, vignetteIndexTable(buttonSize, vignetteImplementation), vignetteImplementation);
+    QCOMPARE(frame, expectedFrame);
+    QCOMPARE(button, expectedButton);
+
+    // Index tables are built each time, like on a size change
+    QBENCHMARK {
+        drawVignette(&frame, gradient, vignetteIndexTable(frameSize, vignetteImplementation), vignetteImplementation);
+        drawVignette(&button, gradient, vignetteIndexTable(buttonSize, vignetteImplementation), vignetteImplementation);
+    }
+}
+
+void RenderspeedTest::vignetteKernel_data()
+{
+    QTest::addColumn<QSize>("screenSize");
+    QTest::addColumn<int>("implementation");
+    const QSize screenSizes[] = {
+        QSize(240, 320),
+        QSize(360, 640),
+        QSize(480, 854),
+        QSize(640, 360),
+        QSize(1080, 1920),
+        // Odd frame and button widths and heights
+        QSize(241, 322),
+        QSize(361, 643)
+    };
+    static const char* const implementationNames[] = { "scalar", "SSE2", "AVX2" };
+    for (size_t i = 0; i < sizeof screenSizes / sizeof screenSizes[0]; i++) {
+        const QSize &size = screenSizes[i];
+        for (int implementation = VignetteImplementationScalar;
+             implementation <= VignetteImplementationAvx2; implementation++) {
+            const QByteArray rowName = QByteArray::number(size.width()) + 'x' + QByteArray::number(size.height())
+                    + ' ' + implementationNames[implementation];
+            QTest::newRow(rowName) << size << implementation;
+        }
+    }
+}
+
+void RenderspeedTest::designElementsMixed()
+{
+    // Lesson menu icons and an exercise screen, alternately on a 360 x 640 screen
+    const QSize requestedFrameSize(360, 322);
+    const QSize requestedButtonSize(360, 106);
+    const QSize requestedLessonIconSize(360, 144);
+    QSize size;
+    QBENCHMARK {
+        m_imageProvider.requestImage(QLatin1String("lessonicon/FirstLetter/0"), &size, requestedLessonIconSize);
+        m_imageProvider.requestImage(QLatin1String("lessonicon/CountEasy/1"), &size, requestedLessonIconSize);
+        m_imageProvider.requestImage(QLatin1String("frame/0"), &size, requestedFrameSize);
+        m_imageProvider.requestImage(QLatin1String("button/0"), &size, requestedButtonSize);
+        m_imageProvider.requestImage(QLatin1String("button/1"), &size, requestedButtonSize);
+        m_imageProvider.requestImage(QLatin1String("button/2"), &size, requestedButtonSize);
+    }
+}
+
+void RenderspeedTest::colorBlotTint()
+{
+    // The four answer blots of color exercises, with the blot layers already
+    // rendered. Only the tinting happens per request.
+    static const char* const colors[] = {
+        "red", "green", "blue", "yellow", "orange", "purple", "pink", "brown", "black", "white", "gray"
+    };
+    const QSize requestedSize(170, 150);
+    QSize size;
+    for (int variation = 0; variation < 4; variation++)
+        m_imageProvider.requestImage(QLatin1String("color/red/") + QString::number(variation), &size, requestedSize);
+    QBENCHMARK {
+        for (size_t i = 0; i < sizeof colors / sizeof colors[0]; i++)
+            for (int variation = 0; variation < 4; variation++)
+                m_imageProvider.requestImage(QLatin1String("color/") + QLatin1String(colors[i])
+                                             + QLatin1Char('/') + QString::number(variation), &size, requestedSize);
+    }
+}
+
+// The tint of the color blots, per implementation, against the original
+// QPainter composition
+void RenderspeedTest::colorTintKernel()
+{
+    QFETCH(QRgb, color);
+    QFETCH(int, implementation);
+    const ColorTintImplementation tintImplementation = ColorTintImplementation(implementation);
+    if (!colorTintImplementationSupported(tintImplementation))
+        QSKIP("Not supported by this build or CPU", SkipSingle);
+
+    // Masks with all alpha values, antialiased edges and noise. Odd width,
+    // so that the vectorized code also has a remainder.
+    const QSize size(261, 48);
+    QImage mask(size, QImage::Format_ARGB32);
+    mask.fill(0);
+    QImage highlight(size, QImage::Format_ARGB32);
+    highlight.fill(0);
+    qsrand(1);
+    for (int y = 0; y < 16; y++) {
+        for (int x = 0; x < size.width(); x++) {
+            const int alpha = y < 8 ? x % 256 : qrand() % 256;
+            mask.setPixel(x, y, qRgba(0x12, 0x34, 0x56, alpha));
+            const int highlightAlpha = (x + y) % 3 == 0 ? 0 : (x + y) % 3 == 1 ? 255 : qrand() % 256;
+            highlight.setPixel(x, y, qRgba(qrand() % 256, qrand() % 256, qrand() % 256, highlightAlpha));
+        }
+    }
+    mask = mask.convertToFormat(QImage::Format_ARGB32_Premultiplied);
+    highlight = highlight.convertToFormat(QImage::Format_ARGB32_Premultiplied);
+    {
+        QPainter p(&mask);
+        p.setRenderHint(QPainter::Antialiasing);
+        p.setBrush(Qt::black);
+        p.drawEllipse(QRectF(10.3, 16.7, 240.5, 30.1));
+        QPainter highlightPainter(&highlight);
+        highlightPainter.setRenderHint(QPainter::Antialiasing);
+        highlightPainter.setBrush(QColor(255, 255, 255, 100));
+        highlightPainter.drawEllipse(QRectF(30.5, 20.2, 100.1, 20.8));
+    }
+
+    // Like the color blots before they were tinted per pixel
+    QImage expected = mask;
+    {
+        QPainter p(&expected);
+        p.setCompositionMode(QPainter::CompositionMode_SourceIn);
+        p.fillRect(expected.rect(), QColor::fromRgba(color));
+        p.setCompositionMode(QPainter::CompositionMode_SourceOver);
+        p.drawImage(0, 0, highlight);
+    }
+    const QImage maskAlpha = alphaMask(mask);
+    QImage tinted(size, QImage::Format_ARGB32_Premultiplied);
+    tintAndComposite(&tinted, maskAlpha, premultipliedColor(color), highlight, tintImplementation);
+    QCOMPARE(tinted, expected);
+
+    QBENCHMARK {
+        tintAndComposite(&tinted, maskAlpha, premultipliedColor(color), highlight, tintImplementation);
+    }
+}
+
+void RenderspeedTest::colorTintKernel_data()
+{
+    QTest::addColumn<QRgb>("color");
+    QTest::addColumn<int>("implementation");
+    static const char* const implementationNames[] = { "scalar", "SSE2" };
+    const struct {
+        const char *name;
+        QRgb color;
+    } colors[] = {
+        { "red", qRgb(255, 48, 48) },
+        { "black", qRgb(0, 0, 0) },
+        { "white", qRgb(255, 255, 255) },
+        { "translucent orange", qRgba(255, 128, 0, 128) },
+        { "faint blue", qRgba(48, 144, 240, 32) }
+    };
+    for (size_t i = 0; i < sizeof colors / sizeof colors[0]; i++) {
+        for (int implementation = ColorTintImplementationScalar;
+             implementation <= ColorTintImplementationSse2; implementation++) {
+            const QByteArray rowName = QByteArray(colors[i].name) + ' ' + implementationNames[implementation];
+            QTest::newRow(rowName) << colors[i].color << implementation;
+        }
+    }
+}
+
 void RenderspeedTest::exerciseImages()
 {
     QFETCH(QString, id);
@@ -54,12 +356,403 @@ void RenderspeedTest::exerciseImages_data()
 {
     QTest::addColumn<QString>("id");
     QTest::newRow("Read (Robot)") << QString::fromLatin1("object/robot");
-    QTest::newRow("Count (20 Fishes)") << QString::fromLatin1("quantity/20/fish");
+    QTest::newRow("Count (20 Fishes)") << QString::fromLatin1("quantity/20/fish/1");
     QTest::newRow("Clock") << QString::fromLatin1("clock/9/45/0");
     QTest::newRow("Music (a sharp)") << QString::fromLatin1("notes/a sharp");
     QTest::newRow("Color (Yellow)") << QString::fromLatin1("color/#FF0/0");
 }
 
+void RenderspeedTest::exerciseImagesCached()
+{
+    QFETCH(QString, id);
+    const QSize requestedFrameSize(360, 322);
+    QSize size;
+    ImageProvider::setCacheByteBudget(4 * 1024 * 1024);
+    QBENCHMARK {
+        m_imageProvider.requestPixmap(id, &size, requestedFrameSize);
+    }
+    ImageProvider::setCacheByteBudget(0);
+}
+
+void RenderspeedTest::exerciseImagesCached_data()
+{
+    exerciseImages_data();
+}
+
+void RenderspeedTest::seededQuantityLayout()
+{
+    const QSize requestedSize(360, 322);
+    ImageProvider::clearCache();
+    qsrand(1);
+    const QImage first = m_imageProvider.requestImage(QLatin1String("quantity/20/fish/7"), 0, requestedSize);
+    ImageProvider::clearCache();
+    qsrand(2);
+    const QImage second = m_imageProvider.requestImage(QLatin1String("quantity/20/fish/7"), 0, requestedSize);
+    QCOMPARE(first, second);
+    const QImage otherSeed = m_imageProvider.requestImage(QLatin1String("quantity/20/fish/8"), 0, requestedSize);
+    QVERIFY(otherSeed != first);
+}
+
+void RenderspeedTest::requestParsing()
+{
+    QFETCH(QString, id);
+    ImageRequest request;
+    QVERIFY(request.parse(id));
+    QBENCHMARK {
+        request.parse(id);
+    }
+}
+
+// One id of each family
+static void addRequestIdRows(bool cacheableOnly)
+{
+    QTest::addColumn<QString>("id");
+    QTest::newRow("background") << QString::fromLatin1("background/background_01");
+    QTest::newRow("title") << QString::fromLatin1("title/textmask");
+    QTest::newRow("specialbutton") << QString::fromLatin1("specialbutton/backbutton");
+    QTest::newRow("button") << QString::fromLatin1("button/2");
+    QTest::newRow("frame") << QString::fromLatin1("frame/0");
+    QTest::newRow("object") << QString::fromLatin1("object/robot");
+    QTest::newRow("clock") << QString::fromLatin1("clock/9/45/0");
+    QTest::newRow("notes") << QString::fromLatin1("notes/a sharp");
+    if (!cacheableOnly) // Random layout, never cached
+        QTest::newRow("quantity") << QString::fromLatin1("quantity/20/fish");
+    QTest::newRow("quantity seeded") << QString::fromLatin1("quantity/20/fish/1");
+    QTest::newRow("lessonicon") << QString::fromLatin1("lessonicon/CountEasy/1");
+    QTest::newRow("color") << QString::fromLatin1("color/#FF0/0");
+}
+
+void RenderspeedTest::requestParsing_data()
+{
+    addRequestIdRows(false);
+}
+
+void RenderspeedTest::requestIntArguments()
+{
+    QFETCH(QString, argument);
+    QFETCH(int, value);
+    const QString id = QLatin1String("clock/") + argument + QLatin1String("/0/0");
+    ImageRequest request;
+    QVERIFY(request.parse(id));
+    QCOMPARE(request.intArgument(0), value);
+}
+
+void RenderspeedTest::requestIntArguments_data()
+{
+    QTest::addColumn<QString>("argument");
+    QTest::addColumn<int>("value");
+    QTest::newRow("zero") << QString::fromLatin1("0") << 0;
+    QTest::newRow("positive") << QString::fromLatin1("42") << 42;
+    QTest::newRow("negative") << QString::fromLatin1("-7") << -7;
+    QTest::newRow("minus only") << QString::fromLatin1("-") << 0;
+    QTest::newRow("not a number") << QString::fromLatin1("4x") << 0;
+    QTest::newRow("largest") << QString::fromLatin1("2147483647") << INT_MAX;
+    QTest::newRow("smallest") << QString::fromLatin1("-2147483647") << -INT_MAX;
+    QTest::newRow("too large") << QString::fromLatin1("2147483648") << 0;
+    QTest::newRow("much too large") << QString::fromLatin1("99999999999999999999") << 0;
+    QTest::newRow("too small") << QString::fromLatin1("-2147483649") << 0;
+}
+
+void RenderspeedTest::cachedRequestDispatch()
+{
+    // Parsing, cache key and lookup are all that is left on a cache hit
+    QFETCH(QString, id);
+    const QSize requestedSize(360, 106);
+    QSize size;
+    ImageProvider::setCacheByteBudget(4 * 1024 * 1024);
+    m_imageProvider.requestImage(id, &size, requestedSize);
+    const int hitsBefore = ImageProvider::cacheHits();
+    QBENCHMARK {
+        m_imageProvider.requestImage(id, &size, requestedSize);
+    }
+    QVERIFY(ImageProvider::cacheHits() > hitsBefore);
+    ImageProvider::setCacheByteBudget(0);
+}
+
+void RenderspeedTest::cachedRequestDispatch_data()
+{
+    addRequestIdRows(true);
+}
+
+void RenderspeedTest::requestMetrics()
+{
+    ImageProviderMetrics metrics;
+    metrics.reset();
+    QSize size;
+    m_imageProvider.requestImage(QLatin1String("clock/9/45/0"), &size, QSize(196, 196));
+    m_imageProvider.requestImage(QLatin1String("clock/9/45/1"), &size, QSize(196, 196));
+    m_imageProvider.requestImage(QLatin1String("nosuchfamily/0"), &size, QSize(196, 196));
+    const QVariantMap clock = metrics.family(QLatin1String("clock"));
+    QCOMPARE(clock.value(QLatin1String("requests")).toInt(), 2);
+    QCOMPARE(clock.value(QLatin1String("failures")).toInt(), 0);
+    QVERIFY(clock.value(QLatin1String("outputKilobytes")).toInt() > 0);
+    QCOMPARE(metrics.family(QLatin1String("invalid")).value(QLatin1String("failures")).toInt(), 1);
+    // Totals beyond 32 bit microseconds
+    metrics.reset();
+    for (int i = 0; i < 3000; i++)
+        ImageProviderMetrics::recordRequest(ImageFamilyNotes, 999999, QImage());
+    ImageProviderMetrics::recordRequest(ImageFamilyNotes, Q_INT64_C(2500000), QImage());
+    QCOMPARE(metrics.family(QLatin1String("notes")).value(QLatin1String("totalMicroseconds")).toLongLong(),
+             Q_INT64_C(3000) * 999999 + 2500000);
+    // A cache hit is the cheapest request, recording the metrics adds to each
+    ImageProvider::setCacheByteBudget(1024 * 1024);
+    QBENCHMARK {
+        m_imageProvider.requestImage(QLatin1String("clock/9/45/0"), &size, QSize(196, 196));
+    }
+    ImageProvider::setCacheByteBudget(0);
+}
+
+// Ids of the families which are drawn via display lists, with typical sizes
+static void addDisplayListRows(bool withRenderingModes)
+{
+    QTest::addColumn<QString>("id");
+    QTest::addColumn<QSize>("requestedSize");
+    QTest::addColumn<bool>("displayLists");
+    const struct {
+        const char *name;
+        const char *id;
+        QSize size;
+    } rows[] = {
+        { "Background", "background/background_01", QSize(360, 640) },
+        { "Special button", "specialbutton/backbutton", QSize(60, 60) },
+        { "Button", "button/1", QSize(360, 106) },
+        { "Read (Robot)", "object/robot", QSize(360, 322) },
+        { "Count (20 Fishes)", "quantity/20/fish/1", QSize(360, 322) },
+        { "Lesson icon", "lessonicon/Read/0", QSize(180, 207) },
+        { "Color (Yellow)", "color/#FF0/0", QSize(360, 322) }
+    };
+    for (size_t i = 0; i < sizeof rows / sizeof rows[0]; i++) {
+        const QString id = QLatin1String(rows[i].id);
+        if (withRenderingModes) {
+            QTest::newRow(QByteArray(rows[i].name) + " QSvgRenderer") << id << rows[i].size << false;
+            QTest::newRow(QByteArray(rows[i].name) + " display list") << id << rows[i].size << true;
+        } else {
+            QTest::newRow(rows[i].name) << id << rows[i].size << true;
+        }
+    }
+}
+
+// Renders without any cached intermediate layer. Countables get the same random layout.
+static QImage uncachedImage(ImageProvider *imageProvider, const QString &id, const QSize &requestedSize)
+{
+    ImageProvider::clearCache();
+    qsrand(1);
+    return imageProvider->requestImage(id, 0, requestedSize);
+}
+
+void RenderspeedTest::displayListAccuracy()
+{
+    QFETCH(QString, id);
+    QFETCH(QSize, requestedSize);
+    ImageProvider::setDisplayListsEnabled(false);
+    const QImage expected =
+            uncachedImage(&m_imageProvider, id, requestedSize).convertToFormat(QImage::Format_ARGB32_Premultiplied);
+    ImageProvider::setDisplayListsEnabled(true);
+    const QImage actual =
+            uncachedImage(&m_imageProvider, id, requestedSize).convertToFormat(QImage::Format_ARGB32_Premultiplied);
+    QCOMPARE(actual.size(), expected.size());
+
+    // Antialiasing may differ slightly, shapes and colors may not
+    const int channelTolerance = 16;
+    const qreal differingPixelsTolerance = 0.005;
+    int differingPixels = 0;
+    for (int y = 0; y < expected.height(); y++) {
+        const QRgb *expectedLine = reinterpret_cast<const QRgb*>(expected.constScanLine(y));
+        const QRgb *actualLine = reinterpret_cast<const QRgb*>(actual.constScanLine(y));
+        for (int x = 0; x < expected.width(); x++) {
+            const QRgb e = expectedLine[x];
+            const QRgb a = actualLine[x];
+            if (qAbs(qRed(e) - qRed(a)) > channelTolerance || qAbs(qGreen(e) - qGreen(a)) > channelTolerance
+                    || qAbs(qBlue(e) - qBlue(a)) > channelTolerance || qAbs(qAlpha(e) - qAlpha(a)) > channelTolerance)
+                differingPixels++;
+        }
+    }
+    QVERIFY2(differingPixels <= differingPixelsTolerance * expected.width() * expected.height(),
+             qPrintable(QString::fromLatin1("%1 pixels differ").arg(differingPixels)));
+}
+
+void RenderspeedTest::displayListAccuracy_data()
+{
+    addDisplayListRows(false);
+}
+
+void RenderspeedTest::displayListRendering()
+{
+    QFETCH(QString, id);
+    QFETCH(QSize, requestedSize);
+    QFETCH(bool, displayLists);
+    ImageProvider::setDisplayListsEnabled(displayLists);
+    uncachedImage(&m_imageProvider, id, requestedSize); // Compiles the display lists
+    QBENCHMARK {
+        uncachedImage(&m_imageProvider, id, requestedSize);
+    }
+    ImageProvider::setDisplayListsEnabled(true);
+}
+
+void RenderspeedTest::displayListRendering_data()
+{
+    addDisplayListRows(true);
+}
+
+void RenderspeedTest::svgElementIndex()
+{
+    QFETCH(QString, svgFileName);
+    QFETCH(bool, deserialize);
+    QFile svgFile(QLatin1String("data/graphics/") + svgFileName);
+    QVERIFY(svgFile.open(QIODevice::ReadOnly));
+    const QByteArray svgDocument = svgFile.readAll();
+    QSvgRenderer renderer(svgDocument);
+    const QString idPrefix = QLatin1String("id_");
+    SvgElementIndex index;
+    index.build(svgDocument, &renderer, idPrefix);
+    QVERIFY(!index.isEmpty());
+    QByteArray serialized;
+    {
+        QDataStream stream(&serialized, QIODevice::WriteOnly);
+        stream << index;
+    }
+
+    if (deserialize) {
+        QBENCHMARK {
+            QDataStream stream(serialized);
+            SvgElementIndex readIndex;
+            stream >> readIndex;
+        }
+        QDataStream stream(serialized);
+        SvgElementIndex readIndex;
+        stream >> readIndex;
+        QByteArray serializedAgain;
+        QDataStream streamAgain(&serializedAgain, QIODevice::WriteOnly);
+        streamAgain << readIndex;
+        QCOMPARE(serializedAgain.size(), serialized.size());
+    } else {
+        QBENCHMARK {
+            SvgElementIndex builtIndex;
+            builtIndex.build(svgDocument, &renderer, idPrefix);
+        }
+    }
+}
+
+void RenderspeedTest::svgElementIndex_data()
+{
+    QTest::addColumn<QString>("svgFileName");
+    QTest::addColumn<bool>("deserialize");
+    const char* const svgFileNames[] = {
+        "design.svg", "objects.svg", "countables.svg", "clocks.svg", "notes.svg", "lessonicons.svg"
+    };
+    for (size_t i = 0; i < sizeof svgFileNames / sizeof svgFileNames[0]; i++) {
+        QTest::newRow(QByteArray(svgFileNames[i]) + " build") << QString::fromLatin1(svgFileNames[i]) << false;
+        QTest::newRow(QByteArray(svgFileNames[i]) + " read") << QString::fromLatin1(svgFileNames[i]) << true;
+    }
+}
+
+void RenderspeedTest::assetPackLookup()
+{
+    QFETCH(QString, id);
+    QFETCH(QSize, requestedSize);
+    const QImage rendered = uncachedImage(&m_imageProvider, id, requestedSize);
+    const QString packFileName = QDir::tempPath() + QLatin1String("/tst_renderspeedtest.pack");
+    QList<QPair<QString, QSize> > requests;
+    requests.append(qMakePair(id, requestedSize));
+    QVERIFY(ImageProvider::writeAssetPack(packFileName, requests));
+    ImageProvider::setAssetPackFileName(packFileName);
+    const QImage packed = uncachedImage(&m_imageProvider, id, requestedSize);
+    QBENCHMARK {
+        uncachedImage(&m_imageProvider, id, requestedSize);
+    }
+    ImageProvider::setAssetPackFileName(QString());
+    QFile::remove(packFileName);
+    QCOMPARE(packed, rendered);
+}
+
+void RenderspeedTest::assetPackLookup_data()
+{
+    addDisplayListRows(false);
+}
+
+void RenderspeedTest::threadedRendering()
+{
+    QFETCH(int, threadCount);
+    const QSize requestedFrameSize(360, 322);
+    QStringList ids;
+    for (int i = 0; i < 8; i++) {
+        ids << QString::fromLatin1("object/robot")
+            << QString::fromLatin1("quantity/20/fish/%1").arg(i)
+            << QString::fromLatin1("clock/%1/45/%1").arg(i + 1)
+            << QString::fromLatin1("notes/a sharp")
+            << QString::fromLatin1("color/#FF0/%1").arg(i);
+    }
+    QThreadPool pool;
+    pool.setMaxThreadCount(threadCount);
+    QBENCHMARK {
+        foreach (const QString &id, ids)
+            pool.start(new RenderTask(&m_imageProvider, id, requestedFrameSize));
+        pool.waitForDone();
+    }
+}
+
+void RenderspeedTest::threadedRendering_data()
+{
+    QTest::addColumn<int>("threadCount");
+    const int idealThreadCount = qMax(1, QThread::idealThreadCount());
+    for (int threadCount = 1; threadCount < idealThreadCount; threadCount *= 2)
+        QTest::newRow(QByteArray::number(threadCount) + " thread(s)") << threadCount;
+    QTest::newRow(QByteArray::number(idealThreadCount) + " thread(s)") << idealThreadCount;
+}
+
+void RenderspeedTest::startupMenuFrame()
+{
+    // From a cold start to all images of the first lesson menu frame, on a
+    // 360 x 640 screen. Like in main.cpp, the viewer requests the images
+    // right after the assets started loading.
+    QFETCH(bool, backgroundLoading);
+    static const char* const lessonIds[] = { "Read", "Count", "Clock", "Music", "Color", "Mixed" };
+    ImageProvider::unloadAssets();
+    QSize size;
+    QBENCHMARK_ONCE {
+        if (backgroundLoading)
+            ImageProvider::init();
+        else
+            ImageProvider::loadAllAssets();
+        m_imageProvider.requestImage(QLatin1String("specialbutton/exitbutton"), &size, QSize(50, 50));
+        m_imageProvider.requestImage(QLatin1String("title/textmask"), &size, QSize(360, 640));
+        m_imageProvider.requestImage(QLatin1String("title/spectrum"), &size, QSize(360, 86));
+        for (size_t i = 0; i < sizeof lessonIds / sizeof lessonIds[0]; i++)
+            m_imageProvider.requestImage(QLatin1String("lessonicon/") + QLatin1String(lessonIds[i])
+                                         + QLatin1Char('/') + QString::number(i), &size, QSize(180, 207));
+    }
+    ImageProvider::loadAllAssets();
+}
+
+void RenderspeedTest::startupMenuFrame_data()
+{
+    QTest::addColumn<bool>("backgroundLoading");
+    QTest::newRow("Sequential loading (before)") << false;
+    QTest::newRow("Background loading") << true;
+}
+
+void RenderspeedTest::coldStartLessonIcons()
+{
+    // Without an element index file, the lesson icons derive the button
+    // variations while the asset loader is still parsing design.svg
+    static const char* const lessonIds[] = { "Read", "Count", "Clock", "Music", "Color", "Mixed" };
+    const int lessonIdsCount = sizeof lessonIds / sizeof lessonIds[0];
+    for (int run = 0; run < 10; run++) {
+        ImageProvider::unloadAssets();
+        QThreadPool *pool = new QThreadPool;
+        pool->setMaxThreadCount(lessonIdsCount);
+        QSemaphore done;
+        ImageProvider::init();
+        for (int i = 0; i < lessonIdsCount; i++)
+            pool->start(new SignalingRenderTask(&m_imageProvider, QLatin1String("lessonicon/") + QLatin1String(lessonIds[i])
+                                                + QLatin1Char('/') + QString::number(i), QSize(180, 207), &done));
+        if (!done.tryAcquire(lessonIdsCount, 30000))
+            QFAIL("Deadlock, the pool is leaked"); // Its destructor would wait forever
+        delete pool;
+    }
+    ImageProvider::loadAllAssets();
+}
+
 QTEST_MAIN(RenderspeedTest)
 
 #include "tst_renderspeedtest.moc"
@@ -0,0 +1,123 @@
+#include <QtCore/QString>
+#include <QtTest/QtTest>
+#include <QtCore/QCoreApplication>
+#include <QtCore/QDir>
+#include <QtCore/QFile>
+
+#include "settingsstore.h"
+
+class SettingsStoreTest : public QObject
+{
+    Q_OBJECT
+
+public:
+    SettingsStoreTest();
+
+private Q_SLOTS:
+    void init();
+    void cleanup();
+    void roundTrip();
+    void writeIsDeferred();
+    void interruptedWrite();
+    void interruptedReplace();
+    void damagedFile();
+    void setValue();
+
+private:
+    const QString m_fileName;
+};
+
+SettingsStoreTest::SettingsStoreTest()
+    : m_fileName(QDir::tempPath() + QLatin1String("/tst_settingsstoretest/settings.bin"))
+{
+}
+
+void SettingsStoreTest::init()
+{
+    cleanup();
+}
+
+void SettingsStoreTest::cleanup()
+{
+    QFile::remove(m_fileName);
+    QFile::remove(m_fileName + QLatin1String(".new"));
+}
+
+void SettingsStoreTest::roundTrip()
+{
+    {
+        SettingsStore store(m_fileName);
+        QVERIFY(!store.contains(QLatin1String("Volume")));
+        QCOMPARE(store.value(QLatin1String("Volume"), 60).toInt(), 60);
+        store.setValue(QLatin1String("Volume"), 40);
+        store.setValue(QLatin1String("LessonOfGroup/Count"), QLatin1String("CountHard"));
+    }
+    SettingsStore store(m_fileName);
+    QCOMPARE(store.value(QLatin1String("Volume")).toInt(), 40);
+    QCOMPARE(store.value(QLatin1String("LessonOfGroup/Count")).toString(), QString::fromLatin1("CountHard"));
+}
+
+void SettingsStoreTest::writeIsDeferred()
+{
+    SettingsStore store(m_fileName);
+    store.setValue(QLatin1String("Volume"), 80);
+    QVERIFY(!QFile::exists(m_fileName));
+    store.flush();
+    QCOMPARE(SettingsStore::read(m_fileName).value(QLatin1String("Volume")).toInt(), 80);
+}
+
+void SettingsStoreTest::interruptedWrite()
+{
+    QVariantMap values;
+    values.insert(QLatin1String("Volume"), 20);
+    QVERIFY(SettingsStore::write(m_fileName, values));
+    values.insert(QLatin1String("Volume"), 100);
+    QVERIFY(SettingsStore::write(m_fileName + QLatin1String(".tmp"), values));
+    // Crash while the new file was being written
+    QFile complete(m_fileName + QLatin1String(".tmp"));
+    QVERIFY(complete.open(QIODevice::ReadOnly));
+    const QByteArray data = complete.readAll();
+    complete.close();
+    complete.remove();
+    QFile truncated(m_fileName + QLatin1String(".new"));
+    QVERIFY(truncated.open(QIODevice::WriteOnly));
+    truncated.write(data.left(data.size() - 3));
+    truncated.close();
+    QCOMPARE(SettingsStore::read(m_fileName).value(QLatin1String("Volume")).toInt(), 20);
+}
+
+void SettingsStoreTest::interruptedReplace()
+{
+    QVariantMap values;
+    values.insert(QLatin1String("Volume"), 100);
+    QVERIFY(SettingsStore::write(m_fileName, values));
+    // Crash after the old file was removed
+    QVERIFY(QFile::rename(m_fileName, m_fileName + QLatin1String(".new")));
+    QCOMPARE(SettingsStore::read(m_fileName).value(QLatin1String("Volume")).toInt(), 100);
+}
+
+void SettingsStoreTest::damagedFile()
+{
+    QVariantMap values;
+    values.insert(QLatin1String("Volume"), 100);
+    QVERIFY(SettingsStore::write(m_fileName, values));
+    QFile file(m_fileName);
+    QVERIFY(file.open(QIODevice::ReadWrite));
+    file.seek(file.size() - 4);
+    file.write("XXXX");
+    file.close();
+    QVERIFY(SettingsStore::read(m_fileName).isEmpty());
+}
+
+void SettingsStoreTest::setValue()
+{
+    SettingsStore store(m_fileName);
+    QBENCHMARK {
+        store.setValue(QLatin1String("Volume"), 40);
+        store.setValue(QLatin1String("Volume"), 60);
+    }
+}
+
+QTEST_MAIN(SettingsStoreTest)
+
+#include "tst_settingsstoretest.moc"
@@ -0,0 +1,138 @@
+#include <QtCore/QString>
+#include <QtTest/QtTest>
+#include <QtCore/QCoreApplication>
+#include <QtCore/QDir>
+#include <QtSvg/QSvgRenderer>
+
+#include "svgelementindex.h"
+
+class SvgElementIndexTest : public QObject
+{
+    Q_OBJECT
+
+public:
+    SvgElementIndexTest();
+
+private Q_SLOTS:
+    void cleanup();
+    void roundTrip();
+    void otherSourceHash();
+    void truncatedFile();
+    void wrongMagic();
+
+private:
+    static SvgElementIndex builtIndex(const QString &svgFileName);
+    static void compareIndexes(const SvgElementIndex &actual, const SvgElementIndex &expected);
+    void writeTestFile();
+
+    const QString m_fileName;
+    SvgElementIndex::IndexesBySourceHash m_indexes;
+};
+
+SvgElementIndexTest::SvgElementIndexTest()
+    : m_fileName(QDir::tempPath() + QLatin1String("/tst_svgelementindextest.index"))
+{
+    m_indexes.insert(1, builtIndex(QLatin1String("design.svg")));
+    m_indexes.insert(2, builtIndex(QLatin1String("clocks.svg")));
+}
+
+SvgElementIndex SvgElementIndexTest::builtIndex(const QString &svgFileName)
+{
+    QFile svgFile(QLatin1String(SVG_SOURCE_DIR "/") + svgFileName);
+    svgFile.open(QIODevice::ReadOnly);
+    const QByteArray svgDocument = svgFile.readAll();
+    QSvgRenderer renderer(svgDocument);
+    SvgElementIndex result;
+    result.build(svgDocument, &renderer, QLatin1String("id_"));
+    return result;
+}
+
+void SvgElementIndexTest::compareIndexes(const SvgElementIndex &actual, const SvgElementIndex &expected)
+{
+    QStringList actualNames = actual.elementNames();
+    QStringList expectedNames = expected.elementNames();
+    qSort(actualNames);
+    qSort(expectedNames);
+    QCOMPARE(actualNames, expectedNames);
+    const SvgElementIndex::Companion companions[] = {
+        SvgElementIndex::CompanionRect, SvgElementIndex::CompanionMask,
+        SvgElementIndex::CompanionHighlight, SvgElementIndex::CompanionHead
+    };
+    foreach (const QString &name, expectedNames) {
+        QCOMPARE(actual.bounds(name), expected.bounds(name));
+        for (size_t i = 0; i < sizeof companions / sizeof companions[0]; i++)
+            QCOMPARE(actual.hasCompanion(name, companions[i]), expected.hasCompanion(name, companions[i]));
+    }
+    static const char* const baseNames[] = { "button", "frame", "colorblot", "background" };
+    for (size_t i = 0; i < sizeof baseNames / sizeof baseNames[0]; i++) {
+        const QString baseName = QLatin1String(baseNames[i]);
+        QCOMPARE(actual.variationsCount(baseName), expected.variationsCount(baseName));
+        const SvgElementIndex::AspectRatioBuckets actualBuckets = actual.aspectRatioBuckets(baseName);
+        const SvgElementIndex::AspectRatioBuckets expectedBuckets = expected.aspectRatioBuckets(baseName);
+        QCOMPARE(actualBuckets.count(), expectedBuckets.count());
+        for (int j = 0; j < expectedBuckets.count(); j++) {
+            QCOMPARE(actualBuckets.at(j).elementIds, expectedBuckets.at(j).elementIds);
+            QCOMPARE(actualBuckets.at(j).widthToHeightRatio, expectedBuckets.at(j).widthToHeightRatio);
+        }
+    }
+}
+
+void SvgElementIndexTest::writeTestFile()
+{
+    QFile::remove(m_fileName);
+    QVERIFY(SvgElementIndex::writeFile(m_fileName, m_indexes));
+}
+
+void SvgElementIndexTest::cleanup()
+{
+    QFile::remove(m_fileName);
+}
+
+void SvgElementIndexTest::roundTrip()
+{
+    QVERIFY(!m_indexes.value(1).isEmpty());
+    QVERIFY(m_indexes.value(1).variationsCount(QLatin1String("button")) > 0);
+    QVERIFY(!m_indexes.value(2).isEmpty());
+    writeTestFile();
+    const SvgElementIndex::IndexesBySourceHash read = SvgElementIndex::readFile(m_fileName);
+    QCOMPARE(read.count(), 2);
+    compareIndexes(read.value(1), m_indexes.value(1));
+    compareIndexes(read.value(2), m_indexes.value(2));
+}
+
+void SvgElementIndexTest::otherSourceHash()
+{
+    // A changed SVG file has another hash, and finds no index
+    writeTestFile();
+    const SvgElementIndex::IndexesBySourceHash read = SvgElementIndex::readFile(m_fileName);
+    QVERIFY(!read.contains(3));
+    QVERIFY(read.value(3).isEmpty());
+}
+
+void SvgElementIndexTest::truncatedFile()
+{
+    writeTestFile();
+    QFile file(m_fileName);
+    const qint64 size = file.size();
+    QVERIFY(size > 100);
+    const qint64 sizes[] = { size - 1, size / 2, 12, 4, 0 };
+    for (size_t i = 0; i < sizeof sizes / sizeof sizes[0]; i++) {
+        QVERIFY(file.resize(sizes[i]));
+        QVERIFY(SvgElementIndex::readFile(m_fileName).isEmpty());
+    }
+    QVERIFY(SvgElementIndex::readFile(m_fileName + QLatin1String(".nonexistent")).isEmpty());
+}
+
+void SvgElementIndexTest::wrongMagic()
+{
+    writeTestFile();
+    QFile file(m_fileName);
+    QVERIFY(file.open(QIODevice::ReadWrite));
+    QVERIFY(file.putChar('X'));
+    file.close();
+    QVERIFY(SvgElementIndex::readFile(m_fileName).isEmpty());
+}
+
+QTEST_MAIN(SvgElementIndexTest)
+
+#include "tst_svgelementindextest.moc"